@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <glib/gstdio.h>
+
+#include "bench-common.h"
+#include "song.h"
+#include "config.h"
+
+#define STATIONS 200
+
+static const gchar *_syllables[] = {
+    "ka", "li", "mo", "ra", "ne", "to", "vi", "sa", "lu", "pe",
+    "kä", "yö", "jo", "ha", "ri", "un", "mä", "se", "ko", "tu"
+};
+
+static const gchar *_codecs[] = { "FLAC", "MPEG-1 Layer 3 (MP3)", "Vorbis", "Opus", "MPEG-4 AAC" };
+static const gchar *_suffixes[] = { "flac", "mp3", "ogg", "opus", "m4a" };
+
+static void _append_word (GString *str, GRand *r, gboolean capital);
+static gchar *_words (GRand *r, guint min, guint max);
+static guint _popular_artist (BenchLibrary *lib);
+static Song *_stream_song (BenchLibrary *lib);
+static Song *_untagged_song (guint index);
+static Song *_tagged_song (BenchLibrary *lib);
+
+void bench_library_init (BenchLibrary *lib, guint songs, guint32 seed)
+{
+    lib->rand = g_rand_new_with_seed (seed);
+    lib->num_artists = MAX (10, songs / 40);
+    lib->artists = g_new0 (gchar *, lib->num_artists);
+    lib->albums = g_new0 (gchar *, lib->num_artists * BENCH_ALBUMS_PER_ARTIST);
+    for (guint i = 0; i < lib->num_artists; i++) {
+        lib->artists[i] = _words (lib->rand, 1, 3);
+        for (guint j = 0; j < BENCH_ALBUMS_PER_ARTIST; j++) {
+            lib->albums[i * BENCH_ALBUMS_PER_ARTIST + j] = _words (lib->rand, 1, 4);
+        }
+    }
+}
+
+void bench_library_clear (BenchLibrary *lib)
+{
+    for (guint i = 0; i < lib->num_artists; i++) g_free (lib->artists[i]);
+    for (guint i = 0; i < lib->num_artists * BENCH_ALBUMS_PER_ARTIST; i++) g_free (lib->albums[i]);
+    g_free (lib->artists);
+    g_free (lib->albums);
+    g_rand_free (lib->rand);
+    lib->artists = NULL;
+    lib->albums = NULL;
+    lib->rand = NULL;
+}
+
+GList *bench_library_generate (BenchLibrary *lib, guint songs)
+{
+    GList *l = NULL;
+    for (guint i = 0; i < songs; i++) {
+        gdouble kind = g_rand_double (lib->rand);
+        Song *s;
+        if (kind < 0.04) s = _stream_song (lib);
+        else if (kind < 0.12) s = _untagged_song (i);
+        else s = _tagged_song (lib);
+        if (s != NULL) l = g_list_prepend (l, s);
+    }
+    return g_list_reverse (l);
+}
+
+gboolean bench_config_init (const gchar *dir)
+{
+    config_file_path = g_build_filename (dir, "bench.cfg", NULL);
+    if (config_file_path == NULL) return FALSE;
+    if (config_generate_example_file (config_file_path) != 0) return FALSE;
+    return config_init () == 0;
+}
+
+void bench_config_free (void)
+{
+    config_destroy ();
+    if (config_file_path != NULL) g_unlink (config_file_path);
+    g_free (config_file_path);
+    config_file_path = NULL;
+}
+
+static void _append_word (GString *str, GRand *r, gboolean capital)
+{
+    guint syllables = g_rand_int_range (r, 1, 4);
+    gsize start = str->len;
+    for (guint i = 0; i < syllables; i++) {
+        g_string_append (str, _syllables[g_rand_int_range (r, 0, G_N_ELEMENTS (_syllables))]);
+    }
+    if (capital == TRUE) str->str[start] = g_ascii_toupper (str->str[start]);
+}
+
+static gchar *_words (GRand *r, guint min, guint max)
+{
+    GString *str = g_string_new (NULL);
+    guint words = g_rand_int_range (r, min, max + 1);
+    for (guint i = 0; i < words; i++) {
+        if (i > 0) g_string_append_c (str, ' ');
+        _append_word (str, r, i == 0 || g_rand_boolean (r));
+    }
+    return g_string_free (str, FALSE);
+}
+
+/* Few artists have most of the songs */
+static guint _popular_artist (BenchLibrary *lib)
+{
+    gdouble u = g_rand_double (lib->rand);
+    return (guint)(lib->num_artists * u * u * u);
+}
+
+static Song *_stream_song (BenchLibrary *lib)
+{
+    gchar uri[64];
+    Song *s;
+    g_snprintf (uri, sizeof (uri), "http://radio%u.example.net:8000/live",
+        g_rand_int_range (lib->rand, 0, STATIONS));
+    s = song_new (uri);
+    if (s == NULL) return NULL;
+    song_set_type (s, SONG_TYPE_STREAM);
+    if (g_rand_boolean (lib->rand)) {
+        gchar *title = _words (lib->rand, 2, 6);
+        song_set_stream_title (s, title);
+        g_free (title);
+    }
+    return s;
+}
+
+static Song *_untagged_song (guint index)
+{
+    gchar path[64];
+    gchar *uri;
+    Song *s;
+    g_snprintf (path, sizeof (path), "/music/incoming/track%06u.mp3", index);
+    uri = g_filename_to_uri (path, NULL, NULL);
+    s = song_new (uri);
+    g_free (uri);
+    if (s == NULL) return NULL;
+    song_set_type (s, SONG_TYPE_FILE);
+    return s;
+}
+
+static Song *_tagged_song (BenchLibrary *lib)
+{
+    guint artist = _popular_artist (lib);
+    guint album = artist * BENCH_ALBUMS_PER_ARTIST + g_rand_int_range (lib->rand, 0, BENCH_ALBUMS_PER_ARTIST);
+    guint codec = g_rand_int_range (lib->rand, 0, G_N_ELEMENTS (_codecs));
+    guint track = g_rand_int_range (lib->rand, 1, 21);
+    gdouble u = g_rand_double (lib->rand);
+    gchar *title = _words (lib->rand, 1, 5);
+    gchar *path = g_strdup_printf ("/music/%s/%s/%02u - %s.%s", lib->artists[artist],
+        lib->albums[album], track, title, _suffixes[codec]);
+    gchar *uri = g_filename_to_uri (path, NULL, NULL);
+    Song *s = song_new (uri);
+
+    g_free (path);
+    g_free (uri);
+    if (s != NULL) {
+        song_set_type (s, SONG_TYPE_FILE);
+        song_set_artist (s, lib->artists[artist]);
+        song_set_album (s, lib->albums[album]);
+        song_set_title (s, title);
+        song_set_codec (s, _codecs[codec]);
+        song_set_year (s, 1960 + (album * 7919) % 65);
+        song_set_track (s, track);
+        song_set_duration (s, (90 + (gint64)(u * u * 420)) * 1000);
+    }
+    g_free (title);
+    return s;
+}
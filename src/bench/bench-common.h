@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_BENCH_COMMON_H_
+#define _KK_BENCH_COMMON_H_
+
+#include <glib.h>
+
+#define BENCH_ALBUMS_PER_ARTIST 8
+
+/* Names for synthetic songs */
+typedef struct {
+    GRand *rand;
+    guint num_artists;
+    gchar **artists; /* most popular first */
+    gchar **albums; /* BENCH_ALBUMS_PER_ARTIST per artist */
+} BenchLibrary;
+
+void bench_library_init (BenchLibrary *lib, guint songs, guint32 seed);
+void bench_library_clear (BenchLibrary *lib);
+/* 4% streams, 8% files without tags, rest tagged files. Caller owns songs. */
+GList *bench_library_generate (BenchLibrary *lib, guint songs);
+
+/* Config with default values to dir. Returns FALSE on failure. */
+gboolean bench_config_init (const gchar *dir);
+void bench_config_free (void);
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/*
+ * Headless benchmarks for playlist, search, line formatting and playlist
+ * files. Songs are generated, inspector is a stub. Results are printed to
+ * stdout as JSON, one object per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "playlist.h"
+#include "playlist-line.h"
+#include "playlist-pls.h"
+#include "playlist-m3u.h"
+#include "ncurses-common.h"
+#include "inspector-stub.h"
+#include "bench-common.h"
+
+#define DEFAULT_SIZES "10000,100000,1000000"
+#define DEFAULT_SEED 1984
+/* Suffle and search walk the list with nth, so they are skipped for larger
+ * playlists. */
+#define DEFAULT_QUADRATIC_MAX 20000
+#define LOOKUPS 1000
+#define COPY_SONGS 256
+#define SEARCH_NEXTS 10
+
+typedef struct {
+    gint64 start;
+    guint64 allocs;
+    guint64 alloc_bytes;
+} BenchMark;
+
+static guint _quadratic_max = DEFAULT_QUADRATIC_MAX;
+
+/* Whole process is counted. Benchmarks are run in one thread. */
+static guint64 _allocs = 0;
+static guint64 _alloc_bytes = 0;
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *p, size_t size);
+extern void __libc_free (void *p);
+
+void *malloc (size_t size)
+{
+    _allocs++;
+    _alloc_bytes += size;
+    return __libc_malloc (size);
+}
+
+void *calloc (size_t n, size_t size)
+{
+    _allocs++;
+    _alloc_bytes += n * size;
+    return __libc_calloc (n, size);
+}
+
+void *realloc (void *p, size_t size)
+{
+    _allocs++;
+    _alloc_bytes += size;
+    return __libc_realloc (p, size);
+}
+
+void free (void *p)
+{
+    __libc_free (p);
+}
+
+static void _begin (BenchMark *m)
+{
+    m->allocs = _allocs;
+    m->alloc_bytes = _alloc_bytes;
+    m->start = g_get_monotonic_time ();
+}
+
+static void _end (BenchMark *m, const gchar *name, guint songs, guint ops)
+{
+    gint64 usec = g_get_monotonic_time () - m->start;
+    guint64 allocs = _allocs - m->allocs;
+    guint64 bytes = _alloc_bytes - m->alloc_bytes;
+    printf ("{\"bench\":\"%s\",\"songs\":%u,\"ops\":%u,\"usec\":%" G_GINT64_FORMAT
+        ",\"ns_per_op\":%.1f,\"allocs\":%" G_GUINT64_FORMAT ",\"alloc_bytes\":%" G_GUINT64_FORMAT "}\n",
+        name, songs, ops, usec, ops > 0 ? usec * 1000.0 / ops : 0.0, allocs, bytes);
+    fflush (stdout);
+}
+
+static void _skipped (const gchar *name, guint songs)
+{
+    printf ("{\"bench\":\"%s\",\"songs\":%u,\"skipped\":\"quadratic\"}\n", name, songs);
+    fflush (stdout);
+}
+
+static void _free_songs (GList *l)
+{
+    g_list_free_full (l, (GDestroyNotify)song_delete);
+}
+
+static void _bench_lookups (BenchLibrary *lib, guint songs)
+{
+    BenchMark m;
+    gint len = playlist_length ();
+    gint index[LOOKUPS];
+    Song *found[LOOKUPS];
+    volatile gint sum = 0;
+
+    for (guint i = 0; i < LOOKUPS; i++) index[i] = g_rand_int_range (lib->rand, 0, len);
+
+    _begin (&m);
+    for (guint i = 0; i < LOOKUPS; i++) found[i] = playlist_get_nth_song_no_set (index[i]);
+    _end (&m, "nth", songs, LOOKUPS);
+
+    _begin (&m);
+    for (guint i = 0; i < LOOKUPS; i++) sum += playlist_get_song_index (found[i]);
+    _end (&m, "index", songs, LOOKUPS);
+    (void)sum;
+}
+
+static void _bench_suffle (guint songs)
+{
+    BenchMark m;
+    if (songs > _quadratic_max) {
+        _skipped ("suffle", songs);
+        return;
+    }
+    _begin (&m);
+    playlist_mode_set (PLAYLIST_MODE_SUFFLE);
+    _end (&m, "suffle", songs, songs);
+    playlist_mode_set (PLAYLIST_MODE_STANDARD);
+}
+
+static void _bench_copy_paste (guint songs)
+{
+    BenchMark m;
+    gint first = playlist_length () / 4;
+
+    _begin (&m);
+    playlist_copy_range (first, first + COPY_SONGS - 1);
+    playlist_paste_to (playlist_length () / 2);
+    _end (&m, "copy_paste", songs, COPY_SONGS);
+
+    _begin (&m);
+    playlist_cut_range (first, first + COPY_SONGS - 1);
+    playlist_paste_to (-1);
+    _end (&m, "cut_paste", songs, COPY_SONGS);
+}
+
+static void _bench_search (BenchLibrary *lib, guint songs)
+{
+    BenchMark m;
+    if (songs > _quadratic_max) {
+        _skipped ("search_set", songs);
+        _skipped ("search_next", songs);
+        return;
+    }
+    /* artist in the middle of popularity */
+    const gchar *artist = lib->artists[lib->num_artists / 8];
+
+    _begin (&m);
+    playlist_search_set (artist, 0, FALSE, TRUE);
+    _end (&m, "search_set", songs, 1);
+
+    _begin (&m);
+    for (guint i = 0; i < SEARCH_NEXTS; i++) playlist_search_next ();
+    _end (&m, "search_next", songs, SEARCH_NEXTS);
+
+    playlist_search_set (NULL, 0, FALSE, FALSE);
+}
+
+static void _bench_line (guint songs)
+{
+    BenchMark m;
+    gchar line[ABSOLUTELY_MAX_LINE_LEN];
+    guint ops = 0;
+
+    _begin (&m);
+    for (GList *l = playlist_get (); l != NULL; l = l->next) {
+        playlist_line_create (line, ABSOLUTELY_MAX_LINE_LEN - 1, (Song *)l->data);
+        ops++;
+    }
+    _end (&m, "line", songs, ops);
+}
+
+static void _bench_files (guint songs, const gchar *dir)
+{
+    BenchMark m;
+    GList *l;
+    guint len = playlist_length ();
+    gchar *pls = g_build_filename (dir, "bench.pls", NULL);
+    gchar *m3u = g_build_filename (dir, "bench.m3u", NULL);
+
+    _begin (&m);
+    playlist_pls_save (playlist_get (), pls);
+    _end (&m, "pls_save", songs, len);
+
+    _begin (&m);
+    playlist_m3u_save (playlist_get (), m3u);
+    _end (&m, "m3u_save", songs, len);
+
+    /* only one copy of big playlist in memory */
+    playlist_free ();
+    playlist_init ();
+
+    _begin (&m);
+    l = playlist_pls_load (pls, NULL);
+    _end (&m, "pls_load", songs, g_list_length (l));
+    _free_songs (l);
+
+    _begin (&m);
+    l = playlist_m3u_load (m3u, NULL);
+    _end (&m, "m3u_load", songs, g_list_length (l));
+    _free_songs (l);
+
+    g_unlink (pls);
+    g_unlink (m3u);
+    g_free (pls);
+    g_free (m3u);
+}
+
+static void _bench_size (guint songs, guint32 seed, const gchar *dir)
+{
+    BenchMark m;
+    BenchLibrary lib;
+    GList *l;
+    gchar path[] = "bench";
+
+    playlist_init ();
+    srand (seed);
+    bench_library_init (&lib, songs, seed);
+
+    _begin (&m);
+    l = bench_library_generate (&lib, songs);
+    _end (&m, "generate", songs, songs);
+
+    _begin (&m);
+    inspector_stub_set_run_result (l);
+    playlist_add (path);
+    _end (&m, "add", songs, songs);
+
+    _bench_lookups (&lib, songs);
+    _bench_suffle (songs);
+    _bench_copy_paste (songs);
+    _bench_search (&lib, songs);
+    _bench_line (songs);
+    _bench_files (songs, dir);
+
+    playlist_free ();
+    bench_library_clear (&lib);
+}
+
+static void _usage (const char *name)
+{
+    fprintf (stderr, "Usage: %s [-s sizes] [-q max] [-r seed]\n"
+        "  -s  comma separated playlist sizes, default " DEFAULT_SIZES "\n"
+        "  -q  largest playlist for benchmarks which are quadratic, default %d\n"
+        "  -r  random seed, default %d\n", name, DEFAULT_QUADRATIC_MAX, DEFAULT_SEED);
+}
+
+int main (int argc, char **argv)
+{
+    const gchar *sizes = DEFAULT_SIZES;
+    guint32 seed = DEFAULT_SEED;
+    gchar **split = NULL;
+    gchar *dir = NULL;
+    int ret = 0;
+    int c;
+
+    while ((c = getopt (argc, argv, "hs:q:r:")) != -1) {
+        switch (c) {
+        case 's':
+            sizes = optarg;
+            break;
+        case 'q':
+            _quadratic_max = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'r':
+            seed = (guint32)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'h':
+            _usage (argv[0]);
+            return 0;
+        default:
+            _usage (argv[0]);
+            return 1;
+        }
+    }
+
+    dir = g_dir_make_tmp ("kilikali-nc-bench-XXXXXX", NULL);
+    if (dir == NULL) {
+        fprintf (stderr, "Can not create temporary directory\n");
+        return 1;
+    }
+    if (bench_config_init (dir) == FALSE) {
+        fprintf (stderr, "Can not initialize config\n");
+        ret = 1;
+        goto bench_error;
+    }
+
+    split = g_strsplit (sizes, ",", -1);
+    for (gchar **p = split; *p != NULL; p++) {
+        guint songs = (guint)g_ascii_strtoull (*p, NULL, 10);
+        if (songs == 0 || songs > G_MAXINT / 2) {
+            fprintf (stderr, "Bad size: %s\n", *p);
+            ret = 1;
+            break;
+        }
+        _bench_size (songs, seed, dir);
+    }
+    g_strfreev (split);
+
+bench_error:
+    bench_config_free ();
+    g_rmdir (dir);
+    g_free (dir);
+    return ret;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/*
+ * Inspector backend for benchmarks. Nothing is decoded: files are
+ * classified by suffix and tags come from sidecar "<file>.tags" with
+ * key=value lines, or from path "Artist/Album/NN - Title.ext". Results
+ * depend only on the path, so runs can be compared.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "inspector-backend.h"
+#include "inspector-backend-fake.h"
+#include "sid.h"
+
+#define SIDECAR_SUFFIX ".tags"
+
+typedef struct {
+    const gchar *suffix;
+    SongType type;
+    const gchar *codec;
+} FakeFormat;
+
+static const FakeFormat _formats[] = {
+    { "flac", SONG_TYPE_FILE, "FLAC" },
+    { "mp3", SONG_TYPE_FILE, "MPEG-1 Layer 3 (MP3)" },
+    { "ogg", SONG_TYPE_FILE, "Vorbis" },
+    { "opus", SONG_TYPE_FILE, "Opus" },
+    { "m4a", SONG_TYPE_FILE, "MPEG-4 AAC" },
+    { "wav", SONG_TYPE_FILE, "WAV" },
+    { "sid", SONG_TYPE_SID, "SID" },
+    { "mod", SONG_TYPE_MOD, "MOD" },
+    { "xm", SONG_TYPE_MOD, "XM" },
+    { "s3m", SONG_TYPE_MOD, "S3M" },
+    { "it", SONG_TYPE_MOD, "IT" }
+};
+
+static guint _probe_usec = 0;
+static guint _classify_usec = 0;
+static guint _probes = 0; /* atomic */
+
+static const FakeFormat *_format (const gchar *path);
+static gboolean _read_sidecar (const gchar *path, Song *s);
+static void _parse_path (const gchar *path, Song *s);
+
+void inspector_backend_fake_set_latency (guint probe_usec, guint classify_usec)
+{
+    _probe_usec = probe_usec;
+    _classify_usec = classify_usec;
+}
+
+guint inspector_backend_fake_probes (void)
+{
+    return g_atomic_int_get (&_probes);
+}
+
+gboolean inspector_backend_init (void)
+{
+    g_atomic_int_set (&_probes, 0);
+    return TRUE;
+}
+
+void inspector_backend_free (void)
+{
+}
+
+const gchar *inspector_backend_name (void)
+{
+    return "fake";
+}
+
+gboolean inspector_backend_uri_is_valid (const gchar *uri)
+{
+    gboolean ret;
+    gchar *scheme = g_uri_parse_scheme (uri);
+    ret = scheme != NULL;
+    g_free (scheme);
+    return ret;
+}
+
+gchar *inspector_backend_filename_to_uri (const gchar *path)
+{
+    return g_filename_to_uri (path, NULL, NULL);
+}
+
+gboolean inspector_backend_is_possibly_supported (const gchar *filepath)
+{
+    if (_classify_usec > 0) g_usleep (_classify_usec);
+    return _format (filepath) != NULL;
+}
+
+guint inspector_backend_quarantine_clear (void)
+{
+    return 0;
+}
+
+InspectorProbeResult inspector_backend_try_uri (const gchar *uri, Song *s)
+{
+    const FakeFormat *format;
+    gchar *path;
+    guint hash;
+
+    g_atomic_int_inc (&_probes);
+    if (_probe_usec > 0) g_usleep (_probe_usec);
+    if (s->type == SONG_TYPE_STREAM) return INSPECTOR_PROBE_FOUND;
+
+    path = g_filename_from_uri (uri, NULL, NULL);
+    if (path == NULL) return INSPECTOR_PROBE_FAILED;
+    format = _format (path);
+    if (format == NULL) {
+        g_free (path);
+        return INSPECTOR_PROBE_NOT_PLAYABLE;
+    }
+
+    hash = g_str_hash (path);
+    song_set_duration (s, (90 + hash % 420) * 1000);
+    song_set_codec (s, format->codec);
+    if (_read_sidecar (path, s) == FALSE) _parse_path (path, s);
+
+    if (format->type == SONG_TYPE_SID) {
+        song_set_type (s, SONG_TYPE_SID);
+        sid_setup_song (s, 1 + hash % 4);
+    } else if (format->type == SONG_TYPE_MOD) {
+        song_set_type (s, SONG_TYPE_MOD);
+    }
+    g_free (path);
+    return INSPECTOR_PROBE_FOUND;
+}
+
+gboolean inspector_backend_probe_stream (const gchar *uri)
+{
+    (void)uri;
+    g_atomic_int_inc (&_probes);
+    if (_probe_usec > 0) g_usleep (_probe_usec);
+    return TRUE;
+}
+
+gint inspector_backend_sid_tunes (guint tunes)
+{
+    return tunes;
+}
+
+static const FakeFormat *_format (const gchar *path)
+{
+    const gchar *suffix = strrchr (path, '.');
+    if (suffix == NULL || strchr (suffix, G_DIR_SEPARATOR) != NULL) return NULL;
+    suffix++;
+    for (guint i = 0; i < G_N_ELEMENTS (_formats); i++) {
+        if (g_ascii_strcasecmp (suffix, _formats[i].suffix) == 0) return &_formats[i];
+    }
+    return NULL;
+}
+
+/* artist, album, title, track, year and duration (ms) */
+static gboolean _read_sidecar (const gchar *path, Song *s)
+{
+    gchar *sidecar = g_strconcat (path, SIDECAR_SUFFIX, NULL);
+    gchar *content = NULL;
+    gchar **lines;
+
+    if (g_file_get_contents (sidecar, &content, NULL, NULL) == FALSE) {
+        g_free (sidecar);
+        return FALSE;
+    }
+    lines = g_strsplit (content, "\n", -1);
+    for (gint i = 0; lines[i] != NULL; i++) {
+        gchar *value = strchr (lines[i], '=');
+        if (value == NULL) continue;
+        *value++ = '\0';
+        if (strcmp (lines[i], "artist") == 0) song_set_artist (s, value);
+        else if (strcmp (lines[i], "album") == 0) song_set_album (s, value);
+        else if (strcmp (lines[i], "title") == 0) song_set_title (s, value);
+        else if (strcmp (lines[i], "track") == 0) song_set_track (s, (guint)strtoul (value, NULL, 10));
+        else if (strcmp (lines[i], "year") == 0) song_set_year (s, (guint)strtoul (value, NULL, 10));
+        else if (strcmp (lines[i], "duration") == 0) song_set_duration (s, g_ascii_strtoll (value, NULL, 10));
+    }
+    g_strfreev (lines);
+    g_free (content);
+    g_free (sidecar);
+    return TRUE;
+}
+
+/* "Artist/Album/NN - Title.ext", otherwise title from file name */
+static void _parse_path (const gchar *path, Song *s)
+{
+    gchar *base = g_path_get_basename (path);
+    gchar *dot = strrchr (base, '.');
+    gchar *title = base;
+    gchar *end = NULL;
+    guint64 track;
+
+    if (dot != NULL) *dot = '\0';
+    track = g_ascii_strtoull (base, &end, 10);
+    if (end != base && g_str_has_prefix (end, " - ") && end[3] != '\0') {
+        gchar *album_dir = g_path_get_dirname (path);
+        gchar *artist_dir = g_path_get_dirname (album_dir);
+        gchar *album = g_path_get_basename (album_dir);
+        gchar *artist = g_path_get_basename (artist_dir);
+        title = end + 3;
+        song_set_track (s, (guint)track);
+        song_set_album (s, album);
+        song_set_artist (s, artist);
+        g_free (album);
+        g_free (artist);
+        g_free (album_dir);
+        g_free (artist_dir);
+    }
+    song_set_title (s, title);
+    g_free (base);
+}
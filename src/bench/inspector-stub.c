@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/* Inspector for benchmarks: nothing is probed, songs are taken as they are */
+
+#include "inspector.h"
+#include "inspector-stub.h"
+
+static const gchar *_supported_streams[] = { "http://", "https://", "smb://", "ftp://", "ssh://" };
+
+static GList *_run_result = NULL;
+
+void inspector_stub_set_run_result (GList *l)
+{
+    _run_result = l;
+}
+
+gboolean inspector_init (ScreenStatusUpdateFunc status_update, ScreenStatusUpdateFunc playlist_update)
+{
+    (void)status_update;
+    (void)playlist_update;
+    return TRUE;
+}
+
+void inspector_free (void)
+{
+}
+
+const gchar *inspector_status (void)
+{
+    return "";
+}
+
+guint inspector_clear_quarantine (void)
+{
+    return 0;
+}
+
+GList *inspector_run (gchar *path)
+{
+    GList *l = _run_result;
+    (void)path;
+    _run_result = NULL;
+    return l;
+}
+
+GList *inspector_add_no_check (gchar *path)
+{
+    gchar *uri;
+    Song *s;
+    GList *l;
+
+    if (path == NULL) return NULL;
+    if (inspector_is_stream (path) == TRUE || g_str_has_prefix (path, "file://") == TRUE) {
+        uri = g_strdup (path);
+    } else {
+        uri = g_filename_to_uri (path, NULL, NULL);
+    }
+    if (uri == NULL) return NULL;
+    s = song_new (uri);
+    g_free (uri);
+    if (s == NULL) return NULL;
+    song_set_type (s, inspector_is_stream (s->uri) == TRUE ? SONG_TYPE_STREAM : SONG_TYPE_FILE);
+    l = g_list_append (NULL, s);
+    if (l == NULL) song_delete (s);
+    return l;
+}
+
+gboolean inspector_is_stream (const gchar *uri)
+{
+    if (uri == NULL) return FALSE;
+    for (gint i = 0; i < sizeof (_supported_streams) / sizeof (char *); i++) {
+        if (g_str_has_prefix (uri, _supported_streams[i]) == TRUE) return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean inspector_is_remote_playlist (const gchar *path)
+{
+    (void)path;
+    return FALSE;
+}
+
+gboolean inspector_run_remote_playlist (const gchar *url, InspectorSongFoundFunc found, gpointer user_data)
+{
+    (void)url;
+    (void)found;
+    (void)user_data;
+    return FALSE;
+}
+
+gboolean inspector_try_uri (gchar *uri, Song *s)
+{
+    return uri != NULL && s != NULL;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/* Player for benchmarks: nothing is played */
+
+#include "player.h"
+
+static PlayerState _state = PLAYER_STATE_NULL;
+static guint8 _volume = PLAYER_VOLUME_MAX;
+static Song *_song = NULL;
+
+void player_preinit (int *argc, char **argv[])
+{
+    (void)argc;
+    (void)argv;
+}
+
+gboolean player_init (PlayerStatusUpdateFunc status_update_func)
+{
+    (void)status_update_func;
+    _state = PLAYER_STATE_STOPPED;
+    return TRUE;
+}
+
+void player_free (void)
+{
+    _state = PLAYER_STATE_NULL;
+    _song = NULL;
+}
+
+gint player_set_song (Song *s)
+{
+    _song = s;
+    return 0;
+}
+
+void player_preroll (Song *s, gint tune)
+{
+    (void)s;
+    (void)tune;
+}
+
+gboolean player_is_prerolled (Song *s, gint tune)
+{
+    (void)s;
+    (void)tune;
+    return FALSE;
+}
+
+/* Never playing, so screen does not start time updates */
+PlayerState player_play (void)
+{
+    if (_song != NULL) _state = PLAYER_STATE_PAUSED;
+    return _state;
+}
+
+PlayerState player_toggle_playpause (void)
+{
+    return player_play ();
+}
+
+PlayerState player_pause (void)
+{
+    return player_play ();
+}
+
+PlayerState player_stop (void)
+{
+    _state = PLAYER_STATE_STOPPED;
+    return _state;
+}
+
+gboolean player_seek (gint64 ms)
+{
+    (void)ms;
+    return FALSE;
+}
+
+gboolean player_seek_to (gint64 ms)
+{
+    (void)ms;
+    return FALSE;
+}
+
+gboolean player_get_duration (gint64 *ms)
+{
+    if (_song == NULL || ms == NULL) return FALSE;
+    *ms = _song->duration;
+    return TRUE;
+}
+
+guint8 player_set_volume (guint8 volume)
+{
+    _volume = MIN (volume, PLAYER_VOLUME_MAX);
+    return _volume;
+}
+
+guint8 player_volume_up (guint8 num)
+{
+    return player_set_volume (MIN (_volume + num, PLAYER_VOLUME_MAX));
+}
+
+guint8 player_volume_down (guint8 num)
+{
+    return player_set_volume (_volume > num ? _volume - num : PLAYER_VOLUME_MIN);
+}
+
+guint8 player_volume (void)
+{
+    return _volume;
+}
+
+PlayerState player_state (void)
+{
+    return _state;
+}
+
+gint64 player_get_current_time (void)
+{
+    return 0;
+}
+
+gint player_set_sid_tune (gint tune)
+{
+    return tune;
+}
+
+gboolean player_apply_sid_tune (void)
+{
+    return FALSE;
+}
+
+void player_stream_status (PlayerStreamStatus *status)
+{
+    if (status == NULL) return;
+    status->buffer_percent = 100;
+    status->underruns = 0;
+    status->reconnects = 0;
+    status->reconnecting = FALSE;
+}
+
+gchar *player_diagnostics (void)
+{
+    return NULL;
+}
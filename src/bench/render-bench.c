@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/*
+ * Headless render benchmark. Screen is drawn with newterm to a pipe and a
+ * scripted key sequence is replayed over a generated playlist. Time, calls
+ * to ncurses and bytes to terminal are printed per step as JSON, one object
+ * per line. ncurses calls are counted with ld --wrap, see Makefile.
+ */
+
+#define _GNU_SOURCE /* F_SETPIPE_SZ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <stdarg.h>
+#include <ncurses.h>
+#include <glib/gstdio.h>
+
+#include "ncurses-screen.h"
+#include "playlist.h"
+#include "inspector-stub.h"
+#include "bench-common.h"
+
+#define DEFAULT_SONGS 10000
+#define DEFAULT_SEED 1984
+#define DEFAULT_COLUMNS 160
+#define DEFAULT_LINES 50
+#define DEFAULT_TERM "xterm-256color"
+#define FILEBROWSER_FILES 2000
+#define PIPE_SIZE (1024 * 1024)
+
+typedef struct {
+    const gchar *name;
+    const gchar *keys; /* one key event per byte */
+    guint repeat;
+} RenderStep;
+
+typedef struct {
+    guint frames;
+    gint64 usec;
+    gint64 max_usec;
+    guint64 calls;
+    guint64 bytes;
+} RenderStats;
+
+/* default keys */
+static const RenderStep _script[] = {
+    { "scroll", "j", 300 },
+    { "scroll", "k", 100 },
+    { "scroll", "\005", 50 },    /* ^E */
+    { "page", "\006", 40 },      /* ^F */
+    { "page", "\002", 20 },      /* ^B */
+    { "page", "\004", 20 },      /* ^D */
+    { "page", "\025", 20 },      /* ^U */
+    { "page", "Ggg", 5 },
+    { "search", "/ka\n", 1 },
+    { "search", "n", 5 },
+    { "search", "\033", 1 },     /* ESC */
+    { "edit_select", "eV", 1 },
+    { "edit_select", "j", 50 },
+    { "edit_select", "\n\033", 1 },
+    { "filebrowser", "a", 1 },
+    { "filebrowser", "j", 200 },
+    { "filebrowser", "\006", 10 },
+    { "filebrowser", "Ggg\033", 1 },
+    { "help", "h", 1 },
+    { "help", "j", 50 },
+    { "help", "\006", 10 },
+    { "help", "\033", 1 }
+};
+
+static guint _songs = DEFAULT_SONGS;
+static gint _columns = DEFAULT_COLUMNS;
+static gint _lines = DEFAULT_LINES;
+static gboolean _every_frame = FALSE;
+static FILE *_out = NULL;
+static int _out_read = -1;
+
+/* Calls to ncurses from the screen code */
+static guint64 _calls = 0;
+
+int __real_wrefresh (WINDOW *win);
+int __real_wclear (WINDOW *win);
+int __real_wmove (WINDOW *win, int y, int x);
+int __real_waddch (WINDOW *win, const chtype ch);
+int __real_wattr_on (WINDOW *win, attr_t attrs, void *opts);
+int __real_wattr_off (WINDOW *win, attr_t attrs, void *opts);
+
+int __wrap_wrefresh (WINDOW *win)
+{
+    _calls++;
+    return __real_wrefresh (win);
+}
+
+int __wrap_wclear (WINDOW *win)
+{
+    _calls++;
+    return __real_wclear (win);
+}
+
+int __wrap_wmove (WINDOW *win, int y, int x)
+{
+    _calls++;
+    return __real_wmove (win, y, x);
+}
+
+int __wrap_waddch (WINDOW *win, const chtype ch)
+{
+    _calls++;
+    return __real_waddch (win, ch);
+}
+
+int __wrap_wattr_on (WINDOW *win, attr_t attrs, void *opts)
+{
+    _calls++;
+    return __real_wattr_on (win, attrs, opts);
+}
+
+int __wrap_wattr_off (WINDOW *win, attr_t attrs, void *opts)
+{
+    _calls++;
+    return __real_wattr_off (win, attrs, opts);
+}
+
+int __wrap_mvwprintw (WINDOW *win, int y, int x, const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+    _calls++;
+    if (__real_wmove (win, y, x) == ERR) return ERR;
+    va_start (args, fmt);
+    ret = vw_printw (win, fmt, args);
+    va_end (args);
+    return ret;
+}
+
+int __wrap_wprintw (WINDOW *win, const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+    _calls++;
+    va_start (args, fmt);
+    ret = vw_printw (win, fmt, args);
+    va_end (args);
+    return ret;
+}
+
+/* bytes written to terminal since last call */
+static guint64 _drain (void)
+{
+    gchar buf[65536];
+    guint64 bytes = 0;
+    ssize_t n;
+    fflush (_out);
+    while ((n = read (_out_read, buf, sizeof (buf))) > 0) bytes += n;
+    return bytes;
+}
+
+static void _print (const gchar *name, const gchar *step, RenderStats *st)
+{
+    guint frames = MAX (st->frames, 1);
+    printf ("{\"bench\":\"%s\",\"step\":\"%s\",\"songs\":%u,\"columns\":%d,\"lines\":%d,"
+        "\"frames\":%u,\"usec\":%" G_GINT64_FORMAT ",\"usec_per_frame\":%.1f,"
+        "\"max_frame_usec\":%" G_GINT64_FORMAT ",\"ncurses_calls_per_frame\":%.1f,"
+        "\"bytes_per_frame\":%.1f,\"bytes\":%" G_GUINT64_FORMAT "}\n",
+        name, step, _songs, _columns, _lines, st->frames, st->usec, (gdouble)st->usec / frames,
+        st->max_usec, (gdouble)st->calls / frames, (gdouble)st->bytes / frames, st->bytes);
+    fflush (stdout);
+}
+
+/* Handles event and draws everything it queued */
+static void _frame (const gchar *step, NCursesEvent *e, RenderStats *st)
+{
+    RenderStats frame = { .frames = 1 };
+    guint64 calls = _calls;
+    gint64 start = g_get_monotonic_time ();
+
+    if (e != NULL) ncurses_screen_event (e);
+    while (g_main_context_iteration (NULL, FALSE));
+
+    frame.usec = frame.max_usec = g_get_monotonic_time () - start;
+    frame.calls = _calls - calls;
+    frame.bytes = _drain ();
+    if (_every_frame == TRUE) _print ("render_frame", step, &frame);
+
+    st->frames++;
+    st->usec += frame.usec;
+    st->max_usec = MAX (st->max_usec, frame.usec);
+    st->calls += frame.calls;
+    st->bytes += frame.bytes;
+}
+
+static void _run_script (void)
+{
+    RenderStats st = {0,};
+    const gchar *step = "init";
+
+    _frame (step, NULL, &st); /* first draw */
+    for (guint i = 0; i < G_N_ELEMENTS (_script); i++) {
+        if (strcmp (step, _script[i].name) != 0) {
+            _print ("render", step, &st);
+            memset (&st, 0, sizeof (st));
+            step = _script[i].name;
+        }
+        for (guint r = 0; r < _script[i].repeat; r++) {
+            for (const gchar *k = _script[i].keys; *k != '\0'; k++) {
+                NCursesEvent e = {0,};
+                e.type = NCURSES_EVENT_TYPE_CH;
+                e.ch = (unsigned char)*k;
+                e.size = 1;
+                _frame (step, &e, &st);
+            }
+        }
+    }
+    _print ("render", step, &st);
+}
+
+/* files for filebrowser */
+static gboolean _make_files (const gchar *dir, BenchLibrary *lib)
+{
+    for (guint i = 0; i < FILEBROWSER_FILES; i++) {
+        gchar name[NAME_MAX];
+        gchar *path;
+        gboolean ret;
+        g_snprintf (name, sizeof (name), "%04u - %s.flac", i, lib->artists[i % lib->num_artists]);
+        path = g_build_filename (dir, name, NULL);
+        ret = g_file_set_contents (path, "", 0, NULL);
+        g_free (path);
+        if (ret == FALSE) return FALSE;
+    }
+    return TRUE;
+}
+
+static void _remove_files (const gchar *dir)
+{
+    const gchar *name;
+    GDir *d = g_dir_open (dir, 0, NULL);
+    if (d == NULL) return;
+    while ((name = g_dir_read_name (d)) != NULL) {
+        gchar *path = g_build_filename (dir, name, NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_dir_close (d);
+}
+
+static void _usage (const char *name)
+{
+    fprintf (stderr, "Usage: %s [-n songs] [-W columns] [-H lines] [-t term] [-r seed] [-f]\n"
+        "  -n  playlist size, default %d\n"
+        "  -W  terminal columns, default %d\n"
+        "  -H  terminal lines, default %d\n"
+        "  -t  terminal type, default " DEFAULT_TERM "\n"
+        "  -r  random seed, default %d\n"
+        "  -f  print also every frame\n",
+        name, DEFAULT_SONGS, DEFAULT_COLUMNS, DEFAULT_LINES, DEFAULT_SEED);
+}
+
+int main (int argc, char **argv)
+{
+    const gchar *term = DEFAULT_TERM;
+    guint32 seed = DEFAULT_SEED;
+    BenchLibrary lib = {0,};
+    gchar path[] = "bench";
+    gchar size[16];
+    gchar *dir = NULL;
+    FILE *in = NULL;
+    int fds[2] = { -1, -1 };
+    int ret = 1;
+    int c;
+
+    while ((c = getopt (argc, argv, "hn:W:H:t:r:f")) != -1) {
+        switch (c) {
+        case 'n':
+            _songs = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'W':
+            _columns = (gint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'H':
+            _lines = (gint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 't':
+            term = optarg;
+            break;
+        case 'r':
+            seed = (guint32)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'f':
+            _every_frame = TRUE;
+            break;
+        case 'h':
+            _usage (argv[0]);
+            return 0;
+        default:
+            _usage (argv[0]);
+            return 1;
+        }
+    }
+    if (_songs == 0 || _columns < 1 || _lines < 1) {
+        _usage (argv[0]);
+        return 1;
+    }
+
+    setlocale (LC_ALL, "");
+    setlocale (LC_NUMERIC, "C");
+
+    dir = g_dir_make_tmp ("kilikali-nc-render-bench-XXXXXX", NULL);
+    if (dir == NULL) {
+        fprintf (stderr, "Can not create temporary directory\n");
+        return 1;
+    }
+    if (bench_config_init (dir) == FALSE) {
+        fprintf (stderr, "Can not initialize config\n");
+        bench_config_free ();
+        g_rmdir (dir);
+        g_free (dir);
+        return 1;
+    }
+    playlist_init ();
+    bench_library_init (&lib, _songs, seed);
+    if (_make_files (dir, &lib) == FALSE || chdir (dir) != 0) {
+        fprintf (stderr, "Can not create files for filebrowser\n");
+        goto render_bench_error;
+    }
+
+    inspector_stub_set_run_result (bench_library_generate (&lib, _songs));
+    playlist_add (path);
+
+    /* terminal size from environment, pipe is not a tty */
+    g_snprintf (size, sizeof (size), "%d", _columns);
+    g_setenv ("COLUMNS", size, TRUE);
+    g_snprintf (size, sizeof (size), "%d", _lines);
+    g_setenv ("LINES", size, TRUE);
+
+    if (pipe (fds) != 0) goto render_bench_error;
+    (void)fcntl (fds[0], F_SETPIPE_SZ, PIPE_SIZE); /* one frame must fit */
+    if (fcntl (fds[0], F_SETFL, O_NONBLOCK) != 0) goto render_bench_error;
+    _out_read = fds[0];
+    _out = fdopen (fds[1], "w");
+    in = fopen ("/dev/null", "r");
+    if (_out == NULL || in == NULL) goto render_bench_error;
+    fds[1] = -1; /* closed with _out */
+
+    if (ncurses_screen_init_term (term, _out, in) == FALSE) {
+        fprintf (stderr, "Can not initialize screen to %s terminal\n", term);
+        goto render_bench_error;
+    }
+    _run_script ();
+    ncurses_screen_free ();
+    ret = 0;
+
+render_bench_error:
+    playlist_free ();
+    if (lib.rand != NULL) bench_library_clear (&lib);
+    if (_out != NULL) fclose (_out);
+    if (in != NULL) fclose (in);
+    if (fds[0] >= 0) close (fds[0]);
+    if (fds[1] >= 0) close (fds[1]);
+    bench_config_free ();
+    _remove_files (dir);
+    g_rmdir (dir);
+    g_free (dir);
+    return ret;
+}
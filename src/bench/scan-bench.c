@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/*
+ * Headless benchmark for adding a directory: walk, classify, probe, SID
+ * lookup and insert to playlist. Tree of empty files is generated and
+ * inspector uses fake backend, so only the scan pipeline is measured.
+ * Results are printed to stdout as JSON, one object per line.
+ */
+
+#define _GNU_SOURCE /* nftw */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <glib/gstdio.h>
+
+#include "inspector.h"
+#include "inspector-backend-fake.h"
+#include "playlist.h"
+#include "paths.h"
+#include "bench-common.h"
+
+#define DEFAULT_SIZES "10000,100000,1000000"
+#define DEFAULT_SEED 1984
+#define CHUNK 10000 /* songs generated at a time */
+#define MUSIC_PREFIX "/music/"
+
+typedef struct {
+    guint files; /* audio and other files */
+    guint dirs;
+} BenchTree;
+
+static void _report (const gchar *name, guint files, gint64 usec, gint songs)
+{
+    printf ("{\"bench\":\"%s\",\"files\":%u,\"songs\":%d,\"probes\":%u,\"usec\":%" G_GINT64_FORMAT
+        ",\"ns_per_file\":%.1f,\"files_per_sec\":%.0f}\n",
+        name, files, songs, inspector_backend_fake_probes (), usec,
+        files > 0 ? usec * 1000.0 / files : 0.0, usec > 0 ? files * 1000000.0 / usec : 0.0);
+    fflush (stdout);
+}
+
+static gboolean _touch (const gchar *path, BenchTree *tree)
+{
+    int fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return FALSE;
+    close (fd);
+    tree->files++;
+    return TRUE;
+}
+
+/* streams of library are turned to sids, untagged files get sidecars */
+static gboolean _make_song (const gchar *root, Song *s, guint index, gchar **last_dir, BenchTree *tree)
+{
+    gboolean ret = FALSE;
+    gchar *rel = NULL;
+    gchar *path;
+    gchar *dir;
+
+    if (s->type == SONG_TYPE_STREAM) {
+        rel = g_strdup_printf ("C64 Music/%02u/%s_%u.sid", index % 97,
+            s->stream_title != NULL ? s->stream_title : "Tune", index);
+    } else {
+        gchar *filename = g_filename_from_uri (s->uri, NULL, NULL);
+        if (filename != NULL && g_str_has_prefix (filename, MUSIC_PREFIX)) {
+            rel = g_strdup (filename + strlen (MUSIC_PREFIX));
+        }
+        g_free (filename);
+    }
+    if (rel == NULL) return FALSE;
+
+    path = g_build_filename (root, rel, NULL);
+    dir = g_path_get_dirname (path);
+    if (*last_dir == NULL || strcmp (dir, *last_dir) != 0) {
+        if (g_mkdir_with_parents (dir, 0755) != 0) goto make_song_error;
+        g_free (*last_dir);
+        *last_dir = g_strdup (dir);
+        tree->dirs++;
+        /* junk which must be rejected */
+        if (index % 4 == 0) {
+            gchar *cover = g_build_filename (dir, "cover.jpg", NULL);
+            (void)_touch (cover, tree);
+            g_free (cover);
+        }
+    }
+    if (_touch (path, tree) == FALSE) goto make_song_error;
+
+    if (s->type == SONG_TYPE_FILE && s->artist == NULL) {
+        gchar *sidecar = g_strconcat (path, ".tags", NULL);
+        gchar *content = g_strdup_printf ("artist=Unknown %u\ntitle=Track %u\nduration=%u\n",
+            index % 50, index, 60000 + index % 300000);
+        if (g_file_set_contents (sidecar, content, -1, NULL) == TRUE) tree->files++;
+        g_free (content);
+        g_free (sidecar);
+    }
+    ret = TRUE;
+make_song_error:
+    g_free (dir);
+    g_free (path);
+    g_free (rel);
+    return ret;
+}
+
+static gboolean _make_tree (const gchar *root, guint songs, guint32 seed, BenchTree *tree)
+{
+    BenchLibrary lib;
+    gchar *last_dir = NULL;
+    gboolean ret = TRUE;
+    guint index = 0;
+
+    bench_library_init (&lib, songs, seed);
+    while (ret == TRUE && index < songs) {
+        GList *l = bench_library_generate (&lib, MIN (CHUNK, songs - index));
+        for (GList *p = l; p != NULL; p = p->next) {
+            if (_make_song (root, (Song *)p->data, index++, &last_dir, tree) == FALSE) ret = FALSE;
+        }
+        g_list_free_full (l, (GDestroyNotify)song_delete);
+    }
+    g_free (last_dir);
+    bench_library_clear (&lib);
+    return ret;
+}
+
+static int _remove_entry (const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove (path);
+}
+
+static void _remove_tree (const gchar *dir)
+{
+    (void)nftw (dir, _remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+static void _remove_negative_cache (void)
+{
+    gchar *path = paths_saved_data_negative_cache ();
+    if (path != NULL) g_unlink (path);
+    g_free (path);
+}
+
+static gboolean _bench_size (const gchar *dir, guint songs, guint32 seed)
+{
+    BenchTree tree = {0,};
+    gboolean ret = FALSE;
+    gchar name[32];
+    gchar *root;
+    gint64 start;
+    GList *l;
+
+    g_snprintf (name, sizeof (name), "tree-%u", songs);
+    root = g_build_filename (dir, name, NULL);
+
+    start = g_get_monotonic_time ();
+    if (_make_tree (root, songs, seed, &tree) == FALSE) {
+        fprintf (stderr, "Can not create files to %s\n", root);
+        goto bench_size_error;
+    }
+    printf ("{\"bench\":\"make_tree\",\"files\":%u,\"dirs\":%u,\"usec\":%" G_GINT64_FORMAT "}\n",
+        tree.files, tree.dirs, g_get_monotonic_time () - start);
+    fflush (stdout);
+
+    if (inspector_init (NULL, NULL) == FALSE) goto bench_size_error;
+
+    /* negative cache is empty, every file is classified */
+    start = g_get_monotonic_time ();
+    l = inspector_run (root);
+    _report ("scan", tree.files, g_get_monotonic_time () - start, (gint)g_list_length (l));
+    g_list_free_full (l, (GDestroyNotify)song_delete);
+
+    /* junk is known now. songs are inserted to playlist */
+    start = g_get_monotonic_time ();
+    (void)playlist_add (root);
+    _report ("rescan_add", tree.files, g_get_monotonic_time () - start, playlist_length ());
+
+    playlist_free ();
+    playlist_init ();
+    inspector_free ();
+    ret = TRUE;
+
+bench_size_error:
+    _remove_negative_cache ();
+    _remove_tree (root);
+    g_free (root);
+    return ret;
+}
+
+static void _usage (const char *name)
+{
+    fprintf (stderr, "Usage: %s [-s sizes] [-l usec] [-c usec] [-r seed]\n"
+        "  -s  comma separated song counts, default " DEFAULT_SIZES "\n"
+        "  -l  latency of each probe in microseconds, default 0\n"
+        "  -c  latency of each classify in microseconds, default 0\n"
+        "  -r  random seed, default %d\n",
+        name, DEFAULT_SEED);
+}
+
+int main (int argc, char **argv)
+{
+    const gchar *sizes = DEFAULT_SIZES;
+    guint32 seed = DEFAULT_SEED;
+    guint probe_usec = 0;
+    guint classify_usec = 0;
+    gchar **split = NULL;
+    gchar *dir = NULL;
+    int ret = 0;
+    int c;
+
+    while ((c = getopt (argc, argv, "hs:l:c:r:")) != -1) {
+        switch (c) {
+        case 's':
+            sizes = optarg;
+            break;
+        case 'l':
+            probe_usec = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'c':
+            classify_usec = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'r':
+            seed = (guint32)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'h':
+            _usage (argv[0]);
+            return 0;
+        default:
+            _usage (argv[0]);
+            return 1;
+        }
+    }
+
+    dir = g_dir_make_tmp ("kilikali-nc-scan-bench-XXXXXX", NULL);
+    if (dir == NULL) {
+        fprintf (stderr, "Can not create temporary directory\n");
+        return 1;
+    }
+    /* negative cache is saved under home */
+    g_setenv ("HOME", dir, TRUE);
+    if (bench_config_init (dir) == FALSE) {
+        fprintf (stderr, "Can not initialize config\n");
+        ret = 1;
+        goto scan_bench_error;
+    }
+    playlist_init ();
+    inspector_backend_fake_set_latency (probe_usec, classify_usec);
+
+    split = g_strsplit (sizes, ",", -1);
+    for (gchar **p = split; *p != NULL; p++) {
+        guint songs = (guint)g_ascii_strtoull (*p, NULL, 10);
+        if (songs == 0 || songs > G_MAXINT / 2) {
+            fprintf (stderr, "Bad size: %s\n", *p);
+            ret = 1;
+            break;
+        }
+        if (_bench_size (dir, songs, seed) == FALSE) {
+            ret = 1;
+            break;
+        }
+    }
+    g_strfreev (split);
+    playlist_free ();
+
+scan_bench_error:
+    bench_config_free ();
+    _remove_tree (dir);
+    g_free (dir);
+    return ret;
+}
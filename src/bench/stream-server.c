@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+/*
+ * Local HTTP radio for testing stream buffering and reconnects. Serves an
+ * endless 441 Hz WAV at real time rate, one client at a time. Connections
+ * can be dropped and stalled on purpose. Play it with
+ * kilikali-nc http://127.0.0.1:8000/radio.wav
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <glib.h>
+
+#define RATE 44100
+#define CHANNELS 2
+#define BYTES_PER_FRAME (CHANNELS * 2)
+#define PERIOD 100 /* frames, 441 Hz */
+#define CHUNK_MS 20
+#define DEFAULT_PORT 8000
+
+typedef struct {
+    guint drop_sec;     /* close connection after, 0 = never */
+    guint stall_ms;     /* stop sending for */
+    guint stall_sec;    /* every, 0 = never */
+    guint burst_ms;     /* sent at once after connect */
+} ServerOptions;
+
+static gint16 _period[PERIOD * CHANNELS];
+
+static void _make_period (void);
+static gboolean _write_all (int fd, const void *data, gsize len);
+static gboolean _read_request (int fd);
+static void _serve (int fd, const ServerOptions *o, guint client);
+static void _usage (const char *name);
+
+static void _make_period (void)
+{
+    /* triangle, no libm needed */
+    for (gint i = 0; i < PERIOD; i++) {
+        gint v = i < PERIOD / 2 ? i : PERIOD - i;
+        gint16 s = (gint16)((v * 4 - PERIOD) * 8000 / PERIOD);
+        for (gint c = 0; c < CHANNELS; c++) _period[i * CHANNELS + c] = s;
+    }
+}
+
+static gboolean _write_all (int fd, const void *data, gsize len)
+{
+    const gchar *p = (const gchar *)data;
+    while (len > 0) {
+        ssize_t w = send (fd, p, len, MSG_NOSIGNAL);
+        if (w <= 0) return FALSE;
+        p += w;
+        len -= (gsize)w;
+    }
+    return TRUE;
+}
+
+/* headers are not looked at, only waited for */
+static gboolean _read_request (int fd)
+{
+    gchar buf[4096];
+    gsize have = 0;
+    while (have < sizeof (buf) - 1) {
+        ssize_t r = recv (fd, buf + have, sizeof (buf) - 1 - have, 0);
+        if (r <= 0) return FALSE;
+        have += (gsize)r;
+        buf[have] = '\0';
+        if (strstr (buf, "\r\n\r\n") != NULL) return TRUE;
+    }
+    return FALSE;
+}
+
+static void _serve (int fd, const ServerOptions *o, guint client)
+{
+    static const gchar header[] = "HTTP/1.0 200 OK\r\nContent-Type: audio/x-wav\r\nConnection: close\r\n\r\n";
+    guint8 wav[44];
+    guint32 u32;
+    guint16 u16;
+    gint64 start, sent_frames = 0, next_stall;
+    guint pos = 0;
+    gint16 chunk[RATE / 1000 * CHUNK_MS * CHANNELS];
+    const guint chunk_frames = RATE / 1000 * CHUNK_MS;
+
+    if (_read_request (fd) == FALSE) return;
+    if (_write_all (fd, header, sizeof (header) - 1) == FALSE) return;
+
+    /* endless stream: sizes are max */
+    memcpy (wav, "RIFF\xff\xff\xff\xffWAVEfmt ", 16);
+    u32 = GUINT32_TO_LE (16); memcpy (wav + 16, &u32, 4);
+    u16 = GUINT16_TO_LE (1); memcpy (wav + 20, &u16, 2);
+    u16 = GUINT16_TO_LE (CHANNELS); memcpy (wav + 22, &u16, 2);
+    u32 = GUINT32_TO_LE (RATE); memcpy (wav + 24, &u32, 4);
+    u32 = GUINT32_TO_LE (RATE * BYTES_PER_FRAME); memcpy (wav + 28, &u32, 4);
+    u16 = GUINT16_TO_LE (BYTES_PER_FRAME); memcpy (wav + 32, &u16, 2);
+    u16 = GUINT16_TO_LE (16); memcpy (wav + 34, &u16, 2);
+    memcpy (wav + 36, "data\xff\xff\xff\xff", 8);
+    if (_write_all (fd, wav, sizeof (wav)) == FALSE) return;
+
+    start = g_get_monotonic_time () - (gint64)o->burst_ms * 1000;
+    next_stall = o->stall_sec > 0 ? g_get_monotonic_time () + (gint64)o->stall_sec * G_USEC_PER_SEC : G_MAXINT64;
+    while (TRUE) {
+        gint64 now = g_get_monotonic_time ();
+        gint64 due = start + sent_frames * G_USEC_PER_SEC / RATE;
+        if (o->drop_sec > 0 && now - start > (gint64)o->drop_sec * G_USEC_PER_SEC) {
+            fprintf (stderr, "client %u: dropped\n", client);
+            return;
+        }
+        if (now >= next_stall) {
+            fprintf (stderr, "client %u: stall %u ms\n", client, o->stall_ms);
+            g_usleep ((gulong)o->stall_ms * 1000);
+            start += (gint64)o->stall_ms * 1000; /* stalled time is lost, not caught up */
+            next_stall = g_get_monotonic_time () + (gint64)o->stall_sec * G_USEC_PER_SEC;
+            continue;
+        }
+        if (due > now) {
+            g_usleep ((gulong)(due - now));
+            continue;
+        }
+        for (guint i = 0; i < chunk_frames; i++) {
+            memcpy (&chunk[i * CHANNELS], &_period[pos * CHANNELS], BYTES_PER_FRAME);
+            pos = (pos + 1) % PERIOD;
+        }
+        if (_write_all (fd, chunk, sizeof (chunk)) == FALSE) {
+            fprintf (stderr, "client %u: gone\n", client);
+            return;
+        }
+        sent_frames += chunk_frames;
+    }
+}
+
+static void _usage (const char *name)
+{
+    fprintf (stderr, "Usage: %s [-p port] [-d sec] [-s ms] [-i sec] [-b ms]\n"
+        "  -p  port on 127.0.0.1, default %d\n"
+        "  -d  drop connection after seconds, default never\n"
+        "  -s  stall sending for milliseconds\n"
+        "  -i  stall every seconds, default never\n"
+        "  -b  milliseconds of audio sent at once after connect, default 0\n",
+        name, DEFAULT_PORT);
+}
+
+int main (int argc, char **argv)
+{
+    ServerOptions o;
+    struct sockaddr_in addr;
+    guint16 port = DEFAULT_PORT;
+    guint client = 0;
+    int one = 1;
+    int sfd;
+    int c;
+
+    memset (&o, 0, sizeof (o));
+    while ((c = getopt (argc, argv, "hp:d:s:i:b:")) != -1) {
+        switch (c) {
+        case 'p':
+            port = (guint16)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'd':
+            o.drop_sec = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 's':
+            o.stall_ms = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'i':
+            o.stall_sec = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'b':
+            o.burst_ms = (guint)g_ascii_strtoull (optarg, NULL, 10);
+            break;
+        case 'h':
+            _usage (argv[0]);
+            return 0;
+        default:
+            _usage (argv[0]);
+            return 1;
+        }
+    }
+    _make_period ();
+
+    sfd = socket (AF_INET, SOCK_STREAM, 0);
+    if (sfd < 0) {
+        perror ("socket");
+        return 1;
+    }
+    (void)setsockopt (sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if (bind (sfd, (struct sockaddr *)&addr, sizeof (addr)) != 0 || listen (sfd, 4) != 0) {
+        perror ("bind");
+        close (sfd);
+        return 1;
+    }
+    fprintf (stderr, "http://127.0.0.1:%u/radio.wav\n", port);
+
+    while (TRUE) {
+        int fd = accept (sfd, NULL, NULL);
+        if (fd < 0) continue;
+        client++;
+        fprintf (stderr, "client %u: connected\n", client);
+        _serve (fd, &o, client);
+        close (fd);
+    }
+    close (sfd);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cmdline-path-cache.h"
+
+#define MAX_CACHED_DIRS 16
+
+typedef struct {
+    struct timespec mtime;
+    GArray *entries; /* CmdlinePathCacheEntry, sorted by name */
+} CachedDir;
+
+static GHashTable *_dirs = NULL; /* canonical dir path -> CachedDir */
+
+static void _cached_dir_free (gpointer data);
+static CachedDir *_read_dir (const gchar *dirpath, const struct stat *st);
+static gint _compare_entries (gconstpointer a, gconstpointer b);
+static guint _lower_bound (GArray *entries, const gchar *prefix);
+static guint _prefix_end (GArray *entries, guint from, const gchar *prefix, gsize len);
+
+const CmdlinePathCacheEntry *cmdline_path_cache_find (const gchar *dirpath, const gchar *prefix, guint *count)
+{
+    struct stat st;
+    CachedDir *cd;
+    gchar *key;
+    guint first, last;
+    gsize len;
+
+    *count = 0;
+    if (dirpath == NULL || prefix == NULL) return NULL;
+    if (stat (dirpath, &st) != 0 || !S_ISDIR (st.st_mode)) return NULL;
+
+    if (_dirs == NULL) {
+        _dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _cached_dir_free);
+        if (_dirs == NULL) return NULL;
+    }
+
+    key = g_canonicalize_filename (dirpath, NULL);
+    if (key == NULL) return NULL;
+
+    cd = (CachedDir *)g_hash_table_lookup (_dirs, key);
+    if (cd != NULL && (cd->mtime.tv_sec != st.st_mtim.tv_sec || cd->mtime.tv_nsec != st.st_mtim.tv_nsec)) {
+        g_hash_table_remove (_dirs, key); /* dir changed */
+        cd = NULL;
+    }
+    if (cd == NULL) {
+        cd = _read_dir (dirpath, &st);
+        if (cd == NULL) {
+            g_free (key);
+            return NULL;
+        }
+        if (g_hash_table_size (_dirs) >= MAX_CACHED_DIRS) g_hash_table_remove_all (_dirs);
+        g_hash_table_insert (_dirs, key, cd); /* takes key */
+    } else {
+        g_free (key);
+    }
+
+    len = strlen (prefix);
+    first = _lower_bound (cd->entries, prefix);
+    last = _prefix_end (cd->entries, first, prefix, len);
+    if (last <= first) return NULL;
+
+    *count = last - first;
+    return &g_array_index (cd->entries, CmdlinePathCacheEntry, first);
+}
+
+void cmdline_path_cache_free (void)
+{
+    if (_dirs != NULL) g_hash_table_destroy (_dirs);
+    _dirs = NULL;
+}
+
+static void _cached_dir_free (gpointer data)
+{
+    CachedDir *cd = (CachedDir *)data;
+    if (cd == NULL) return;
+    for (guint i = 0; i < cd->entries->len; i++) {
+        g_free (g_array_index (cd->entries, CmdlinePathCacheEntry, i).name);
+    }
+    g_array_free (cd->entries, TRUE);
+    g_free (cd);
+}
+
+static CachedDir *_read_dir (const gchar *dirpath, const struct stat *st)
+{
+    CachedDir *cd = NULL;
+    struct dirent *de;
+    DIR *dir = opendir (dirpath);
+    if (dir == NULL) return NULL;
+
+    cd = g_new0 (CachedDir, 1);
+    if (cd == NULL) goto read_dir_error;
+    cd->mtime = st->st_mtim;
+    cd->entries = g_array_new (FALSE, FALSE, sizeof (CmdlinePathCacheEntry));
+
+    while ((de = readdir (dir)) != NULL) {
+        CmdlinePathCacheEntry e;
+        if (strcmp (de->d_name, ".") == 0 || strcmp (de->d_name, "..") == 0) continue;
+
+        e.is_dir = FALSE;
+        if (de->d_type == DT_DIR) {
+            e.is_dir = TRUE;
+        } else if (de->d_type == DT_UNKNOWN || de->d_type == DT_LNK) {
+            /* no type from fs or symlink: follow it like g_file_test does */
+            struct stat est;
+            if (fstatat (dirfd (dir), de->d_name, &est, 0) == 0 && S_ISDIR (est.st_mode)) e.is_dir = TRUE;
+        }
+        e.name = g_strdup (de->d_name);
+        if (e.name == NULL) continue;
+        g_array_append_val (cd->entries, e);
+    }
+    g_array_sort (cd->entries, _compare_entries);
+
+read_dir_error:
+    closedir (dir);
+    return cd;
+}
+
+static gint _compare_entries (gconstpointer a, gconstpointer b)
+{
+    const CmdlinePathCacheEntry *ea = (const CmdlinePathCacheEntry *)a;
+    const CmdlinePathCacheEntry *eb = (const CmdlinePathCacheEntry *)b;
+    return strcmp (ea->name, eb->name);
+}
+
+/* first entry which is not less than prefix */
+static guint _lower_bound (GArray *entries, const gchar *prefix)
+{
+    guint lo = 0;
+    guint hi = entries->len;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (strcmp (g_array_index (entries, CmdlinePathCacheEntry, mid).name, prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* first entry after from which does not start with prefix */
+static guint _prefix_end (GArray *entries, guint from, const gchar *prefix, gsize len)
+{
+    guint lo = from;
+    guint hi = entries->len;
+    if (len == 0) return hi;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (strncmp (g_array_index (entries, CmdlinePathCacheEntry, mid).name, prefix, len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
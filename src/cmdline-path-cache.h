@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_CMDLINE_PATH_CACHE_H_
+#define _KK_CMDLINE_PATH_CACHE_H_
+
+#include <glib.h>
+
+typedef struct {
+    gchar *name;
+    gboolean is_dir;
+} CmdlinePathCacheEntry;
+
+/* Finds entries of the directory starting with prefix. Directory listing is
+ * read once, kept sorted by name and reread only when directory mtime changes.
+ *
+ * dirpath directory to list (already tilde expanded)
+ * prefix  name prefix. Empty string matches all entries.
+ * count   number of found entries
+ * return: first found entry or NULL if nothing found or dir could not be read.
+ *         Entries are owned by cache and valid until next call. */
+const CmdlinePathCacheEntry *cmdline_path_cache_find (const gchar *dirpath, const gchar *prefix, guint *count);
+
+void cmdline_path_cache_free (void);
+
+#endif
@@ -18,6 +18,7 @@
  */
 
 #include "cmdline.h"
+#include "cmdline-path-cache.h"
 #include "config.h"
 #include "util.h"
 
@@ -56,6 +57,8 @@ static void _select_dir_or_file (void);
 
 static void _free_found_items (void);
 static gboolean _has_found_items (void);
+static guint _found_len (GPtrArray *found);
+static void _free_path_item (gpointer data);
 
 static void _handle_tab (gboolean forward);
 
@@ -66,13 +69,13 @@ static void _line_remove_part (glong start_pos, glong end_pos);
 static void _line_add_utf8 (glong pos, gchar *str, gint len);
 static void _line_remove_utf8 (glong pos);
 
-static gint _sort_str (gconstpointer a, gconstpointer b);
+static gint _sort_item (gconstpointer a, gconstpointer b);
 
 static GSList *_commands;
-static GSList *_found_commands = NULL;
+static GPtrArray *_found_commands = NULL;
 static Command *_current_command;
 
-static GSList *_found_paths = NULL; /* list of files and dirs found by path finding */
+static GPtrArray *_found_paths = NULL; /* files and dirs found by path finding */
 static gint _selected_index = -1;  /* selected index. -1 unselected */
 static gchar *_search_dir = NULL;   /* full dir part of */
 static gchar *_search_part = NULL;  /* search part */
@@ -106,6 +109,7 @@ error:
 void cmdline_free (void)
 {
     _free_found_items ();
+    cmdline_path_cache_free ();
     for (gsize i = 0; i < MAX_HISTORY_SIZE; i++) {
         g_free (_hcmd[i]);
         _hcmd[i] = NULL;
@@ -323,12 +327,12 @@ gboolean cmdline_cursor_pos_set (glong pos)
     return TRUE;
 }
 
-GSList *cmdline_found_commands (void)
+GPtrArray *cmdline_found_commands (void)
 {
     return _found_commands;
 }
 
-GSList *cmdline_found_paths (void)
+GPtrArray *cmdline_found_paths (void)
 {
     return _found_paths;
 }
@@ -359,9 +363,9 @@ glong cmdline_select_command_by_index (gint index)
     glong utf8_end_pos = 0;
 
     if (_found_commands == NULL) return -1;
-    else if (g_slist_length (_found_commands) <= index) return -1;
+    else if (index < 0 || _found_commands->len <= index) return -1;
 
-    CmdlineItem *ci = (CmdlineItem *)g_slist_nth_data (_found_commands, index);
+    CmdlineItem *ci = (CmdlineItem *)g_ptr_array_index (_found_commands, index);
     if (ci == NULL) return -1;
     cmd = ci->cmd;
     if (cmd == NULL) return -1;
@@ -401,11 +405,11 @@ glong cmdline_select_path_by_index (gint index)
 
     if (_found_paths == NULL) return -1;
 
-    len = g_slist_length (_found_paths);
+    len = _found_paths->len;
     if (len == 1) return -1;
-    else if (len <= index) return -1;
+    else if (index < 0 || len <= index) return -1;
 
-    cfp = (CmdlineItem *)g_slist_nth_data (_found_paths, index);
+    cfp = (CmdlineItem *)g_ptr_array_index (_found_paths, index);
     if (cfp == NULL) return -1;
 
     if (_find_cmd_positions (&s, &e, &us, &ue, &d) == TRUE) {
@@ -433,13 +437,20 @@ glong cmdline_select_path_by_index (gint index)
     return ue;
 }
 
+/* arrays stay allocated also when nothing matched */
 static gboolean _has_found_items (void)
 {
-    if (_found_commands != NULL) return TRUE;
-    else if (_found_paths != NULL) return TRUE;
+    if (_found_len (_found_commands) > 0) return TRUE;
+    else if (_found_len (_found_paths) > 0) return TRUE;
     return FALSE;
 }
 
+static guint _found_len (GPtrArray *found)
+{
+    if (found == NULL) return 0;
+    return found->len;
+}
+
 static void _add_line_to_history (void)
 {
     g_free (_history[MAX_HISTORY_SIZE - 1]);
@@ -504,15 +515,9 @@ static gboolean _find_cmd (gboolean check_is_cursor_ok)
 
     _current_command = NULL;
 
-    if (_found_commands != NULL) {
-        for (gint i = 0; i < g_slist_length (_found_commands); i++) {
-           ci = (CmdlineItem *)g_slist_nth_data (_found_commands, i);
-          /* Do not do this!!! g_free (ci->str); */
-           g_free (ci);
-        }
-        g_slist_free (_found_commands);
-    }
-    _found_commands = NULL;
+    /* Do not free ci->str, it is command name */
+    if (_found_commands != NULL) g_ptr_array_unref (_found_commands);
+    _found_commands = g_ptr_array_new_with_free_func (g_free);
     if (_commands == NULL) return FALSE;
     else if (FALSE == _find_cmd_positions (&start_pos, &end_pos, &utf8_start_pos, &utf8_end_pos, &d)) {
         return FALSE;
@@ -529,7 +534,7 @@ static gboolean _find_cmd (gboolean check_is_cursor_ok)
                 ci->type = CMDLINE_ITEM_TYPE_COMMAND;
                 ci->str = (gchar *)cmd->name;
                 ci->cmd = cmd;
-                _found_commands = g_slist_prepend (_found_commands, ci);
+                g_ptr_array_add (_found_commands, ci);
             }
             found = TRUE;
         } else if (_cursor_position > utf8_end_pos) return FALSE;
@@ -544,25 +549,25 @@ static gboolean _find_cmd (gboolean check_is_cursor_ok)
                 ci->type = CMDLINE_ITEM_TYPE_COMMAND;
                 ci->str = (gchar *)cmd->name;
                 ci->cmd = cmd;
-                _found_commands = g_slist_prepend (_found_commands, ci);
+                g_ptr_array_add (_found_commands, ci);
                 found = TRUE;
                 _current_command = cmd;
             }
         }
     }
 
-    _found_commands = g_slist_sort (_found_commands, _sort_str);
+    g_ptr_array_sort (_found_commands, _sort_item);
 
-    if (g_slist_length(_found_commands) > 1) {
+    if (_found_commands->len > 1) {
         ci = g_malloc0 (sizeof (CmdlineItem));
         if (ci != NULL) {
             ci->str =  " ";
             ci->type = CMDLINE_ITEM_TYPE_PLACEHOLDER;
-            _found_commands = g_slist_append (_found_commands, ci);
+            g_ptr_array_add (_found_commands, ci);
         }
     }
 
-    if (found == TRUE && g_slist_length (_found_commands) == 1) {
+    if (found == TRUE && _found_commands->len == 1) {
         if (check_is_cursor_ok == TRUE) {
             glong cur = cmdline_select_command_by_index (0);
             if (cur > -1) {
@@ -586,34 +591,31 @@ void _free_found_items (void)
     g_free (_search_part);
     _search_part = NULL;
     if (_found_paths != NULL) {
-        for (gint i = 0; i < g_slist_length (_found_paths); i++) {
-            CmdlineItem *p = g_slist_nth_data (_found_paths, i);
-            if (p != NULL) g_free (p->str);
-            g_free (p);
-        }
-        g_slist_free (_found_paths);
+        g_ptr_array_unref (_found_paths);
         _found_paths = NULL;
     }
     if (_found_commands != NULL) {
-        for (gint i = 0; i < g_slist_length (_found_commands); i++) {
-            CmdlineItem *p = (CmdlineItem *)g_slist_nth_data (_found_commands, i);
-            /* Do not do this!!! if (p != NULL) g_free (p->str); */
-            g_free (p);
-        }
-        g_slist_free (_found_commands);
+        g_ptr_array_unref (_found_commands);
         _found_commands = NULL;
     }
     _selected_index = -1;
     _tmp_position = 0;
 }
 
+static void _free_path_item (gpointer data)
+{
+    CmdlineItem *p = (CmdlineItem *)data;
+    if (p != NULL) g_free (p->str);
+    g_free (p);
+}
+
 static gboolean _find_dir_or_file (const char *path, gint size, gboolean dir_only)
 {
     CmdlineItem *cfp;
     gboolean success = FALSE;
-    GDir *dir = NULL;
     gchar *new_path = NULL;
-    const gchar *name;
+    const CmdlinePathCacheEntry *entries;
+    guint count = 0;
     gchar *find_name = NULL;
     gsize find_name_len = 0;
     GString *p = NULL;
@@ -623,17 +625,19 @@ static gboolean _find_dir_or_file (const char *path, gint size, gboolean dir_onl
     if (path == NULL) return FALSE;
     else if (size < 0) return FALSE;
 
+    _found_paths = g_ptr_array_new_with_free_func (_free_path_item);
+
     if (size == 0 || (size == 1 && strcmp (path, " ") == 0)) {
         new_path = g_strdup (".");
         _search_dir = g_strdup ("");
     } else if (size == 1 && strcmp (path, "~") == 0) {
         /* no need to sort */
         cfp = g_malloc0 (sizeof (CmdlineItem));
-        if (p != NULL) {
+        if (cfp != NULL) {
             _search_dir = g_strdup ("~");
             cfp->type = CMDLINE_ITEM_TYPE_DIR;
             cfp->str = g_strdup ("~");
-            _found_paths = g_slist_prepend (_found_paths, cfp);
+            g_ptr_array_add (_found_paths, cfp);
             return TRUE;
         } else {
             return FALSE;
@@ -665,38 +669,22 @@ static gboolean _find_dir_or_file (const char *path, gint size, gboolean dir_onl
         g_free (new_path);
         new_path = tmp;
     }
-    dir = g_dir_open (new_path, 0, NULL);
-    if (dir == NULL) goto find_dir_or_file_error;
-
     _search_part = g_strdup (find_name);
 
-    while ((name = g_dir_read_name (dir)) != NULL) {
-        if (find_name_len == 0 || (strncmp (find_name, name, find_name_len) == 0)) {
-            CmdlineItemType type = CMDLINE_ITEM_TYPE_FILE;
-            gchar *full_path;
-
-            full_path = g_strconcat (new_path, G_DIR_SEPARATOR_S, name, NULL);
-            if (full_path == NULL) {
-                goto find_dir_or_file_error;
-            }
-            if (g_file_test (full_path, G_FILE_TEST_IS_DIR)) {
-                type = CMDLINE_ITEM_TYPE_DIR;
-            } else if (dir_only == TRUE) {
-                g_free (full_path);
-                continue;
-            }
-            g_free (full_path);
+    /* cached and sorted listing. matches are next to each other */
+    entries = cmdline_path_cache_find (new_path, find_name != NULL ? find_name : "", &count);
+    if (entries == NULL) goto find_dir_or_file_error;
 
-            cfp = g_malloc0 (sizeof (CmdlineItem));
-            if (cfp != NULL) {
-                cfp->str = g_strdup (name);
-                cfp->type = type;
-                _found_paths = g_slist_prepend (_found_paths, cfp);
-                success = TRUE;
-            }
+    for (guint i = 0; i < count; i++) {
+        if (dir_only == TRUE && entries[i].is_dir == FALSE) continue;
+        cfp = g_malloc0 (sizeof (CmdlineItem));
+        if (cfp != NULL) {
+            cfp->str = g_strdup (entries[i].name);
+            cfp->type = entries[i].is_dir == TRUE ? CMDLINE_ITEM_TYPE_DIR : CMDLINE_ITEM_TYPE_FILE;
+            g_ptr_array_add (_found_paths, cfp);
+            success = TRUE;
         }
     }
-    _found_paths = g_slist_sort (_found_paths, _sort_str);
 
 find_dir_or_file_error:
     {
@@ -714,12 +702,11 @@ find_dir_or_file_error:
             if (cfp != NULL) {
                 cfp->str = add_name;
                 cfp->type = CMDLINE_ITEM_TYPE_PLACEHOLDER;
-                _found_paths = g_slist_append (_found_paths, cfp);
+                g_ptr_array_add (_found_paths, cfp);
             }
         }
     }
     if (p != NULL) g_string_free (p, TRUE);
-    if (dir != NULL) g_dir_close (dir);
     g_free (new_path);
     return success;
 }
@@ -766,7 +753,7 @@ static gboolean _try_to_find_path (gboolean dir_only)
     }
 
     if (TRUE == _find_dir_or_file (&_line[start_pos2], cursor_pos-start_pos2, dir_only)) {
-        gint len = g_slist_length (_found_paths);
+        gint len = _found_len (_found_paths);
         if (len > 1) return TRUE;
     }
     return FALSE;
@@ -834,7 +821,7 @@ static void _select_parent_dir (void)
     glong utf8_end_pos = 0;
     glong utf8_start_pos = 0;
 
-    if (g_slist_length (_found_paths) == 0) return;
+    if (_found_len (_found_paths) == 0) return;
 
     if (FALSE == _find_cmd_positions (&start_pos, &end_pos, &utf8_start_pos, &utf8_end_pos, &d)) {
         return;
@@ -887,7 +874,7 @@ static void _select_parent_dir (void)
 
 static void _select_dir_or_file (void)
 {
-    if (g_slist_length (_found_paths) == 0) return;
+    if (_found_len (_found_paths) == 0) return;
 
     _tmp_position = _cursor_position;
     _selected_index = -1;
@@ -897,12 +884,12 @@ static void _select_dir_or_file (void)
 
 static void _handle_tab (gboolean forward)
 {
-    gint len = g_slist_length (_found_commands);
+    gint len = _found_len (_found_commands);
     if (len < 1) {
         if (_find_cmd (TRUE) == TRUE) {
 
         }
-        len = g_slist_length (_found_commands);
+        len = _found_len (_found_commands);
         if (len == 1) {
             _free_found_items ();
             return;
@@ -928,11 +915,11 @@ static void _handle_tab (gboolean forward)
     }
 
     if (len == 0) {
-        len = g_slist_length (_found_paths);
+        len = _found_len (_found_paths);
         if (len < 1) {
             if (_find_path () == TRUE) {
             }
-            len = g_slist_length (_found_paths);
+            len = _found_len (_found_paths);
         }
         if (len > 1) {
             _tmp_position = _cursor_position;
@@ -1013,9 +1000,10 @@ static void _line_remove_utf8 (glong pos)
     _line[_line_index] = '\0';
 }
 
-static gint _sort_str (gconstpointer a, gconstpointer b)
+/* g_ptr_array_sort gives pointers to items */
+static gint _sort_item (gconstpointer a, gconstpointer b)
 {
-    CmdlineItem *cfpa = (CmdlineItem *)a;
-    CmdlineItem *cfpb = (CmdlineItem *)b;
+    CmdlineItem *cfpa = *(CmdlineItem **)a;
+    CmdlineItem *cfpb = *(CmdlineItem **)b;
     return strcmp (cfpa->str, cfpb->str);
 }
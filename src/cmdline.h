@@ -58,12 +58,12 @@ const gchar *cmdline_input (NCursesEvent *e);
 glong cmdline_cursor_pos (void);
 gboolean cmdline_cursor_pos_set (glong pos);
 
-GSList *cmdline_found_commands (void);
+GPtrArray *cmdline_found_commands (void);
 
 /*
  * List of CmdlineFoundPath items
  */
-GSList *cmdline_found_paths (void);
+GPtrArray *cmdline_found_paths (void);
 gchar *cmdline_search_dir (gint index);
 gchar *cmdline_search_part (gint index);
 
@@ -133,4 +133,28 @@ static Command volume_command = {
     .callback = _volume_callback
 };
 
+static Command stats_command = {
+    .name = "stats",
+    .description = "Shows performance counters.",
+    .hint = COMMAND_HINT_NONE,
+    .modes = CMDLINE_MODE_CMD | CMDLINE_MODE_FILEBROWSER,
+    .callback = _stats_callback
+};
+
+static Command unquarantine_command = {
+    .name = "unquarantine",
+    .description = "Probes again files which have timed out or were found not playable.",
+    .hint = COMMAND_HINT_NONE,
+    .modes = CMDLINE_MODE_CMD | CMDLINE_MODE_FILEBROWSER,
+    .callback = _unquarantine_callback
+};
+
+static Command diagnostics_command = {
+    .name = "diagnostics",
+    .description = "Shows playback pipeline timings. Needs diagnostics in config.",
+    .hint = COMMAND_HINT_NONE,
+    .modes = CMDLINE_MODE_CMD,
+    .callback = _diagnostics_callback
+};
+
 #endif
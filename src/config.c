@@ -80,7 +80,7 @@ static ConfigOption _options[] = {
         .default_value.string = "default",
         .have = 0,
         .comment = "stream_error_action. What to do when an audio stream unexpectedly stops, "
-            "for example due to a disconnect. options: default, next or pause."
+            "for example due to a disconnect. options: default (reconnect), next or pause."
     },
     {
         .name = "playlist_line",
@@ -99,7 +99,8 @@ static ConfigOption _options[] = {
         .value.boolean = &config.playlist_save_at_exit,
         .default_value.boolean = FALSE,
         .have = 0,
-        .comment = "playlist_save_at_exit. Options: true, false, yes, no, 0 or 1."
+        .comment = "playlist_save_at_exit. Keeps default playlist saved. Changes are journaled "
+            "as they are made, so they survive also crashes. Options: true, false, yes, no, 0 or 1."
     },
     {
         .name = "wild",
@@ -259,6 +260,123 @@ static ConfigOption _options[] = {
         .have = 0,
         .comment = "max_filebrowser_entries. The maximum number of files in a directory the filebrowser can show."
     },
+    {
+        .name = "probe_timeout_file",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.probe_timeout_file,
+        .default_value.integer = 5,
+        .have = 0,
+        .comment = "probe_timeout_file. Seconds a local file may take to be recognized when added. Files which time out are not tried again for a week or until they change, see unquarantine command. 0 = no limit."
+    },
+    {
+        .name = "probe_timeout_stream",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.probe_timeout_stream,
+        .default_value.integer = 10,
+        .have = 0,
+        .comment = "probe_timeout_stream. Seconds a network stream may take to start when added. 0 = no limit."
+    },
+    {
+        .name = "prefetch_tracks",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.prefetch_tracks,
+        .default_value.integer = 3,
+        .have = 0,
+        .comment = "prefetch_tracks. Number of upcoming local files read into cache while playing. Max 16, 0 = off."
+    },
+    {
+        .name = "prefetch_budget",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.prefetch_budget,
+        .default_value.integer = 64,
+        .have = 0,
+        .comment = "prefetch_budget. Megabytes read ahead for all upcoming files together. 0 = off."
+    },
+    {
+        .name = "stream_buffer_size",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.stream_buffer_size,
+        .default_value.integer = 512,
+        .have = 0,
+        .comment = "stream_buffer_size. Kilobytes buffered from a network stream. 0 = GStreamer default."
+    },
+    {
+        .name = "stream_buffer_duration",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.stream_buffer_duration,
+        .default_value.integer = 4000,
+        .have = 0,
+        .comment = "stream_buffer_duration. Milliseconds buffered from a network stream. 0 = GStreamer default."
+    },
+    {
+        .name = "stream_start_percent",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.stream_start_percent,
+        .default_value.integer = 15,
+        .have = 0,
+        .comment = "stream_start_percent. Stream starts and resumes when buffer is this full. 0 = GStreamer default."
+    },
+    {
+        .name = "stream_reconnect_attempts",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.stream_reconnect_attempts,
+        .default_value.integer = 10,
+        .have = 0,
+        .comment = "stream_reconnect_attempts. Reconnects in a row before giving up, with growing delay. 0 = never."
+    },
+    {
+        .name = "audio_realtime",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.audio_realtime,
+        .default_value.integer = 0,
+        .have = 0,
+        .comment = "audio_realtime. SCHED_RR priority 1-99 for audio streaming threads, nice -10 if not permitted. 0 = off."
+    },
+    {
+        .name = "audio_buffer_time",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.audio_buffer_time,
+        .default_value.integer = 0,
+        .have = 0,
+        .comment = "audio_buffer_time. Milliseconds of audio in alsa or pulse device buffer. 0 = sink default."
+    },
+    {
+        .name = "audio_latency_time",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.audio_latency_time,
+        .default_value.integer = 0,
+        .have = 0,
+        .comment = "audio_latency_time. Milliseconds of one alsa or pulse device period. 0 = sink default."
+    },
+    {
+        .name = "render_cache_size",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.render_cache_size,
+        .default_value.integer = 0,
+        .have = 0,
+        .comment = "render_cache_size. MiB of played SID tunes and modules kept rendered as FLAC, replays skip the emulation. 0 = off."
+    },
+    {
+        .name = "diagnostics",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.diagnostics,
+        .default_value.integer = 0,
+        .have = 0,
+        .comment = "diagnostics. Measures the playback pipeline for the diagnostics window and logs it every this many seconds. 0 = off."
+    },
     {
         .name = "lyrics_service",
         .type = CONFIG_OPTION_TYPE_UNSIGNED_INTEGER,
@@ -268,6 +386,33 @@ static ConfigOption _options[] = {
         .have = 0,
         .comment = "lyrics service to use. 0 = none, 1 = Chart Lyrics"
     },
+    {
+        .name = "lyrics_chartlyrics_url",
+        .type = CONFIG_OPTION_TYPE_STRING,
+        .required = 0,
+        .value.string = &config.lyrics_chartlyrics_url,
+        .default_value.string = "http://api.chartlyrics.com/apiv1.asmx/SearchLyricDirect",
+        .have = 0,
+        .comment = "lyrics_chartlyrics_url. Chart Lyrics search address. artist and song are added as query."
+    },
+    {
+        .name = "lyrics_not_found_ttl",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.lyrics_not_found_ttl,
+        .default_value.integer = 168,
+        .have = 0,
+        .comment = "lyrics_not_found_ttl. Hours until lyrics which were not found are searched again. 0 = always search."
+    },
+    {
+        .name = "network_timeout",
+        .type = CONFIG_OPTION_TYPE_INTEGER,
+        .required = 0,
+        .value.integer = &config.network_timeout,
+        .default_value.integer = 15,
+        .have = 0,
+        .comment = "network_timeout. Maximum time in seconds for one network request, for example lyrics or playlist download."
+    },
     {
         .name = "key_common_abort",
         .type = CONFIG_OPTION_TYPE_KEYBIND,
@@ -72,7 +72,23 @@ typedef struct {
     gchar *sid_basic_file;
     gchar *sid_chargen_file;
     guint lyrics_service;
+    gchar *lyrics_chartlyrics_url;
+    gint lyrics_not_found_ttl;
+    gint network_timeout;
     gint max_filebrowser_entries;
+    gint probe_timeout_file;
+    gint probe_timeout_stream;
+    gint prefetch_tracks;
+    gint prefetch_budget;
+    gint stream_buffer_size;
+    gint stream_buffer_duration;
+    gint stream_start_percent;
+    gint stream_reconnect_attempts;
+    gint audio_realtime;
+    gint audio_buffer_time;
+    gint audio_latency_time;
+    gint render_cache_size;
+    gint diagnostics;
     /* keybindings */
     Keybind key_global_volume_up;
     Keybind key_global_volume_down;
@@ -21,42 +21,77 @@
 
 #include "common.h"
 
-void gst_common_parse_tags (GstMessage *msg, Song *o)
+#include "../config.h"
+#include "../sid.h"
+
+static gboolean _set_string (Song *o, int (*set) (Song *, const gchar *), const gchar *old, const GstTagList *tags, const gchar *tag);
+
+/* streams repeat the same tags often, so only changed fields are touched */
+gboolean gst_common_parse_tags (GstMessage *msg, Song *o)
 {
     GstTagList *tags = NULL;
-    gchar *val = NULL;
     guint uival = 0;
     GDate *date = NULL;
+    gboolean changed = FALSE;
 
-    if (o == NULL || msg == NULL) return;
+    if (o == NULL || msg == NULL) return FALSE;
 
     gst_message_parse_tag (msg, &tags);
-    if (gst_tag_list_get_string_index (tags, GST_TAG_ARTIST, 0, &val) == TRUE) {
-        (void)song_set_artist (o, val);
-        g_free (val);
-    }
-    if (gst_tag_list_get_string_index (tags, GST_TAG_TITLE, 0, &val) == TRUE) {
-        (void)song_set_title (o, val);
-        g_free (val);
-    }
-    if (gst_tag_list_get_string_index (tags, GST_TAG_ALBUM, 0, &val) == TRUE) {
-        (void)song_set_album (o, val);
-        g_free (val);
-    }
-    if (gst_tag_list_get_uint_index (tags, GST_TAG_TRACK_NUMBER, 0, &uival) == TRUE) {
+    changed |= _set_string (o, song_set_artist, o->artist, tags, GST_TAG_ARTIST);
+    changed |= _set_string (o, song_set_title, o->title, tags, GST_TAG_TITLE);
+    changed |= _set_string (o, song_set_album, o->album, tags, GST_TAG_ALBUM);
+    if (gst_tag_list_get_uint_index (tags, GST_TAG_TRACK_NUMBER, 0, &uival) == TRUE && uival != o->track) {
         (void)song_set_track (o, uival);
+        changed = TRUE;
     }
-    if (gst_tag_list_get_string_index (tags, GST_TAG_AUDIO_CODEC, 0, &val) == TRUE) {
-        (void)song_set_codec (o, val);
-        g_free (val);
-    }
+    changed |= _set_string (o, song_set_codec, o->codec, tags, GST_TAG_AUDIO_CODEC);
     if (gst_tag_list_get_date_index (tags, GST_TAG_DATE, 0, &date) == TRUE) {
-        (void)song_set_year (o, date->year);
+        if (date->year != o->year) {
+            (void)song_set_year (o, date->year);
+            changed = TRUE;
+        }
         g_date_free (date);
     }
-    if (gst_tag_list_get_string_index (tags, GST_TAG_COPYRIGHT, 0, &val) == TRUE) {
-        (void)song_set_copyright (o, val);
-        g_free (val);
-    }
+    changed |= _set_string (o, song_set_copyright, o->copyright, tags, GST_TAG_COPYRIGHT);
     gst_tag_list_unref (tags);
+    return changed;
+}
+
+static gboolean _set_string (Song *o, int (*set) (Song *, const gchar *), const gchar *old, const GstTagList *tags, const gchar *tag)
+{
+    const gchar *val = NULL;
+    if (gst_tag_list_peek_string_index (tags, tag, 0, &val) == FALSE || val == NULL) return FALSE;
+    if (g_strcmp0 (old, val) == 0) return FALSE;
+    return set (o, val) == 0;
+}
+
+gboolean gst_common_setup_siddec (GstElement *e, gint tune)
+{
+    gboolean ret = TRUE;
+    gchar *name = gst_element_get_name (e);
+    if (g_str_has_prefix (name, "siddecfp") == TRUE) {
+        g_object_set (G_OBJECT (e),
+            "tune", tune,
+            "filter", config.sid_filter,
+            "sid-model", config.sid_sid_model,
+            "force-sid-model", config.sid_force_sid_model,
+            "c64-model", config.sid_c64_model,
+            "force-c64-model", config.sid_force_c64_model,
+            "cia-model", config.sid_cia_model,
+            "digi-boost", config.sid_digiboost,
+            "sampling-method", config.sid_sampling_method,
+            "filter-bias", config.sid_filter_bias,
+            "filter-curve-6581", config.sid_filter_curve_6581,
+            "filter-curve-8580", config.sid_filter_curve_8580,
+            "basic", sid_basic (),
+            "kernal", sid_kernal (),
+            "chargen", sid_chargen (),
+            NULL);
+    } else if (g_str_has_prefix (name, "siddec") == TRUE) {
+        g_object_set (G_OBJECT (e), "tune", tune, NULL);
+    } else {
+        ret = FALSE;
+    }
+    g_free (name);
+    return ret;
 }
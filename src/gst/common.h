@@ -40,6 +40,9 @@ typedef enum {
     GST_PLAYBIN_FLAGS_NATIVE_FORCE_SW_DECODERS = (1<<12)
 } GstPlaybinFlags;
 
-void gst_common_parse_tags (GstMessage *msg, Song *o);
+/* Returns TRUE if some tag of o changed */
+gboolean gst_common_parse_tags (GstMessage *msg, Song *o);
+/* Sets tune and config settings if e is a SID decoder. Returns TRUE if it was */
+gboolean gst_common_setup_siddec (GstElement *e, gint tune);
 
 #endif
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <gst/gst.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "diagnostics.h"
+
+#include "../log.h"
+
+#define DIAGNOSTICS_ELEMENTS_MAX 128
+#define DIAGNOSTICS_THREADS_MAX 64
+
+typedef struct {
+    gchar *name;
+    GThread *in_thread; /* output in the thread of the last input ends its processing */
+    gint64 in; /* usec, 0 when output was already counted */
+    guint64 buffers;
+    guint64 processed;
+    gint64 proc_sum; /* usec */
+    gint64 proc_max;
+} DiagElement;
+
+typedef struct {
+    gchar *owner;
+    clockid_t clock;
+    gint64 cpu; /* nsec at last sample */
+} DiagThread;
+
+static void _element_free (gpointer data);
+static void _thread_free (gpointer data);
+static gboolean _watch_pad (GstElement *e, GstPad *pad, gpointer data);
+static void _on_pad_added (GstElement *e, GstPad *pad, gpointer data);
+static GstPadProbeReturn _buffer_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data);
+static DiagElement *_element_get (GstElement *e);
+static gint _compare_proc (gconstpointer a, gconstpointer b);
+static void _queue_level (const GValue *item, gpointer data);
+
+static GHashTable *_elements = NULL; /* element name -> DiagElement. _diag lock */
+static GHashTable *_threads = NULL; /* GThread -> DiagThread. _diag lock */
+static guint _underruns = 0; /* _diag lock */
+G_LOCK_DEFINE_STATIC (_diag);
+static gint64 _last_sample = 0;
+static gchar *_report = NULL;
+
+gboolean gst_diagnostics_init (void)
+{
+    _elements = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, _element_free);
+    _threads = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, _thread_free);
+    if (_elements == NULL || _threads == NULL) goto error;
+    _last_sample = 0;
+    return TRUE;
+error:
+    gst_diagnostics_free ();
+    return FALSE;
+}
+
+void gst_diagnostics_free (void)
+{
+    G_LOCK (_diag);
+    if (_elements != NULL) g_hash_table_destroy (_elements);
+    _elements = NULL;
+    if (_threads != NULL) g_hash_table_destroy (_threads);
+    _threads = NULL;
+    G_UNLOCK (_diag);
+    g_free (_report);
+    _report = NULL;
+}
+
+void gst_diagnostics_watch_element (GstElement *e)
+{
+    if (_elements == NULL || GST_IS_BIN (e)) return;
+    (void)gst_element_foreach_pad (e, _watch_pad, NULL);
+    g_signal_connect (e, "pad-added", G_CALLBACK (_on_pad_added), NULL);
+}
+
+void gst_diagnostics_thread_enter (GstElement *owner)
+{
+    DiagThread *t;
+    clockid_t clock;
+    if (pthread_getcpuclockid (pthread_self (), &clock) != 0) return;
+    t = g_new0 (DiagThread, 1);
+    t->owner = g_strdup (owner != NULL ? GST_OBJECT_NAME (owner) : "?");
+    t->clock = clock;
+    t->cpu = -1;
+    G_LOCK (_diag);
+    if (_threads != NULL && g_hash_table_size (_threads) < DIAGNOSTICS_THREADS_MAX) {
+        g_hash_table_replace (_threads, g_thread_self (), t);
+        t = NULL;
+    }
+    G_UNLOCK (_diag);
+    if (t != NULL) _thread_free (t);
+}
+
+void gst_diagnostics_thread_leave (void)
+{
+    G_LOCK (_diag);
+    if (_threads != NULL) g_hash_table_remove (_threads, g_thread_self ());
+    G_UNLOCK (_diag);
+}
+
+void gst_diagnostics_underrun (void)
+{
+    G_LOCK (_diag);
+    _underruns++;
+    G_UNLOCK (_diag);
+}
+
+void gst_diagnostics_sample (GstElement *pipeline)
+{
+    GHashTableIter it;
+    gpointer value;
+    GPtrArray *busy;
+    GString *str;
+    gint64 now = g_get_monotonic_time ();
+    gint64 period = _last_sample > 0 ? now - _last_sample : 0; /* usec */
+    _last_sample = now;
+    if (_elements == NULL) return;
+
+    str = g_string_new ("Streaming threads, cpu of one core\n");
+    busy = g_ptr_array_new_with_free_func (_element_free);
+    G_LOCK (_diag);
+    g_hash_table_iter_init (&it, _threads);
+    while (g_hash_table_iter_next (&it, NULL, &value) == TRUE) {
+        DiagThread *t = (DiagThread *)value;
+        struct timespec ts;
+        gint64 cpu;
+        if (clock_gettime (t->clock, &ts) != 0) continue;
+        cpu = (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        if (period > 0 && t->cpu >= 0) {
+            g_string_append_printf (str, "  %-28s %5.1f%%\n", t->owner, (cpu - t->cpu) / (period * 10.0));
+        }
+        t->cpu = cpu;
+    }
+
+    /* copies, so the lock is not held while sorting and printing */
+    g_hash_table_iter_init (&it, _elements);
+    while (g_hash_table_iter_next (&it, NULL, &value) == TRUE) {
+        DiagElement *d = (DiagElement *)value;
+        if (d->buffers > 0) {
+            DiagElement *c = g_new (DiagElement, 1);
+            *c = *d;
+            c->name = g_strdup (d->name);
+            g_ptr_array_add (busy, c);
+        }
+        d->buffers = d->processed = 0;
+        d->proc_sum = d->proc_max = 0;
+    }
+    if (g_hash_table_size (_elements) >= DIAGNOSTICS_ELEMENTS_MAX) g_hash_table_remove_all (_elements);
+    g_string_append_printf (str, "Sink underruns %u\n", _underruns);
+    _underruns = 0;
+    G_UNLOCK (_diag);
+
+    g_ptr_array_sort (busy, _compare_proc);
+    g_string_append (str, "Elements, usec per buffer avg / max, buffers\n");
+    for (guint i = 0; i < busy->len; i++) {
+        DiagElement *d = (DiagElement *)g_ptr_array_index (busy, i);
+        if (d->processed > 0) {
+            g_string_append_printf (str, "  %-28s %6" G_GINT64_FORMAT " / %6" G_GINT64_FORMAT " %6" G_GUINT64_FORMAT "\n",
+                d->name, d->proc_sum / (gint64)d->processed, d->proc_max, d->buffers);
+        } else {
+            g_string_append_printf (str, "  %-28s      - /      - %6" G_GUINT64_FORMAT "\n", d->name, d->buffers);
+        }
+    }
+    g_ptr_array_free (busy, TRUE);
+
+    g_string_append (str, "Queues, ms / max ms, KiB / max KiB\n");
+    if (pipeline != NULL && GST_IS_BIN (pipeline)) {
+        GstIterator *iter = gst_bin_iterate_recurse (GST_BIN (pipeline));
+        (void)gst_iterator_foreach (iter, _queue_level, str);
+        gst_iterator_free (iter);
+    }
+
+    g_free (_report);
+    _report = g_string_free (str, FALSE);
+}
+
+gchar *gst_diagnostics_report (void)
+{
+    return g_strdup (_report);
+}
+
+void gst_diagnostics_log (void)
+{
+    gchar **lines;
+    if (_report == NULL) return;
+    lines = g_strsplit (_report, "\n", -1);
+    for (gint i = 0; lines[i] != NULL; i++) {
+        if (lines[i][0] != '\0') LOG ("diagnostics: %s", lines[i]);
+    }
+    g_strfreev (lines);
+}
+
+static void _element_free (gpointer data)
+{
+    DiagElement *d = (DiagElement *)data;
+    g_free (d->name);
+    g_free (d);
+}
+
+static void _thread_free (gpointer data)
+{
+    DiagThread *t = (DiagThread *)data;
+    g_free (t->owner);
+    g_free (t);
+}
+
+static gboolean _watch_pad (GstElement *e, GstPad *pad, gpointer data)
+{
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, _buffer_probe, NULL, NULL);
+    return TRUE;
+}
+
+static void _on_pad_added (GstElement *e, GstPad *pad, gpointer data)
+{
+    (void)_watch_pad (e, pad, data);
+}
+
+/* streaming thread. Input to the first output in the same thread is time
+ * spent in the element. Outputs from an own task have no input to measure */
+static GstPadProbeReturn _buffer_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    DiagElement *d;
+    GstElement *e = GST_PAD_PARENT (pad);
+    gint64 now = g_get_monotonic_time ();
+    if (e == NULL) return GST_PAD_PROBE_OK;
+
+    G_LOCK (_diag);
+    d = _element_get (e);
+    if (d != NULL && GST_PAD_DIRECTION (pad) == GST_PAD_SINK) {
+        d->in = now;
+        d->in_thread = g_thread_self ();
+        if (GST_ELEMENT_IS_SINK (e)) d->buffers++;
+    } else if (d != NULL) {
+        d->buffers++;
+        if (d->in > 0 && d->in_thread == g_thread_self ()) {
+            gint64 t = now - d->in;
+            d->processed++;
+            d->proc_sum += t;
+            if (t > d->proc_max) d->proc_max = t;
+        }
+        d->in = 0;
+    }
+    G_UNLOCK (_diag);
+    return GST_PAD_PROBE_OK;
+}
+
+/* _diag lock. Elements come and go with songs, so they are found by name */
+static DiagElement *_element_get (GstElement *e)
+{
+    DiagElement *d;
+    const gchar *name = GST_OBJECT_NAME (e);
+    if (_elements == NULL || name == NULL) return NULL;
+    d = (DiagElement *)g_hash_table_lookup (_elements, name);
+    if (d != NULL) return d;
+    d = g_new0 (DiagElement, 1);
+    d->name = g_strdup (name);
+    g_hash_table_insert (_elements, d->name, d);
+    return d;
+}
+
+static gint _compare_proc (gconstpointer a, gconstpointer b)
+{
+    const DiagElement *da = *(const DiagElement **)a;
+    const DiagElement *db = *(const DiagElement **)b;
+    if (da->proc_sum > db->proc_sum) return -1;
+    return da->proc_sum < db->proc_sum;
+}
+
+static void _queue_level (const GValue *item, gpointer data)
+{
+    GString *str = (GString *)data;
+    GstElement *e = GST_ELEMENT (g_value_get_object (item));
+    GstElementFactory *f = gst_element_get_factory (e);
+    const gchar *kind = f != NULL ? gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (f)) : NULL;
+    guint64 time = 0, max_time = 0;
+    guint bytes = 0, max_bytes = 0;
+    /* multiqueue keeps levels per stream, not as properties */
+    if (g_strcmp0 (kind, "queue") != 0 && g_strcmp0 (kind, "queue2") != 0) return;
+    g_object_get (e,
+        "current-level-time", &time, "max-size-time", &max_time,
+        "current-level-bytes", &bytes, "max-size-bytes", &max_bytes,
+        NULL);
+    g_string_append_printf (str, "  %-28s %5" G_GUINT64_FORMAT " / %5" G_GUINT64_FORMAT " %6u / %6u\n",
+        GST_OBJECT_NAME (e), time / GST_MSECOND, max_time / GST_MSECOND, bytes / 1024, max_bytes / 1024);
+}
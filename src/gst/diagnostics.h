@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_GST_DIAGNOSTICS_H_
+#define _KK_GST_DIAGNOSTICS_H_
+
+#include <gst/gst.h>
+
+/*
+ * Opt-in pipeline numbers for finding what stutters: cpu load of each
+ * streaming thread, time elements spend per buffer, queue levels and
+ * sink underruns. Collected with pad probes and stream status messages.
+ */
+
+gboolean gst_diagnostics_init (void);
+void gst_diagnostics_free (void);
+
+/* Adds buffer probes to pads of e, bins are skipped */
+void gst_diagnostics_watch_element (GstElement *e);
+/* Called in the streaming thread itself, from stream status ENTER and LEAVE */
+void gst_diagnostics_thread_enter (GstElement *owner);
+void gst_diagnostics_thread_leave (void);
+void gst_diagnostics_underrun (void);
+
+/* Takes numbers gathered since the last call. Queue levels are read from pipeline */
+void gst_diagnostics_sample (GstElement *pipeline);
+/* Last sample as lines of text. Caller frees */
+gchar *gst_diagnostics_report (void);
+/* Last sample to log */
+void gst_diagnostics_log (void);
+
+#endif
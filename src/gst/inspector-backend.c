@@ -0,0 +1,550 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "common.h"
+#include "../inspector.h"
+#include "../inspector-backend.h"
+#include "../util.h"
+#include "../sid.h"
+#include "../config.h"
+#include "../log.h"
+#include "../paths.h"
+#include "../stats.h"
+
+/*#define DEBUG_GST_INSPECTOR 1
+ */
+
+#define INSPECTOR_REAP_TIMEOUT (2 * GST_SECOND) /* how long wedged pipeline may take to stop */
+#define QUARANTINE_EXPIRE_SECONDS (7 * 24 * 3600) /* timed out file is tried again after this */
+
+typedef struct {
+    gint64 size;
+    gint64 mtime;
+    gint64 time; /* when quarantined, seconds since epoch */
+} QuarantineEntry;
+
+static void _on_new_pad (GstElement *src_element, GstPad *pad, GstElement *sink_element);
+static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data);
+static void _check_is_special_format (const GstCaps *caps, Song *s);
+static GstClockTime _probe_timeout (const gchar *uri);
+static gboolean _pipeline_create (void);
+static void _pipeline_destroy (void);
+static void _pipeline_recreate (void);
+static gpointer _reap_pipeline (gpointer data);
+static void _quarantine_load (void);
+static void _quarantine_save (void);
+static gboolean _quarantine_has (const gchar *uri);
+static void _quarantine_add (const gchar *uri);
+static gboolean _stat_uri (const gchar *uri, gint64 *size, gint64 *mtime);
+static gboolean _have_element (const gchar *name);
+static InspectorProbeResult _error_result (GstMessage *msg);
+
+
+#if defined(DEBUG_GST_INSPECTOR)
+static gint _count = 0;
+#endif
+static GstElement *_pipeline = NULL;
+static GstElement *_decoder = NULL;
+static GstElement *_fakesink = NULL;
+static GstCaps *_caps = NULL;
+static gulong _signal_handle = 0;
+
+static GHashTable *_quarantine = NULL; /* uri -> QuarantineEntry of timed out files. main loop only */
+static gboolean _quarantine_changed = FALSE;
+
+static GstElement *_siddec = NULL;
+static gboolean _is_siddecfp = FALSE;
+static gboolean _have_siddec = FALSE; /* any sid decoder installed */
+static gboolean _have_siddecfp = FALSE;
+
+gboolean inspector_backend_init (void)
+{
+    _caps = gst_caps_new_simple ("audio/x-raw", "rate", GST_TYPE_INT_RANGE, 1, 2147483647, NULL); /* audio */
+    if (_caps == NULL) goto error;
+
+    if (_pipeline_create () == FALSE) goto error;
+
+    _quarantine_load ();
+
+    _have_siddecfp = _have_element ("siddecfp");
+    _have_siddec = _have_siddecfp || _have_element ("siddec");
+    return TRUE;
+error:
+    inspector_backend_free ();
+    return FALSE;
+}
+
+void inspector_backend_free (void)
+{
+    _pipeline_destroy ();
+    _quarantine_save ();
+    if (_quarantine != NULL) g_hash_table_destroy (_quarantine);
+    _quarantine = NULL;
+    if (_caps != NULL) gst_caps_unref (_caps);
+    _caps = NULL;
+}
+
+const gchar *inspector_backend_name (void)
+{
+    return "gstreamer";
+}
+
+gboolean inspector_backend_uri_is_valid (const gchar *uri)
+{
+    return gst_uri_is_valid (uri);
+}
+
+gchar *inspector_backend_filename_to_uri (const gchar *path)
+{
+    return gst_filename_to_uri (path, NULL);
+}
+
+/* use libmagic to check mime */
+gboolean inspector_backend_is_possibly_supported (const gchar *filepath)
+{
+    return util_is_possibly_supported_file (filepath);
+}
+
+gint inspector_backend_sid_tunes (guint tunes)
+{
+    if (_have_siddec == FALSE) return -1;
+    /* plain siddec plays only default tune */
+    return _have_siddecfp == TRUE ? tunes : 0;
+}
+
+static gboolean _pipeline_create (void)
+{
+    _pipeline = gst_pipeline_new ("pipeline");
+    if (_pipeline == NULL) goto create_error;
+
+    _decoder = gst_element_factory_make ("uridecodebin", "uridecodebin");
+    if (_decoder == NULL) {
+        g_print ("make sure you have installed gst-plugins-base (uridecoder)\n");
+        goto create_error;
+    }
+    gst_bin_add (GST_BIN (_pipeline), _decoder);
+
+    g_signal_connect (_decoder, "deep-element-added", G_CALLBACK (_on_element_added), NULL);
+
+    _fakesink = gst_element_factory_make ("fakesink", "fakesink");
+    if (_fakesink == NULL) goto create_error;
+    gst_bin_add (GST_BIN (_pipeline), _fakesink);
+
+    _signal_handle = g_signal_connect (_decoder, "pad-added", G_CALLBACK (_on_new_pad), _fakesink);
+    return TRUE;
+create_error:
+    _pipeline_destroy ();
+    return FALSE;
+}
+
+static void _pipeline_destroy (void)
+{
+    if (_decoder != NULL) g_signal_handler_disconnect (_decoder, _signal_handle);
+    if (_pipeline != NULL) {
+        gst_element_set_state (_pipeline, GST_STATE_NULL);
+        gst_object_unref (_pipeline);
+    }
+    _pipeline = _decoder = _fakesink = NULL;
+    _siddec = NULL;
+}
+
+/*
+ * Watchdog for timed out probe. Decoder thread of old pipeline may be
+ * stuck, so stopping it can block too. Stop it in own thread and use new
+ * pipeline right away.
+ */
+static void _pipeline_recreate (void)
+{
+    GThread *reaper;
+    GstElement *old = _pipeline;
+
+    if (_decoder != NULL) g_signal_handler_disconnect (_decoder, _signal_handle);
+    _pipeline = _decoder = _fakesink = NULL;
+    _siddec = NULL;
+
+    reaper = g_thread_new ("InspectorReaper", _reap_pipeline, old);
+    if (reaper != NULL) g_thread_unref (reaper); /* not joined, it may never return */
+
+    if (_pipeline_create () == FALSE) {
+        LOG_ERROR ("Could not recreate inspector pipeline.");
+    }
+}
+
+static gpointer _reap_pipeline (gpointer data)
+{
+    GstElement *pipeline = (GstElement *)data;
+    if (pipeline == NULL) return NULL;
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    if (gst_element_get_state (pipeline, NULL, NULL, INSPECTOR_REAP_TIMEOUT) == GST_STATE_CHANGE_FAILURE) {
+        LOG_ERROR ("Wedged inspector pipeline did not stop.");
+    }
+    gst_object_unref (pipeline);
+    return NULL;
+}
+
+static GstClockTime _probe_timeout (const gchar *uri)
+{
+    gint seconds = inspector_is_stream (uri) ? config.probe_timeout_stream : config.probe_timeout_file;
+    if (seconds <= 0) return GST_CLOCK_TIME_NONE;
+    return (GstClockTime)seconds * GST_SECOND;
+}
+
+static void _quarantine_load (void)
+{
+    gchar *path;
+    gchar *str = NULL;
+
+    _quarantine = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    if (_quarantine == NULL) return;
+    _quarantine_changed = FALSE;
+
+    path = paths_saved_data_quarantine ();
+    if (path == NULL) return;
+    if (g_file_test (path, G_FILE_TEST_EXISTS) && util_file_load_to_str (path, &str) == 0) {
+        /* size<TAB>mtime<TAB>time<TAB>uri. old uri only lines are dropped */
+        gchar **lines = g_strsplit (str, "\n", -1);
+        for (gint i = 0; lines != NULL && lines[i] != NULL; i++) {
+            gchar **f = g_strsplit (lines[i], "\t", 4);
+            if (g_strv_length (f) == 4 && *f[3] != '\0') {
+                QuarantineEntry *e = g_new0 (QuarantineEntry, 1);
+                if (e != NULL) {
+                    e->size = g_ascii_strtoll (f[0], NULL, 10);
+                    e->mtime = g_ascii_strtoll (f[1], NULL, 10);
+                    e->time = g_ascii_strtoll (f[2], NULL, 10);
+                    g_hash_table_replace (_quarantine, g_strdup (f[3]), e);
+                }
+            } else if (*lines[i] != '\0') {
+                _quarantine_changed = TRUE;
+            }
+            g_strfreev (f);
+        }
+        g_strfreev (lines);
+    }
+    g_free (str);
+    g_free (path);
+}
+
+static void _quarantine_save (void)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    GString *s;
+    gchar *path;
+
+    if (_quarantine == NULL || _quarantine_changed == FALSE) return;
+    path = paths_saved_data_quarantine ();
+    if (path == NULL) return;
+    s = g_string_new (NULL);
+    g_hash_table_iter_init (&iter, _quarantine);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        QuarantineEntry *e = (QuarantineEntry *)value;
+        g_string_append_printf (s, "%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%s\n",
+            e->size, e->mtime, e->time, (const gchar *)key);
+    }
+    if (util_file_write_data (path, s->str, s->len) != 0) {
+        LOG_ERROR ("Could not save quarantine %s.", path);
+    } else {
+        _quarantine_changed = FALSE;
+    }
+    g_string_free (s, TRUE);
+    g_free (path);
+}
+
+/* TRUE while uri is quarantined. Entry is dropped when file has changed or it has expired */
+static gboolean _quarantine_has (const gchar *uri)
+{
+    QuarantineEntry *e;
+    gint64 size, mtime;
+
+    if (_quarantine == NULL) return FALSE;
+    e = (QuarantineEntry *)g_hash_table_lookup (_quarantine, uri);
+    if (e == NULL) return FALSE;
+    if (_stat_uri (uri, &size, &mtime) == TRUE && size == e->size && mtime == e->mtime &&
+        g_get_real_time () / G_USEC_PER_SEC - e->time < QUARANTINE_EXPIRE_SECONDS) {
+        return TRUE;
+    }
+    LOG ("Quarantine dropped, trying again: %s", uri);
+    g_hash_table_remove (_quarantine, uri);
+    _quarantine_changed = TRUE;
+    return FALSE;
+}
+
+/* only local files. streams may time out just because network is slow now */
+static void _quarantine_add (const gchar *uri)
+{
+    QuarantineEntry *e;
+    gint64 size, mtime;
+
+    if (_quarantine == NULL || inspector_is_stream (uri)) return;
+    if (_stat_uri (uri, &size, &mtime) == FALSE) return;
+    e = g_new0 (QuarantineEntry, 1);
+    if (e == NULL) return;
+    e->size = size;
+    e->mtime = mtime;
+    e->time = g_get_real_time () / G_USEC_PER_SEC;
+    g_hash_table_replace (_quarantine, g_strdup (uri), e);
+    _quarantine_changed = TRUE;
+
+    LOG ("Probe timed out, quarantined: %s", uri);
+    _quarantine_save (); /* right away, next probe may hang for good */
+}
+
+static gboolean _stat_uri (const gchar *uri, gint64 *size, gint64 *mtime)
+{
+    struct stat st;
+    gint ret;
+    gchar *path = g_filename_from_uri (uri, NULL, NULL);
+    if (path == NULL) return FALSE;
+    ret = stat (path, &st);
+    g_free (path);
+    if (ret != 0 || !S_ISREG (st.st_mode)) return FALSE;
+    *size = (gint64)st.st_size;
+    *mtime = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) + st.st_mtim.tv_nsec;
+    return TRUE;
+}
+
+guint inspector_backend_quarantine_clear (void)
+{
+    guint n;
+    gchar *path;
+
+    if (_quarantine == NULL) return 0;
+    n = g_hash_table_size (_quarantine);
+    g_hash_table_remove_all (_quarantine);
+    _quarantine_changed = FALSE;
+    path = paths_saved_data_quarantine ();
+    if (path != NULL && g_file_test (path, G_FILE_TEST_EXISTS) && g_remove (path) != 0) {
+        LOG_ERROR ("Could not remove quarantine %s.", path);
+    }
+    g_free (path);
+    LOG ("Quarantine cleared, %u uris", n);
+    return n;
+}
+
+/* Uses own pipeline so many can run at the same time */
+gboolean inspector_backend_probe_stream (const gchar *uri)
+{
+    GstClockTime timeout = _probe_timeout (uri);
+    gboolean bret = FALSE;
+    GstMessage *msg;
+    GstElement *pipeline = gst_pipeline_new (NULL);
+    GstElement *decoder = gst_element_factory_make ("uridecodebin", NULL);
+    GstElement *fakesink = gst_element_factory_make ("fakesink", NULL);
+    if (pipeline == NULL || decoder == NULL || fakesink == NULL) {
+        if (pipeline != NULL) gst_object_unref (pipeline);
+        if (decoder != NULL) gst_object_unref (decoder);
+        if (fakesink != NULL) gst_object_unref (fakesink);
+        return FALSE;
+    }
+    gst_bin_add_many (GST_BIN (pipeline), decoder, fakesink, NULL);
+    g_object_set (decoder, "uri", uri, "caps", _caps, NULL);
+    g_signal_connect (decoder, "pad-added", G_CALLBACK (_on_new_pad), fakesink);
+
+    gst_element_set_state (pipeline, GST_STATE_PAUSED);
+    msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline), timeout,
+            GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_TAG | GST_MESSAGE_ERROR);
+    if (msg != NULL) {
+        if (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR) bret = TRUE;
+        gst_message_unref (msg);
+    } else {
+        stats_inc (STATS_PROBE_TIMEOUTS);
+    }
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (pipeline);
+    return bret;
+}
+
+static void _check_is_special_format (const GstCaps *caps, Song *s)
+{
+    if (caps == NULL) return;
+    else if (s == NULL) return;
+    else if (gst_caps_is_any (caps) || gst_caps_is_empty (caps)) return;
+    else if (gst_caps_get_size (caps) != 1) return;
+
+    GstStructure *gs = gst_caps_get_structure (caps, 0);
+    if (gs == NULL) return;
+    const gchar *name = gst_structure_get_name (gs);
+    if (name == NULL) return;
+//    g_critical ("%s", name);
+    if (strncmp (name, "audio/x-sid", 12) == 0 || strncmp (name, "audio/x-rsid", 13) == 0) {
+        song_set_type (s, SONG_TYPE_SID);
+    } else if (strncmp (name, "audio/x-mod", 12) == 0 || strncmp (name, "audio/x-xm", 11) == 0 ||
+        strncmp (name, "audio/x-it", 11) == 0 || strncmp (name, "audio/x-s3m", 12) == 0 ||
+        strncmp (name, "audio/x-stm", 12) == 0) {
+        song_set_type (s, SONG_TYPE_MOD);
+    }
+}
+
+InspectorProbeResult inspector_backend_try_uri (const gchar *uri, Song *s)
+{
+    InspectorProbeResult result = INSPECTOR_PROBE_FAILED;
+    gint ret;
+    gint64 duration = 0;
+    GstMessage *msg = NULL;
+
+    if (_pipeline == NULL) return INSPECTOR_PROBE_FAILED; /* recreating has failed */
+    if (_quarantine_has (uri)) return INSPECTOR_PROBE_FAILED;
+
+    _siddec = NULL;
+    g_object_set (_decoder, "uri", uri, "caps", _caps, NULL);
+
+    gst_element_set_state (_pipeline, GST_STATE_PAUSED);
+
+    while (TRUE) {
+        if (msg != NULL) gst_message_unref (msg);
+        msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (_pipeline),
+                _probe_timeout (uri),
+                GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_TAG | GST_MESSAGE_ERROR);
+        if (msg == NULL) { /* deadline */
+            stats_inc (STATS_PROBE_TIMEOUTS);
+            _quarantine_add (uri);
+            _pipeline_recreate ();
+            return INSPECTOR_PROBE_FAILED;
+        }
+        if (s->type != SONG_TYPE_STREAM && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_TAG) {
+            (void)gst_common_parse_tags (msg, s);
+        }
+        break;
+    }
+
+    if (msg != NULL && GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR) {
+        result = INSPECTOR_PROBE_FOUND;
+        if (s->type == SONG_TYPE_FILE) {
+            (void)gst_element_query_duration (_pipeline, GST_FORMAT_TIME, &duration);
+            ret = song_set_duration (s, duration/1000000);
+        }
+        /* check is file sid */
+        GstElement *e = gst_bin_get_by_name (GST_BIN (_decoder), "typefind");
+        if (e != NULL) {
+            GstCaps *caps = NULL;
+            g_object_get (e, "caps", &caps, NULL);
+            _check_is_special_format (caps, s);
+            if (s->type == SONG_TYPE_SID) {
+                guint tunes = 0;
+                if (_is_siddecfp == TRUE && _siddec != NULL) {
+                    g_object_get (G_OBJECT (_siddec), "n-tunes", &tunes, NULL);
+                }
+                sid_setup_song (s, tunes);
+            }
+        }
+#if defined(DEBUG_GST_INSPECTOR)
+        g_print ("success: %d, URI: %s\n", ++_count, uri);
+#endif
+    }
+    else {
+        result = _error_result (msg);
+#if defined(DEBUG_GST_INSPECTOR)
+        g_print ("fail: %d, URI: %s\n", ++_count, uri);
+#endif
+    }
+    gst_element_set_state (_pipeline, GST_STATE_NULL);
+
+    if (msg != NULL) gst_message_unref (msg);
+    (void)ret;
+    return result;
+}
+
+/* only errors about content itself are definite. read errors and missing plugins may go away */
+static InspectorProbeResult _error_result (GstMessage *msg)
+{
+    InspectorProbeResult result = INSPECTOR_PROBE_FAILED;
+    GError *err = NULL;
+    if (msg == NULL) return result;
+    gst_message_parse_error (msg, &err, NULL);
+    if (err == NULL) return result;
+    if (err->domain == GST_STREAM_ERROR &&
+        (err->code == GST_STREAM_ERROR_TYPE_NOT_FOUND || err->code == GST_STREAM_ERROR_WRONG_TYPE ||
+         err->code == GST_STREAM_ERROR_DECODE || err->code == GST_STREAM_ERROR_DEMUX ||
+         err->code == GST_STREAM_ERROR_FORMAT)) {
+        result = INSPECTOR_PROBE_NOT_PLAYABLE;
+    }
+    g_error_free (err);
+    return result;
+}
+
+static void _on_new_pad (GstElement *src_element, GstPad *pad, GstElement *sink_element)
+{
+    GstPad *sinkpad = gst_element_get_static_pad (sink_element, "sink");
+    if (!gst_pad_is_linked (sinkpad)) {
+        if (gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK)
+            g_error ("Failed to link pads!");
+    }
+    gst_object_unref (sinkpad);
+}
+
+static gboolean _have_element (const gchar *name)
+{
+    GstElementFactory *f = gst_element_factory_find (name);
+    if (f == NULL) return FALSE;
+    gst_object_unref (f);
+    return TRUE;
+}
+
+#if defined (DEBUG_GST_INSPECTOR)
+static void _on_have_type (GstElement * typefind, guint probability, GstCaps * caps, gpointer udata)
+{
+  guint i;
+
+  g_return_if_fail (caps != NULL);
+
+  if (gst_caps_is_any (caps)) {
+    g_critical ("ANY\n");
+    return;
+  }
+  if (gst_caps_is_empty (caps)) {
+    g_critical ("EMPTY\n");
+    return;
+  }
+
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    GstStructure *structure = gst_caps_get_structure (caps, i);
+    g_critical ("%s\n", gst_structure_get_name (structure));
+  }
+}
+#endif
+
+static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data)
+{
+    gchar *name = gst_element_get_name (e);
+#if defined (DEBUG_GST_INSPECTOR)
+    g_critical ("Element inspector: %s", name);
+#endif
+    if (g_str_has_prefix (name, "siddecfp") == TRUE) {
+        _siddec = e;
+        g_object_set (G_OBJECT (e),
+            "basic", sid_basic (),
+            "kernal", sid_kernal (),
+            "chargen", sid_chargen (),
+            NULL);
+        _is_siddecfp = TRUE;
+    } else if (g_str_has_prefix (name, "siddec") == TRUE) {
+        _siddec = e;
+        _is_siddecfp = FALSE;
+#if defined (DEBUG_GST_INSPECTOR)
+    } if (g_str_has_prefix (name, "typefind") == TRUE) {
+        g_signal_connect (e, "have-type", G_CALLBACK (_on_have_type), NULL);
+#endif
+    }
+    g_free (name);
+}
+
@@ -17,31 +17,104 @@
  * USA.
  */
 
+#include <gst/audio/audio.h>
 #include <gst/audio/gstaudiodecoder.h>
 #include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 #include "player.h"
 #include "common.h"
 #include "typefind-hack.h"
+#include "render-cache.h"
+#include "diagnostics.h"
 
 #include "../config.h"
-#include "../sid.h"
-
+#include "../stats.h"
+#include "../log.h"
+
+/* One playbin with its own sink. The active one plays, the standby one prerolls the next song */
+typedef struct {
+    GstElement *playbin;
+    GstBus *bus;
+    guint watch;
+    GstElement *siddec;
+    Song *next; /* standby: uri and tags gathered while prerolling */
+    gint tune; /* standby: sid tune of next */
+    GstSegment segment; /* sink pad, streaming thread only */
+    gint64 end; /* running time where output is cut, -1 none. _end lock */
+    gboolean late; /* streaming thread: last buffer came after its render time */
+    gboolean cached; /* plays a pre-rendered tune, no decoder to switch tunes in */
+} PlayerPipeline;
+
+/* SID/MOD have no natural end: the end is scheduled on the pipeline clock */
+typedef enum {
+    END_STAGE_NONE,
+    END_STAGE_HANDOVER, /* start prerolled standby to begin at the end sample */
+    END_STAGE_END       /* tell the screen */
+} EndStage;
+
+#define END_HANDOVER_LEAD (250 * GST_MSECOND)
+
+#define STREAM_RECONNECT_MIN_MS 500
+#define STREAM_RECONNECT_MAX_MS 30000
+#define STREAM_LOW_WATERMARK 0.01
+
+static PlayerPipeline *_pipeline_new (void);
+static void _pipeline_free (PlayerPipeline *p);
+static void _standby_reset (void);
+static void _swap (void);
+static void _schedule_end (void);
+static void _unschedule_end (gboolean clear);
+static void _arm_end (GstClockTime at, EndStage stage);
+static gboolean _end_reached (GstClock *clock, GstClockTime time, GstClockID id, gpointer data);
+static gboolean _end_idle (gpointer data);
+static GstPadProbeReturn _sink_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data);
+static void _check_late (PlayerPipeline *p, GstBuffer *buf);
+static GstBusSyncReply _sync_handler (GstBus *b, GstMessage *m, gpointer data);
+static void _thread_priority_raise (void);
+static void _stream_reset (void);
+static void _stream_buffering (gint percent);
+static gboolean _stream_error (void);
+static void _reconnect_schedule (void);
+static gboolean _reconnect_timeout (gpointer data);
 static PlayerState _state_change (GstState state);
 static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data);
+static void _set_uri (PlayerPipeline *p, Song *s, gint tune);
+static gboolean _diagnostics_timeout (gpointer data);
 static gboolean _message_handler (GstBus *b, GstMessage *m, gpointer data);
 static void _on_about_to_finish (GstElement *e, gpointer data);
 
-static GstElement *_playbin = NULL;
-static GstElement *_output = NULL;
-static GstBus *_bus = NULL;
+static PlayerPipeline *_active = NULL;
+static PlayerPipeline *_standby = NULL;
+static gboolean _swap_pending = FALSE;
+static gboolean _standby_started = FALSE; /* handover: standby runs, starts at _end_clock_time */
+static GstClockID _end_id = NULL;
+static EndStage _end_stage = END_STAGE_NONE;
+static guint _end_serial = 0; /* drops stale clock callbacks */
+static GstClockTime _end_clock_time = GST_CLOCK_TIME_NONE;
+G_LOCK_DEFINE_STATIC (_end);
 static PlayerState _state = PLAYER_STATE_NULL;
 static Song *_song = NULL;
 static gint _sid_tune_index = 0;
-static GstElement *_siddec = NULL;
 static guint8 _volume = 100;
 static gboolean _use_gapless_playback = FALSE;
 
+/* network streams */
+static gint _buffer_percent = 100;
+static gboolean _buffering = FALSE; /* paused here until buffer fills */
+static gboolean _stream_started = FALSE; /* filled once, later drops are underruns */
+static guint _underruns = 0;
+static guint _reconnects = 0;
+static gint _reconnect_attempt = 0; /* since last successful start, for backoff */
+static guint _reconnect_id = 0;
+
+static guint _diagnostics_id = 0;
+
 static PlayerStatusUpdateFunc _status_update_func = NULL;
 
 /* #define DEBUG_GST_PLAYER 1*/
@@ -54,53 +127,18 @@ void player_preinit (int *argc, char **argv[])
 
 gboolean player_init (PlayerStatusUpdateFunc status_update_func)
 {
-    gint flags = 0;
     _state = PLAYER_STATE_NULL;
     _status_update_func = status_update_func;
     if (_status_update_func == NULL) goto error;
 
     _use_gapless_playback = FALSE;
-    _playbin = gst_element_factory_make ("playbin3", "playbin");
-    if (_playbin != NULL) {
-        GParamSpec *spec = g_object_class_find_property (G_OBJECT_GET_CLASS (_playbin), "instant-uri");
-        if (spec == NULL) {
-            gst_object_unref (_playbin);
-            _playbin = NULL;
-        } else {
-            _use_gapless_playback = TRUE;
-            g_object_set (_playbin, "instant-uri", TRUE, NULL);
-        }
-    }
-    if (_playbin == NULL) {
-        /* use playbin2 */
-        _playbin = gst_element_factory_make ("playbin", "playbin");
-        if (_playbin == NULL) {
-            goto error;
-        }
+    if (config.diagnostics > 0 && gst_diagnostics_init () == TRUE) {
+        _diagnostics_id = g_timeout_add_seconds (1, _diagnostics_timeout, NULL);
     }
-    g_signal_connect (GST_BIN (_playbin), "deep-element-added", G_CALLBACK (_on_element_added), NULL);
-
-    if (strncmp (config.output, "alsa", 4) == 0) {
-        _output = gst_element_factory_make ("alsasink", "alsasink");
-        if (_output != NULL) {
-            if (config.alsa_device != NULL) {
-                g_object_set (_output, "device", config.alsa_device, NULL);
-            }
-            g_object_set (_playbin, "audio-sink", _output, NULL);
-        }
-    } else if (strncmp (config.output, "pulse", 5) == 0) {
-        _output = gst_element_factory_make ("pulsesink", "pulsesink"); 
-        g_object_set (_playbin, "audio-sink", _output, NULL);
-    }
-
-    g_object_get (_playbin, "flags", &flags, NULL);
-    flags |= GST_PLAYBIN_FLAGS_AUDIO;
-    flags &= ~GST_PLAYBIN_FLAGS_VIDEO;
-    flags &= ~GST_PLAYBIN_FLAGS_SUBS;
-    g_object_set (_playbin, "flags", flags, NULL);
-
-    _bus = gst_element_get_bus (_playbin);
-    gst_bus_add_watch (_bus, _message_handler, NULL);
+    _active = _pipeline_new ();
+    if (_active == NULL) goto error;
+    _standby = _pipeline_new (); /* optional, skips are just slower without it */
+    (void)gst_render_cache_init (); /* optional too */
 
     _volume = player_volume ();
     return TRUE;
@@ -111,35 +149,99 @@ error:
 
 void player_free (void)
 {
-    if (_bus != NULL) gst_object_unref (_bus);
-    if (_playbin != NULL) {
-        gst_element_set_state (_playbin, GST_STATE_NULL);
-        gst_object_unref (_playbin);
-    }
+    _unschedule_end (TRUE);
+    _pipeline_free (_standby);
+    _standby = NULL;
+    _pipeline_free (_active);
+    _active = NULL;
+    _swap_pending = FALSE;
     _status_update_func = NULL;
+    gst_render_cache_free ();
+    if (_diagnostics_id > 0) g_source_remove (_diagnostics_id);
+    _diagnostics_id = 0;
+    gst_diagnostics_free ();
 }
 
 gint player_set_song (Song *s)
 {
+    PlayerPipeline *p;
     if (s == NULL) return 1;
     if (s->uri == NULL) return 2;
-    if (_playbin == NULL) return 3; 
+    if (_active == NULL) return 3; 
+
+    /* stopped and the standby has this one prerolled: swap in player_play */
+    _swap_pending = FALSE;
+    if (_state != PLAYER_STATE_PLAYING && _state != PLAYER_STATE_PAUSED &&
+        _standby != NULL && _standby->next != NULL && g_strcmp0 (_standby->next->uri, s->uri) == 0) {
+        _swap_pending = TRUE;
+    }
+    p = _swap_pending == TRUE ? _standby : _active;
 
     if (_use_gapless_playback == TRUE) {
-        g_signal_handlers_disconnect_by_func (_playbin, G_CALLBACK (_on_about_to_finish), NULL);
+        g_signal_handlers_disconnect_by_func (_active->playbin, G_CALLBACK (_on_about_to_finish), NULL);
+        if (_standby != NULL) g_signal_handlers_disconnect_by_func (_standby->playbin, G_CALLBACK (_on_about_to_finish), NULL);
         if (s->type != SONG_TYPE_SID && s->type != SONG_TYPE_MOD) {
-            g_signal_connect (GST_BIN (_playbin), "about-to-finish", G_CALLBACK (_on_about_to_finish), NULL);
+            g_signal_connect (GST_BIN (p->playbin), "about-to-finish", G_CALLBACK (_on_about_to_finish), NULL);
         }
     }
     _song = s;
-    g_object_set (_playbin, "uri", _song->uri, NULL);
+    _unschedule_end (TRUE);
+    _stream_reset ();
+    _reconnects = 0;
+    _underruns = 0;
+    if (_swap_pending == FALSE) {
+        if (_standby_started == TRUE) _standby_reset (); /* handed over to something else */
+        p->siddec = NULL;
+        if (s->type == SONG_TYPE_STREAM) {
+            g_object_set (p->playbin,
+                "buffer-size", config.stream_buffer_size > 0 ? config.stream_buffer_size * 1024 : -1,
+                "buffer-duration", config.stream_buffer_duration > 0 ? (gint64)config.stream_buffer_duration * GST_MSECOND : (gint64)-1,
+                NULL);
+        } else {
+            g_object_set (p->playbin, "buffer-size", -1, "buffer-duration", (gint64)-1, NULL);
+        }
+        _set_uri (p, _song, _sid_tune_index);
+    }
 
     return 0;
 }
 
+void player_preroll (Song *s, gint tune)
+{
+    if (_standby == NULL) return;
+    if (s == NULL || s->uri == NULL || s->type == SONG_TYPE_STREAM) {
+        _standby_reset ();
+        return;
+    }
+    if (player_is_prerolled (s, tune) == TRUE) return;
+
+    _standby_reset ();
+    _standby->next = song_new (s->uri);
+    if (_standby->next == NULL) return;
+    _standby->tune = tune;
+    _set_uri (_standby, s, tune);
+    g_object_set (_standby->playbin, "volume", (_volume/100.0), NULL);
+    if (gst_element_set_state (_standby->playbin, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+        _standby_reset ();
+    }
+}
+
+gboolean player_is_prerolled (Song *s, gint tune)
+{
+    if (s == NULL || _standby == NULL || _standby->next == NULL) return FALSE;
+    return g_strcmp0 (_standby->next->uri, s->uri) == 0 && _standby->tune == tune;
+}
+
 PlayerState player_play (void)
 {
-    return _state_change (GST_STATE_PLAYING);
+    PlayerState state;
+    gboolean started = _swap_pending == TRUE && _standby_started == TRUE;
+    if (_swap_pending == TRUE) _swap ();
+    if (_active != NULL && _active->cached == FALSE) gst_render_cache_request (_song, _sid_tune_index);
+    state = _state_change (GST_STATE_PLAYING);
+    /* already PLAYING, so no state change message will schedule it */
+    if (started == TRUE && state == PLAYER_STATE_PLAYING) _schedule_end ();
+    return state;
 }
 
 PlayerState player_toggle_playpause (void)
@@ -166,14 +268,14 @@ gboolean player_seek (gint64 ms)
     gint64 len = 0;
     if (player_state () != PLAYER_STATE_PLAYING) return FALSE;
     else if (_song != NULL && (_song->type == SONG_TYPE_SID || _song->type == SONG_TYPE_MOD)) return FALSE;
-    else if (gst_element_query_position (_playbin, GST_FORMAT_TIME, &ns) == FALSE) return FALSE;
-    else if (gst_element_query_duration (_playbin, GST_FORMAT_TIME, &len) == FALSE) return FALSE;
+    else if (gst_element_query_position (_active->playbin, GST_FORMAT_TIME, &ns) == FALSE) return FALSE;
+    else if (gst_element_query_duration (_active->playbin, GST_FORMAT_TIME, &len) == FALSE) return FALSE;
 
     ns = ns + (ms*1000000);
     if (ns < 0) ns = 0;
     else if (ns > len) ns = len;
 
-    return gst_element_seek_simple (_playbin, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT, ns);
+    return gst_element_seek_simple (_active->playbin, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT, ns);
 }
 
 gboolean player_seek_to (gint64 ms)
@@ -182,13 +284,13 @@ gboolean player_seek_to (gint64 ms)
     if (player_state () != PLAYER_STATE_PLAYING) return FALSE;
     else if (_song != NULL && (_song->type == SONG_TYPE_SID || _song->type == SONG_TYPE_MOD)) return FALSE;
 
-    return gst_element_seek_simple (_playbin, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT, ns);
+    return gst_element_seek_simple (_active->playbin, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH|GST_SEEK_FLAG_KEY_UNIT, ns);
 }
 
 gboolean player_get_duration (gint64 *ms)
 {
     gint64 ns;
-    gboolean ret = gst_element_query_duration (_playbin, GST_FORMAT_TIME, &ns);
+    gboolean ret = gst_element_query_duration (_active->playbin, GST_FORMAT_TIME, &ns);
     if (ret) {
         *ms = ns / 1000000;
     }
@@ -201,8 +303,11 @@ guint8 player_set_volume (guint8 volume)
         volume = PLAYER_VOLUME_MAX;
     }
     _volume = volume;
-    if (_playbin != NULL) {
-        g_object_set (_playbin, "volume", (_volume/100.0), NULL);
+    if (_active != NULL) {
+        g_object_set (_active->playbin, "volume", (_volume/100.0), NULL);
+    }
+    if (_standby != NULL) {
+        g_object_set (_standby->playbin, "volume", (_volume/100.0), NULL);
     }
     return _volume;
 }
@@ -237,9 +342,11 @@ guint8 player_volume (void)
 static PlayerState _state_change (GstState state)
 {
     gint ret;
-    if (_playbin == NULL) return PLAYER_STATE_ERROR;
+    if (_active == NULL) return PLAYER_STATE_ERROR;
 
-    ret = gst_element_set_state (_playbin, state);
+    if (state == GST_STATE_NULL) _unschedule_end (TRUE);
+    _stream_reset ();
+    ret = gst_element_set_state (_active->playbin, state);
     if (ret == GST_STATE_CHANGE_FAILURE) {
         _state = PLAYER_STATE_ERROR;
         return _state;
@@ -268,7 +375,7 @@ gint64 player_get_current_time (void)
     gint64 s = -1;
     PlayerState state = player_state ();
     if (state != PLAYER_STATE_PLAYING && state != PLAYER_STATE_PAUSED) return 0;
-    if (gst_element_query_position (_playbin, GST_FORMAT_TIME, &c) == TRUE) s = c/1000000;
+    if (gst_element_query_position (_active->playbin, GST_FORMAT_TIME, &c) == TRUE) s = c/1000000;
     return s;
 }
 
@@ -279,40 +386,333 @@ gint player_set_sid_tune (gint tune)
     else if (tune > _song->tunes-1) tune = _song->tunes - 1;
     if (_song->tunes == 0) tune = 0; /* special case, plays only default one*/
     _sid_tune_index = tune;
+    if (_swap_pending == TRUE && _sid_tune_index != _standby->tune) {
+        /* standby prerolled another tune */
+        _swap_pending = FALSE;
+        if (_standby_started == TRUE) _standby_reset ();
+        _active->siddec = NULL;
+        _set_uri (_active, _song, _sid_tune_index);
+    } else if (_swap_pending == FALSE && _state != PLAYER_STATE_PLAYING && _state != PLAYER_STATE_PAUSED) {
+        _set_uri (_active, _song, _sid_tune_index); /* renders are per tune */
+    }
     return _sid_tune_index;
 }
 
+gboolean player_apply_sid_tune (void)
+{
+    GstState state;
+    if (_active == NULL || _song == NULL || _active->siddec == NULL) return FALSE;
+    if (_state != PLAYER_STATE_PLAYING && _state != PLAYER_STATE_PAUSED) return FALSE;
+
+    _unschedule_end (TRUE);
+    /*
+     * Flushing seek is not enough: it may go upstream, or decoder reads tune
+     * only when loading, and still reports success. READY drops the decoder
+     * chain, new siddec gets the tune when it is added. Playbin and open sink
+     * are kept.
+     */
+    state = _state == PLAYER_STATE_PLAYING ? GST_STATE_PLAYING : GST_STATE_PAUSED;
+    if (gst_element_set_state (_active->playbin, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) return FALSE;
+    _active->siddec = NULL;
+    if (gst_element_set_state (_active->playbin, state) == GST_STATE_CHANGE_FAILURE) return FALSE;
+    if (_sid_tune_index > -1) _song->duration = _song->tune_duration[_sid_tune_index];
+    gst_render_cache_request (_song, _sid_tune_index);
+    return TRUE;
+}
+
+static PlayerPipeline *_pipeline_new (void)
+{
+    gint flags = 0;
+    GstElement *output = NULL;
+    GstClock *clock;
+    GstPad *pad;
+    PlayerPipeline *p = g_new0 (PlayerPipeline, 1);
+    if (p == NULL) return NULL;
+    p->end = -1;
+    gst_segment_init (&p->segment, GST_FORMAT_TIME);
+
+    p->playbin = gst_element_factory_make ("playbin3", NULL);
+    if (p->playbin != NULL) {
+        GParamSpec *spec = g_object_class_find_property (G_OBJECT_GET_CLASS (p->playbin), "instant-uri");
+        if (spec == NULL) {
+            gst_object_unref (p->playbin);
+            p->playbin = NULL;
+        } else {
+            _use_gapless_playback = TRUE;
+            g_object_set (p->playbin, "instant-uri", TRUE, NULL);
+        }
+    }
+    if (p->playbin == NULL) {
+        /* use playbin2 */
+        p->playbin = gst_element_factory_make ("playbin", NULL);
+        if (p->playbin == NULL) {
+            goto pipeline_new_error;
+        }
+    }
+    g_signal_connect (GST_BIN (p->playbin), "deep-element-added", G_CALLBACK (_on_element_added), p);
+
+    /* own sink for each pipeline, so the standby can preroll while the active one plays */
+    if (strncmp (config.output, "alsa", 4) == 0) {
+        output = gst_element_factory_make ("alsasink", NULL);
+        if (output != NULL) {
+            if (config.alsa_device != NULL) {
+                g_object_set (output, "device", config.alsa_device, NULL);
+            }
+            g_object_set (p->playbin, "audio-sink", output, NULL);
+        }
+    } else if (strncmp (config.output, "pulse", 5) == 0) {
+        output = gst_element_factory_make ("pulsesink", NULL);
+        if (output != NULL) g_object_set (p->playbin, "audio-sink", output, NULL);
+    } else {
+        output = gst_element_factory_make ("autoaudiosink", NULL); /* playbin default, made here for the probe */
+        if (output != NULL) g_object_set (p->playbin, "audio-sink", output, NULL);
+    }
+    if (output != NULL) {
+        /* alsasink and pulsesink, microseconds */
+        if (config.audio_buffer_time > 0 && g_object_class_find_property (G_OBJECT_GET_CLASS (output), "buffer-time") != NULL) {
+            g_object_set (output, "buffer-time", (gint64)config.audio_buffer_time * 1000, NULL);
+        }
+        if (config.audio_latency_time > 0 && g_object_class_find_property (G_OBJECT_GET_CLASS (output), "latency-time") != NULL) {
+            g_object_set (output, "latency-time", (gint64)config.audio_latency_time * 1000, NULL);
+        }
+        pad = gst_element_get_static_pad (output, "sink");
+        if (pad != NULL) {
+            gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER|GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, _sink_probe, p, NULL);
+            gst_object_unref (pad);
+        }
+    }
+
+    /* same clock in both pipelines, so standby can be started at a time of the active one */
+    clock = gst_system_clock_obtain ();
+    gst_pipeline_use_clock (GST_PIPELINE (p->playbin), clock);
+    gst_object_unref (clock);
+
+    g_object_get (p->playbin, "flags", &flags, NULL);
+    flags |= GST_PLAYBIN_FLAGS_AUDIO;
+    flags &= ~GST_PLAYBIN_FLAGS_VIDEO;
+    flags &= ~GST_PLAYBIN_FLAGS_SUBS;
+    g_object_set (p->playbin, "flags", flags, NULL);
+
+    p->bus = gst_element_get_bus (p->playbin);
+    p->watch = gst_bus_add_watch (p->bus, _message_handler, p);
+    if (config.audio_realtime > 0 || config.diagnostics > 0) gst_bus_set_sync_handler (p->bus, _sync_handler, p, NULL);
+    return p;
+pipeline_new_error:
+    _pipeline_free (p);
+    return NULL;
+}
+
+static void _pipeline_free (PlayerPipeline *p)
+{
+    if (p == NULL) return;
+    if (p->watch > 0) g_source_remove (p->watch);
+    if (p->bus != NULL) gst_object_unref (p->bus);
+    if (p->playbin != NULL) {
+        gst_element_set_state (p->playbin, GST_STATE_NULL);
+        gst_object_unref (p->playbin);
+    }
+    song_delete (p->next);
+    g_free (p);
+}
+
+/* drop whatever standby has prerolled and release its sink */
+static void _standby_reset (void)
+{
+    if (_standby == NULL) return;
+    _standby_started = FALSE;
+    gst_element_set_state (_standby->playbin, GST_STATE_NULL);
+    _standby->siddec = NULL;
+    song_delete (_standby->next);
+    _standby->next = NULL;
+}
+
+static void _swap (void)
+{
+    PlayerPipeline *p = _active;
+    _active = _standby;
+    _standby = p;
+    _swap_pending = FALSE;
+    _standby_started = FALSE;
+    gst_element_set_state (_standby->playbin, GST_STATE_NULL);
+    _standby->siddec = NULL;
+
+    if (_active->siddec != NULL || (_active->cached == TRUE && _song->type == SONG_TYPE_SID)) {
+        _song->duration = _song->tune_duration[_active->tune];
+    }
+    /* tags came while prerolling */
+    if (_status_update_func != NULL) _status_update_func (PLAYER_MESSAGE_TAG, (gpointer)_active->next);
+    song_delete (_active->next);
+    _active->next = NULL;
+}
+
+/* Called when active pipeline reaches PLAYING. Song position is not
+ * running time after pauses or tune switches, so end is taken from both */
+static void _schedule_end (void)
+{
+    GstClock *clock;
+    GstClockTime base, now;
+    gint64 pos = 0;
+    gint64 running, end;
+    if (_active == NULL || _song == NULL) return;
+    if (_song->type != SONG_TYPE_SID && _song->type != SONG_TYPE_MOD) return;
+    if (_song->duration <= 0) return; /* decoder ends it */
+
+    _unschedule_end (FALSE);
+    clock = gst_element_get_clock (_active->playbin);
+    if (clock == NULL) return;
+    base = gst_element_get_base_time (_active->playbin);
+    now = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+    running = now > base ? (gint64)(now - base) : 0;
+    if (gst_element_query_position (_active->playbin, GST_FORMAT_TIME, &pos) == FALSE || pos < 0) pos = 0;
+    end = running - pos + _song->duration * GST_MSECOND;
+    if (end < running) end = running;
+
+    G_LOCK (_end);
+    _active->end = end;
+    G_UNLOCK (_end);
+    _end_clock_time = base + end;
+    if (_end_clock_time > now + END_HANDOVER_LEAD) _arm_end (_end_clock_time - END_HANDOVER_LEAD, END_STAGE_HANDOVER);
+    else _arm_end (now, END_STAGE_HANDOVER);
+}
+
+/* clear: forget the cut point too, not just the wake up (pause) */
+static void _unschedule_end (gboolean clear)
+{
+    _end_serial++;
+    _end_stage = END_STAGE_NONE;
+    if (_end_id != NULL) {
+        gst_clock_id_unschedule (_end_id);
+        gst_clock_id_unref (_end_id);
+        _end_id = NULL;
+    }
+    if (clear == TRUE && _active != NULL) {
+        G_LOCK (_end);
+        _active->end = -1;
+        G_UNLOCK (_end);
+    }
+}
+
+static void _arm_end (GstClockTime at, EndStage stage)
+{
+    GstClock *clock = gst_element_get_clock (_active->playbin);
+    if (clock == NULL) return;
+    if (_end_id != NULL) gst_clock_id_unref (_end_id);
+    _end_stage = stage;
+    _end_id = gst_clock_new_single_shot_id (clock, at);
+    gst_clock_id_wait_async (_end_id, _end_reached, GUINT_TO_POINTER (_end_serial), NULL);
+    gst_object_unref (clock);
+}
+
+/* clock thread */
+static gboolean _end_reached (GstClock *clock, GstClockTime time, GstClockID id, gpointer data)
+{
+    g_idle_add_full (G_PRIORITY_HIGH, _end_idle, data, NULL);
+    return TRUE;
+}
+
+static gboolean _end_idle (gpointer data)
+{
+    Song o;
+    if (GPOINTER_TO_UINT (data) != _end_serial) return FALSE; /* rescheduled meanwhile */
+
+    if (_end_stage == END_STAGE_HANDOVER) {
+        /* standby starts rendering exactly where the probe cuts the active one */
+        if (_standby != NULL && _standby->next != NULL && _standby_started == FALSE) {
+            gst_element_set_start_time (_standby->playbin, GST_CLOCK_TIME_NONE);
+            gst_element_set_base_time (_standby->playbin, _end_clock_time);
+            if (gst_element_set_state (_standby->playbin, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE) {
+                _standby_started = TRUE;
+            }
+        }
+        _arm_end (_end_clock_time, END_STAGE_END);
+    } else if (_end_stage == END_STAGE_END) {
+        _end_stage = END_STAGE_NONE;
+        if (_status_update_func != NULL) {
+            memset (&o, 0, sizeof (Song));
+            _status_update_func (PLAYER_MESSAGE_TUNE_END, (gpointer)&o);
+        }
+    }
+    return FALSE;
+}
+
+/* streaming thread: drops audio after scheduled end, last buffer is cut at the sample */
+static GstPadProbeReturn _sink_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    PlayerPipeline *p = (PlayerPipeline *)data;
+    GstBuffer *buf;
+    GstCaps *caps;
+    GstAudioInfo ai;
+    guint64 start;
+    gint64 end;
+
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent *ev = GST_PAD_PROBE_INFO_EVENT (info);
+        if (GST_EVENT_TYPE (ev) == GST_EVENT_SEGMENT) gst_event_copy_segment (ev, &p->segment);
+        else if (GST_EVENT_TYPE (ev) == GST_EVENT_FLUSH_STOP) gst_segment_init (&p->segment, GST_FORMAT_TIME);
+        return GST_PAD_PROBE_OK;
+    }
+
+    buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (buf == NULL || GST_BUFFER_PTS_IS_VALID (buf) == FALSE) return GST_PAD_PROBE_OK;
+    _check_late (p, buf);
+
+    G_LOCK (_end);
+    end = p->end;
+    G_UNLOCK (_end);
+    if (end < 0) return GST_PAD_PROBE_OK;
+    if (p->segment.format != GST_FORMAT_TIME) return GST_PAD_PROBE_OK;
+
+    start = gst_segment_to_running_time (&p->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (buf));
+    if (start == GST_CLOCK_TIME_NONE) return GST_PAD_PROBE_OK;
+    if (start >= (guint64)end) return GST_PAD_PROBE_DROP;
+    if (GST_BUFFER_DURATION_IS_VALID (buf) == FALSE || start + GST_BUFFER_DURATION (buf) <= (guint64)end) return GST_PAD_PROBE_OK;
+
+    caps = gst_pad_get_current_caps (pad);
+    if (caps == NULL) return GST_PAD_PROBE_OK;
+    if (gst_audio_info_from_caps (&ai, caps) == TRUE && GST_AUDIO_INFO_IS_VALID (&ai)) {
+        gsize samples = gst_util_uint64_scale_int (end - start, GST_AUDIO_INFO_RATE (&ai), GST_SECOND);
+        buf = gst_buffer_make_writable (buf);
+        buf = gst_audio_buffer_truncate (buf, GST_AUDIO_INFO_BPF (&ai), 0, samples);
+        GST_PAD_PROBE_INFO_DATA (info) = buf;
+    }
+    gst_caps_unref (caps);
+    return GST_PAD_PROBE_OK;
+}
+
+/* pre-rendered tune if there is one, the song itself otherwise */
+static void _set_uri (PlayerPipeline *p, Song *s, gint tune)
+{
+    gchar *uri = gst_render_cache_lookup (s, tune);
+    p->cached = uri != NULL;
+    g_object_set (p->playbin, "uri", uri != NULL ? uri : s->uri, NULL);
+    g_free (uri);
+    /* no decoder will tell the length */
+    if (p == _active && p->cached == TRUE && s->type == SONG_TYPE_SID) s->duration = s->tune_duration[tune];
+}
+
 /* This probably is not the best way to get hands to siddec, but siddec is needed to get rid of errors */
 static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data)
 {
+    PlayerPipeline *p = (PlayerPipeline *)data;
+    gboolean active = (p == _active);
+    gint tune = active == TRUE ? _sid_tune_index : p->tune;
     gchar *name = gst_element_get_name (e);
+    gst_diagnostics_watch_element (e);
 #if defined (DEBUG_GST_PLAYER)
     g_critical ("Element: %s", name);
 #endif
-    if (g_str_has_prefix (name, "siddecfp") == TRUE) {
-        _siddec = e;
-        g_object_set (G_OBJECT (e),
-            "tune", _sid_tune_index,
-            "filter", config.sid_filter,
-            "sid-model", config.sid_sid_model,
-            "force-sid-model", config.sid_force_sid_model,
-            "c64-model", config.sid_c64_model,
-            "force-c64-model", config.sid_force_c64_model,
-            "cia-model", config.sid_cia_model,
-            "digi-boost", config.sid_digiboost,
-            "sampling-method", config.sid_sampling_method,
-            "filter-bias", config.sid_filter_bias,
-            "filter-curve-6581", config.sid_filter_curve_6581,
-            "filter-curve-8580", config.sid_filter_curve_8580,
-            "basic", sid_basic (),
-            "kernal", sid_kernal (),
-            "chargen", sid_chargen (),
-            NULL);
-        if (_sid_tune_index > -1) _song->duration = _song->tune_duration[_sid_tune_index];
-    } else if (g_str_has_prefix (name, "siddec") == TRUE) {
-        _siddec = e;
-        g_object_set (G_OBJECT (e), "tune", _sid_tune_index, NULL);
-        if (_sid_tune_index > -1) _song->duration = _song->tune_duration[_sid_tune_index];
+    if (g_str_has_prefix (name, "queue2") == TRUE) {
+        /* fast start: play when this much is buffered, pause only when nearly empty */
+        if (active == TRUE && _song != NULL && _song->type == SONG_TYPE_STREAM && config.stream_start_percent > 0) {
+            g_object_set (G_OBJECT (e),
+                "high-watermark", CLAMP (config.stream_start_percent, 1, 100) / 100.0,
+                "low-watermark", STREAM_LOW_WATERMARK,
+                NULL);
+        }
+    } else if (gst_common_setup_siddec (e, tune) == TRUE) {
+        p->siddec = e;
+        if (active == TRUE && _sid_tune_index > -1) _song->duration = _song->tune_duration[_sid_tune_index];
     }
     g_free (name);
 }
@@ -320,25 +720,67 @@ static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer d
 
 static gboolean _message_handler (GstBus *b, GstMessage *m, gpointer data)
 {
+    PlayerPipeline *p = (PlayerPipeline *)data;
     PlayerMessage msg = PLAYER_MESSAGE_UNKNOWN;
     gpointer d = NULL;
     Song o;
+
+    if (p != _active) {
+        /* standby: keep tags for the swap, errors just drop the preroll */
+        if (GST_MESSAGE_TYPE (m) == GST_MESSAGE_TAG && p->next != NULL) {
+            (void)gst_common_parse_tags (m, p->next);
+        } else if (GST_MESSAGE_TYPE (m) == GST_MESSAGE_ERROR && p == _standby) {
+            _standby_reset ();
+        }
+        return TRUE;
+    }
+
+    if (GST_MESSAGE_TYPE (m) == GST_MESSAGE_STATE_CHANGED && GST_MESSAGE_SRC (m) == GST_OBJECT (p->playbin)) {
+        GstState old_state, new_state;
+        gst_message_parse_state_changed (m, &old_state, &new_state, NULL);
+        if (new_state == GST_STATE_PLAYING) {
+            _reconnect_attempt = 0;
+            _schedule_end ();
+        } else if (old_state == GST_STATE_PLAYING) {
+            _unschedule_end (FALSE);
+            if (_standby_started == TRUE) { /* paused during handover, keep it prerolled */
+                gst_element_set_state (_standby->playbin, GST_STATE_PAUSED);
+                _standby_started = FALSE;
+            }
+        }
+        return TRUE;
+    }
+
     memset (&o, 0, sizeof (Song));
     switch (GST_MESSAGE_TYPE (m)) {
         case GST_MESSAGE_ERROR: {
+            if (_stream_error () == TRUE) break;
             d = "Error: GStreamer";
             msg = PLAYER_MESSAGE_ERROR;
             break;
         }
         case GST_MESSAGE_EOS: {
+            if (_stream_error () == TRUE) break; /* radio does not end */
             msg = PLAYER_MESSAGE_EOS;
             d = (gpointer)&o; /* dummy */
             break;
         }
+        case GST_MESSAGE_BUFFERING: {
+            gint percent = 100;
+            gst_message_parse_buffering (m, &percent);
+            _stream_buffering (percent);
+            msg = PLAYER_MESSAGE_BUFFERING;
+            d = (gpointer)&percent;
+            if (_status_update_func != NULL) _status_update_func (msg, d);
+            d = NULL;
+            break;
+        }
         case GST_MESSAGE_TAG: {
-            msg = PLAYER_MESSAGE_TAG;
-            gst_common_parse_tags (m, &o);
-            d = (gpointer)&o;
+            /* straight to the song, nothing is sent when tags repeat */
+            if (gst_common_parse_tags (m, _song) == TRUE) {
+                msg = PLAYER_MESSAGE_TAG;
+                d = (gpointer)_song;
+            }
             break;
         }
         default:
@@ -350,10 +792,164 @@ static gboolean _message_handler (GstBus *b, GstMessage *m, gpointer data)
     return TRUE;
 }
 
+/* streaming thread: buffer arriving after its render time means the device already ran dry */
+static void _check_late (PlayerPipeline *p, GstBuffer *buf)
+{
+    GstClock *clock;
+    guint64 rt;
+    gboolean late;
+    if (GST_STATE (p->playbin) != GST_STATE_PLAYING || p->segment.format != GST_FORMAT_TIME) return;
+    rt = gst_segment_to_running_time (&p->segment, GST_FORMAT_TIME, GST_BUFFER_PTS (buf));
+    if (rt == GST_CLOCK_TIME_NONE) return;
+    clock = gst_element_get_clock (p->playbin);
+    if (clock == NULL) return;
+    late = gst_clock_get_time (clock) > gst_element_get_base_time (p->playbin) + rt;
+    gst_object_unref (clock);
+    if (late == TRUE && p->late == FALSE) { /* once per dropout */
+        stats_inc (STATS_AUDIO_UNDERRUNS);
+        gst_diagnostics_underrun ();
+    }
+    p->late = late;
+}
+
+/* Streaming threads post ENTER from the thread itself, so it can be changed here */
+static GstBusSyncReply _sync_handler (GstBus *b, GstMessage *m, gpointer data)
+{
+    GstStreamStatusType type;
+    GstElement *owner = NULL;
+    if (GST_MESSAGE_TYPE (m) != GST_MESSAGE_STREAM_STATUS) return GST_BUS_PASS;
+    gst_message_parse_stream_status (m, &type, &owner);
+    if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+        if (config.audio_realtime > 0) _thread_priority_raise ();
+        if (config.diagnostics > 0) gst_diagnostics_thread_enter (owner);
+    } else if (type == GST_STREAM_STATUS_TYPE_LEAVE && config.diagnostics > 0) {
+        gst_diagnostics_thread_leave ();
+    }
+    return GST_BUS_PASS;
+}
+
+/* SCHED_RR needs rtprio limit or CAP_SYS_NICE, nice -10 is tried if it fails */
+static void _thread_priority_raise (void)
+{
+    static gint warned = FALSE;
+    struct sched_param param;
+    memset (&param, 0, sizeof (param));
+    param.sched_priority = CLAMP (config.audio_realtime, sched_get_priority_min (SCHED_RR), sched_get_priority_max (SCHED_RR));
+    if (pthread_setschedparam (pthread_self (), SCHED_RR, &param) == 0) {
+        stats_inc (STATS_AUDIO_RT_THREADS);
+        return;
+    }
+    if (setpriority (PRIO_PROCESS, (id_t)syscall (SYS_gettid), -10) == 0) {
+        stats_inc (STATS_AUDIO_RT_THREADS);
+        return;
+    }
+    if (g_atomic_int_compare_and_exchange (&warned, FALSE, TRUE) == TRUE) {
+        LOG_ERROR ("audio threads keep default priority: %s", g_strerror (errno));
+    }
+}
+
+gchar *player_diagnostics (void)
+{
+    if (_diagnostics_id == 0) return NULL;
+    return gst_diagnostics_report ();
+}
+
+/* every second, log less often */
+static gboolean _diagnostics_timeout (gpointer data)
+{
+    static gint seconds = 0;
+    gst_diagnostics_sample (_active != NULL ? _active->playbin : NULL);
+    if (++seconds >= config.diagnostics) {
+        seconds = 0;
+        if (_state == PLAYER_STATE_PLAYING) gst_diagnostics_log ();
+    }
+    return TRUE;
+}
+
+void player_stream_status (PlayerStreamStatus *status)
+{
+    if (status == NULL) return;
+    status->buffer_percent = _buffer_percent;
+    status->underruns = _underruns;
+    status->reconnects = _reconnects;
+    status->reconnecting = _reconnect_id > 0;
+}
+
+/* user changed state or song: buffering and pending reconnect are forgotten */
+static void _stream_reset (void)
+{
+    if (_reconnect_id > 0) g_source_remove (_reconnect_id);
+    _reconnect_id = 0;
+    _reconnect_attempt = 0;
+    _buffering = FALSE;
+    _stream_started = FALSE;
+    _buffer_percent = 100;
+}
+
+/* Buffering streams are not live: pipeline waits in PAUSED until queue is filled */
+static void _stream_buffering (gint percent)
+{
+    _buffer_percent = percent;
+    if (_state != PLAYER_STATE_PLAYING) return; /* user paused, nothing to resume */
+
+    if (percent < 100 && _buffering == FALSE) {
+        _buffering = TRUE;
+        if (_stream_started == TRUE) {
+            _underruns++;
+            stats_inc (STATS_STREAM_UNDERRUNS);
+        }
+        gst_element_set_state (_active->playbin, GST_STATE_PAUSED);
+    } else if (percent >= 100) {
+        _stream_started = TRUE;
+        if (_buffering == TRUE) {
+            _buffering = FALSE;
+            gst_element_set_state (_active->playbin, GST_STATE_PLAYING);
+        }
+    }
+}
+
+/* TRUE if stream error or end is handled by reconnecting */
+static gboolean _stream_error (void)
+{
+    if (_song == NULL || _song->type != SONG_TYPE_STREAM) return FALSE;
+    if (_state != PLAYER_STATE_PLAYING) return FALSE;
+    if (g_strcmp0 (config.stream_error_action, "default") != 0 && g_strcmp0 (config.stream_error_action, "reconnect") != 0) return FALSE;
+    if (_reconnect_attempt >= config.stream_reconnect_attempts) return FALSE;
+    _reconnect_schedule ();
+    return TRUE;
+}
+
+static void _reconnect_schedule (void)
+{
+    guint delay = STREAM_RECONNECT_MIN_MS << MIN (_reconnect_attempt, 6);
+    if (delay > STREAM_RECONNECT_MAX_MS) delay = STREAM_RECONNECT_MAX_MS;
+    _reconnect_attempt++;
+
+    gst_element_set_state (_active->playbin, GST_STATE_NULL);
+    _buffering = FALSE;
+    _stream_started = FALSE;
+    _buffer_percent = 0;
+    if (_reconnect_id > 0) g_source_remove (_reconnect_id);
+    _reconnect_id = g_timeout_add (delay, _reconnect_timeout, NULL);
+    if (_status_update_func != NULL) _status_update_func (PLAYER_MESSAGE_BUFFERING, (gpointer)&_buffer_percent);
+}
+
+static gboolean _reconnect_timeout (gpointer data)
+{
+    _reconnect_id = 0;
+    if (_song == NULL || _state != PLAYER_STATE_PLAYING) return FALSE;
+    _reconnects++;
+    stats_inc (STATS_STREAM_RECONNECTS);
+    if (gst_element_set_state (_active->playbin, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        if (_reconnect_attempt < config.stream_reconnect_attempts) _reconnect_schedule ();
+    }
+    return FALSE;
+}
+
 static void _on_about_to_finish (GstElement *e, gpointer data)
 {
     Song o;
-    if (_siddec == NULL && _status_update_func != NULL) {
+    if (_active->siddec == NULL && _status_update_func != NULL) {
         memset (&o, 0, sizeof (Song));
         _status_update_func (PLAYER_MESSAGE_ABOUT_TO_FINISH, (gpointer)&o);
     }
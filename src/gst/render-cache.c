@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <gst/gst.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "render-cache.h"
+#include "common.h"
+
+#include "../config.h"
+#include "../paths.h"
+#include "../sid.h"
+#include "../stats.h"
+#include "../log.h"
+
+#define RENDER_CACHE_TAIL_MS 1000 /* player cuts at duration, so its end comes before EOS */
+#define RENDER_CACHE_MAX_MS (30 * 60 * 1000) /* modules which loop */
+#define RENDER_CACHE_POLL_MS 200
+#define RENDER_CACHE_SUFFIX ".flac"
+#define RENDER_CACHE_DIGESTS_MAX 256
+
+typedef struct {
+    gchar *uri;
+    gchar *path; /* cache file, written as path.part first */
+    gint tune;
+    gint64 limit; /* ms of audio to render */
+    gboolean ended; /* streaming thread */
+} RenderJob;
+
+typedef struct {
+    gint64 size;
+    gint64 mtime;
+    gchar *digest;
+} FileDigest;
+
+typedef struct {
+    gchar *path;
+    gint64 mtime;
+    gint64 size;
+} CacheFile;
+
+static gboolean _renderable (Song *s, gint tune);
+static gchar *_key_path (Song *s, gint tune);
+static const gchar *_file_digest (const gchar *path);
+static gchar *_settings_digest (void);
+static void _file_digest_free (gpointer data);
+static void _job_free (RenderJob *j);
+static void _render_func (gpointer data, gpointer user_data);
+static gboolean _render (RenderJob *j, const gchar *tmp);
+static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data);
+static GstPadProbeReturn _limit_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data);
+static void _evict (void);
+static gint _compare_mtime (gconstpointer a, gconstpointer b);
+
+static GThreadPool *_pool = NULL; /* one thread, it is there to save cpu */
+static gint _cancel = FALSE;
+static gchar *_dir = NULL;
+static gchar *_settings = NULL; /* decoder settings part of the key, made on first use */
+static GHashTable *_digests = NULL; /* file path -> FileDigest, main thread */
+static GHashTable *_queued = NULL; /* cache paths queued, rendering or failed. _queued lock */
+G_LOCK_DEFINE_STATIC (_queued);
+
+gboolean gst_render_cache_init (void)
+{
+    GstElementFactory *f;
+    if (config.render_cache_size <= 0) return FALSE;
+    f = gst_element_factory_find ("flacenc");
+    if (f == NULL) {
+        LOG_ERROR ("render cache disabled: no flacenc");
+        return FALSE;
+    }
+    gst_object_unref (f);
+
+    _cancel = FALSE;
+    _dir = paths_saved_data_render_cache_dir ();
+    if (_dir == NULL) goto error;
+    _digests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _file_digest_free);
+    _queued = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    if (_digests == NULL || _queued == NULL) goto error;
+    _pool = g_thread_pool_new (_render_func, NULL, 1, FALSE, NULL);
+    if (_pool == NULL) goto error;
+    return TRUE;
+error:
+    gst_render_cache_free ();
+    return FALSE;
+}
+
+void gst_render_cache_free (void)
+{
+    g_atomic_int_set (&_cancel, TRUE);
+    /* queued jobs run to free themselves, cancel skips rendering */
+    if (_pool != NULL) g_thread_pool_free (_pool, FALSE, TRUE);
+    _pool = NULL;
+    if (_digests != NULL) g_hash_table_destroy (_digests);
+    _digests = NULL;
+    if (_queued != NULL) g_hash_table_destroy (_queued);
+    _queued = NULL;
+    g_free (_settings);
+    _settings = NULL;
+    g_free (_dir);
+    _dir = NULL;
+}
+
+gchar *gst_render_cache_lookup (Song *s, gint tune)
+{
+    gchar *uri = NULL;
+    gchar *path;
+    if (_pool == NULL || _renderable (s, tune) == FALSE) return NULL;
+    path = _key_path (s, tune);
+    if (path == NULL) return NULL;
+    if (g_file_test (path, G_FILE_TEST_IS_REGULAR) == TRUE) {
+        (void)utimes (path, NULL); /* eviction goes by mtime */
+        uri = g_filename_to_uri (path, NULL, NULL);
+        stats_inc (STATS_RENDER_CACHE_HITS);
+    }
+    g_free (path);
+    return uri;
+}
+
+void gst_render_cache_request (Song *s, gint tune)
+{
+    RenderJob *j;
+    gchar *path;
+    gboolean queued;
+    if (_pool == NULL || _renderable (s, tune) == FALSE) return;
+    path = _key_path (s, tune);
+    if (path == NULL) return;
+    if (g_file_test (path, G_FILE_TEST_EXISTS) == TRUE) {
+        g_free (path);
+        return;
+    }
+    G_LOCK (_queued);
+    queued = g_hash_table_contains (_queued, path);
+    if (queued == FALSE) g_hash_table_add (_queued, g_strdup (path));
+    G_UNLOCK (_queued);
+    if (queued == TRUE) {
+        g_free (path);
+        return;
+    }
+
+    j = g_new0 (RenderJob, 1);
+    j->uri = g_strdup (s->uri);
+    j->path = path;
+    j->tune = tune;
+    if (s->type == SONG_TYPE_SID) j->limit = s->tune_duration[tune] + RENDER_CACHE_TAIL_MS;
+    else if (s->duration > 0) j->limit = s->duration + RENDER_CACHE_TAIL_MS;
+    else j->limit = RENDER_CACHE_MAX_MS;
+    if (g_thread_pool_push (_pool, j, NULL) == FALSE) _job_free (j);
+}
+
+/* SID tunes need a length, emulation would not end */
+static gboolean _renderable (Song *s, gint tune)
+{
+    if (s == NULL || s->uri == NULL || g_str_has_prefix (s->uri, "file://") == FALSE) return FALSE;
+    if (s->type == SONG_TYPE_MOD) return TRUE;
+    if (s->type != SONG_TYPE_SID || tune < 0 || tune >= SONG_MAX_TUNES) return FALSE;
+    return s->tune_duration[tune] > 0;
+}
+
+static gchar *_key_path (Song *s, gint tune)
+{
+    const gchar *digest;
+    gchar *name, *ret;
+    gchar *path = g_filename_from_uri (s->uri, NULL, NULL);
+    if (path == NULL) return NULL;
+    digest = _file_digest (path);
+    g_free (path);
+    if (digest == NULL) return NULL;
+    if (_settings == NULL) _settings = _settings_digest ();
+    if (_settings == NULL) return NULL;
+
+    name = g_strdup_printf ("%s-%d-%s" RENDER_CACHE_SUFFIX, digest, s->type == SONG_TYPE_SID ? tune : 0, _settings);
+    ret = g_build_filename (_dir, name, NULL);
+    g_free (name);
+    return ret;
+}
+
+/* content digest, so moved or renamed files still hit. Read again only if the file changed */
+static const gchar *_file_digest (const gchar *path)
+{
+    struct stat st;
+    gchar *contents = NULL;
+    gsize len = 0;
+    FileDigest *d;
+    if (stat (path, &st) != 0 || !S_ISREG (st.st_mode)) return NULL;
+    d = (FileDigest *)g_hash_table_lookup (_digests, path);
+    if (d != NULL && d->size == (gint64)st.st_size && d->mtime == (gint64)st.st_mtime) return d->digest;
+
+    if (g_file_get_contents (path, &contents, &len, NULL) == FALSE) return NULL;
+    d = g_new0 (FileDigest, 1);
+    d->size = (gint64)st.st_size;
+    d->mtime = (gint64)st.st_mtime;
+    d->digest = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *)contents, len);
+    g_free (contents);
+    if (g_hash_table_size (_digests) >= RENDER_CACHE_DIGESTS_MAX) g_hash_table_remove_all (_digests);
+    g_hash_table_replace (_digests, g_strdup (path), d);
+    return d->digest;
+}
+
+/* everything that changes what siddec outputs, roms included */
+static gchar *_settings_digest (void)
+{
+    GByteArray *roms[3] = { sid_kernal (), sid_basic (), sid_chargen () };
+    gchar *settings, *digest, *ret;
+    GChecksum *c = g_checksum_new (G_CHECKSUM_SHA1);
+    if (c == NULL) return NULL;
+    settings = g_strdup_printf ("%d %d %d %d %d %d %d %d %g %g %g",
+        config.sid_filter, config.sid_sid_model, config.sid_force_sid_model,
+        config.sid_c64_model, config.sid_force_c64_model, config.sid_cia_model,
+        config.sid_digiboost, config.sid_sampling_method,
+        config.sid_filter_bias, config.sid_filter_curve_6581, config.sid_filter_curve_8580);
+    g_checksum_update (c, (const guchar *)settings, -1);
+    g_free (settings);
+    for (gint i = 0; i < 3; i++) {
+        if (roms[i] != NULL) g_checksum_update (c, roms[i]->data, roms[i]->len);
+    }
+    digest = g_strdup (g_checksum_get_string (c));
+    g_checksum_free (c);
+    ret = g_strndup (digest, 12);
+    g_free (digest);
+    return ret;
+}
+
+static void _file_digest_free (gpointer data)
+{
+    FileDigest *d = (FileDigest *)data;
+    g_free (d->digest);
+    g_free (d);
+}
+
+static void _job_free (RenderJob *j)
+{
+    g_free (j->uri);
+    g_free (j->path);
+    g_free (j);
+}
+
+static void _render_func (gpointer data, gpointer user_data)
+{
+    RenderJob *j = (RenderJob *)data;
+    gchar *tmp = g_strconcat (j->path, ".part", NULL);
+    if (g_atomic_int_get (&_cancel) == FALSE && _render (j, tmp) == TRUE && g_rename (tmp, j->path) == 0) {
+        stats_inc (STATS_RENDERED_TUNES);
+        LOG_DEBUG ("%s tune %d: %s", j->uri, j->tune, j->path);
+        G_LOCK (_queued);
+        g_hash_table_remove (_queued, j->path);
+        G_UNLOCK (_queued);
+        _evict ();
+    } else {
+        (void)g_unlink (tmp); /* failed ones stay queued, not tried again */
+    }
+    g_free (tmp);
+    _job_free (j);
+}
+
+static gboolean _render (RenderJob *j, const gchar *tmp)
+{
+    gboolean ret = FALSE;
+    GstElement *e;
+    GstBus *bus = NULL;
+    GstPad *pad;
+    GstElement *pipeline = gst_parse_launch ("uridecodebin name=src ! audioconvert name=conv ! flacenc ! filesink name=sink", NULL);
+    if (pipeline == NULL) return FALSE;
+
+    g_signal_connect (GST_BIN (pipeline), "deep-element-added", G_CALLBACK (_on_element_added), j);
+    e = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+    g_object_set (e, "uri", j->uri, NULL);
+    gst_object_unref (e);
+    e = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+    g_object_set (e, "location", tmp, NULL);
+    gst_object_unref (e);
+    e = gst_bin_get_by_name (GST_BIN (pipeline), "conv");
+    pad = gst_element_get_static_pad (e, "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, _limit_probe, j, NULL);
+    gst_object_unref (pad);
+    gst_object_unref (e);
+
+    bus = gst_element_get_bus (pipeline);
+    if (gst_element_set_state (pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) goto render_error;
+    while (g_atomic_int_get (&_cancel) == FALSE) {
+        GstMessage *m = gst_bus_timed_pop_filtered (bus, RENDER_CACHE_POLL_MS * GST_MSECOND, GST_MESSAGE_EOS|GST_MESSAGE_ERROR);
+        if (m == NULL) continue;
+        ret = GST_MESSAGE_TYPE (m) == GST_MESSAGE_EOS;
+        gst_message_unref (m);
+        break;
+    }
+
+render_error:
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+    return ret;
+}
+
+static void _on_element_added (GstBin *p0, GstBin *p1, GstElement *e, gpointer data)
+{
+    RenderJob *j = (RenderJob *)data;
+    (void)gst_common_setup_siddec (e, j->tune);
+}
+
+/* SID emulation does not end by itself */
+static GstPadProbeReturn _limit_probe (GstPad *pad, GstPadProbeInfo *info, gpointer data)
+{
+    RenderJob *j = (RenderJob *)data;
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (j->ended == TRUE) return GST_PAD_PROBE_DROP;
+    if (buf == NULL || GST_BUFFER_PTS_IS_VALID (buf) == FALSE) return GST_PAD_PROBE_OK;
+    if (GST_BUFFER_PTS (buf) < (GstClockTime)j->limit * GST_MSECOND) return GST_PAD_PROBE_OK;
+    j->ended = TRUE;
+    gst_pad_push_event (pad, gst_event_new_eos ());
+    return GST_PAD_PROBE_DROP;
+}
+
+/* least recently played go first */
+static void _evict (void)
+{
+    const gchar *name;
+    gint64 total = 0;
+    gint64 cap = (gint64)config.render_cache_size * 1024 * 1024;
+    GArray *files;
+    GDir *dir = g_dir_open (_dir, 0, NULL);
+    if (dir == NULL) return;
+
+    files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        struct stat st;
+        CacheFile f;
+        if (g_str_has_suffix (name, RENDER_CACHE_SUFFIX) == FALSE) continue;
+        f.path = g_build_filename (_dir, name, NULL);
+        if (stat (f.path, &st) != 0) {
+            g_free (f.path);
+            continue;
+        }
+        f.mtime = (gint64)st.st_mtime;
+        f.size = (gint64)st.st_size;
+        total += f.size;
+        g_array_append_val (files, f);
+    }
+    g_dir_close (dir);
+
+    g_array_sort (files, _compare_mtime);
+    for (guint i = 0; i < files->len; i++) {
+        CacheFile *f = &g_array_index (files, CacheFile, i);
+        if (total > cap && g_unlink (f->path) == 0) total -= f->size;
+        g_free (f->path);
+    }
+    g_array_free (files, TRUE);
+}
+
+static gint _compare_mtime (gconstpointer a, gconstpointer b)
+{
+    const CacheFile *fa = (const CacheFile *)a;
+    const CacheFile *fb = (const CacheFile *)b;
+    if (fa->mtime < fb->mtime) return -1;
+    return fa->mtime > fb->mtime;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_GST_RENDER_CACHE_H_
+#define _KK_GST_RENDER_CACHE_H_
+
+#include <glib.h>
+
+#include "song.h"
+
+/*
+ * SID tunes and modules rendered to FLAC in a background thread. Files
+ * are named by file digest, tune and decoder settings, oldest used ones
+ * are removed when the cache grows over render_cache_size.
+ */
+
+gboolean gst_render_cache_init (void);
+void gst_render_cache_free (void);
+
+/* Uri of the rendered tune or NULL. Caller frees */
+gchar *gst_render_cache_lookup (Song *s, gint tune);
+/* Renders the tune later if it is not cached yet */
+void gst_render_cache_request (Song *s, gint tune);
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_INSPECTOR_BACKEND_H_
+#define _KK_INSPECTOR_BACKEND_H_
+
+#include <glib.h>
+
+#include "song.h"
+
+/*
+ * Probing of single uris for inspector. Directory walk, negative cache,
+ * native tags and remote playlists are done by inspector itself.
+ * Application links gst/inspector-backend.c, benchmarks can link a fake one.
+ */
+
+typedef enum {
+    INSPECTOR_PROBE_FOUND,
+    INSPECTOR_PROBE_NOT_PLAYABLE, /* probe finished and found nothing decodable */
+    INSPECTOR_PROBE_FAILED        /* timed out, quarantined or maybe temporary failure */
+} InspectorProbeResult;
+
+gboolean inspector_backend_init (void);
+void inspector_backend_free (void);
+
+const gchar *inspector_backend_name (void);
+
+gboolean inspector_backend_uri_is_valid (const gchar *uri);
+/* Newly allocated uri for local file path */
+gchar *inspector_backend_filename_to_uri (const gchar *path);
+
+/* Cheap check before probing. FALSE if file can not be anything playable. */
+gboolean inspector_backend_is_possibly_supported (const gchar *filepath);
+
+/* Main loop only. Sets tags, duration and type of s. */
+InspectorProbeResult inspector_backend_try_uri (const gchar *uri, Song *s);
+
+/* Main loop only. Forgets files which have timed out. Returns their count. */
+guint inspector_backend_quarantine_clear (void);
+
+/* Thread safe. Only checks that stream can be played. */
+gboolean inspector_backend_probe_stream (const gchar *uri);
+
+/* Tunes playable from sid with given tune count: 0 is default tune only, -1
+ * when sid can not be played at all. */
+gint inspector_backend_sid_tunes (guint tunes);
+
+#endif
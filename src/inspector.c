@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <libintl.h>
+#define _(String) gettext (String)
+
+#include "inspector.h"
+#include "inspector-backend.h"
+#include "playlist.h"
+#include "playlist-pls.h"
+#include "net.h"
+#include "util.h"
+#include "sid.h"
+#include "negative-cache.h"
+#include "tag-reader.h"
+#include "stats.h"
+
+#define ABSOLUTELY_MAX_STR_LEN 4096
+
+#define INSPECTOR_MAX_REMOTE_PLAYLISTS 2
+#define INSPECTOR_MAX_PARALLEL_PROBES 4
+
+typedef struct {
+    gchar *url;
+    InspectorSongFoundFunc found;
+    gpointer user_data;
+    gint ref; /* atomic. last unref finishes job in main loop */
+    guint found_count; /* main loop only */
+} RemotePlaylistJob;
+
+typedef struct {
+    RemotePlaylistJob *job;
+    Song *song;
+} ProbeTask;
+
+gchar _status_str[ABSOLUTELY_MAX_STR_LEN] = "";
+
+const gchar *_supported_streams[] = { "http://", "https://", "smb://", "ftp://", "ssh://" };
+
+static void _update_status (GList *l);
+static void _update_status_count (guint len);
+static GList *_run_path (const gchar *path);
+static GList *_add_dir (const gchar *dirpath, GList **dirs);
+static GList *_try_add_file (const gchar *filepath);
+static GList *_add_uri (const gchar *uri);
+static void _job_unref (RemotePlaylistJob *job);
+static gboolean _job_done_idle (gpointer user_data);
+static void _resolve_func (gpointer data, gpointer user_data);
+static void _probe_func (gpointer data, gpointer user_data);
+static gboolean _song_found_idle (gpointer user_data);
+static gboolean _try_native_tags (const gchar *filepath, Song *s);
+static InspectorProbeResult _probe (const gchar *uri, Song *s);
+static void _count_probe (gint64 start, gboolean hit);
+
+static ScreenStatusUpdateFunc _status_update_func = NULL;
+static ScreenStatusUpdateFunc _playlist_update_func = NULL;
+
+static GThreadPool *_resolve_pool = NULL; /* downloads remote playlists */
+static GThreadPool *_probe_pool = NULL; /* probes streams in parallel */
+static gint _quitting = FALSE; /* atomic */
+
+gboolean inspector_init (ScreenStatusUpdateFunc status_update_func, ScreenStatusUpdateFunc playlist_update_func)
+{
+    sid_init ();
+    _status_update_func = status_update_func;
+    _playlist_update_func = playlist_update_func;
+    g_atomic_int_set (&_quitting, FALSE);
+
+    if (inspector_backend_init () == FALSE) goto error;
+
+    negative_cache_init ();
+
+    _resolve_pool = g_thread_pool_new (_resolve_func, NULL, INSPECTOR_MAX_REMOTE_PLAYLISTS, FALSE, NULL);
+    if (_resolve_pool == NULL) goto error;
+    _probe_pool = g_thread_pool_new (_probe_func, NULL, INSPECTOR_MAX_PARALLEL_PROBES, FALSE, NULL);
+    if (_probe_pool == NULL) goto error;
+
+    return TRUE;
+error:
+    inspector_free ();
+    return FALSE;
+}
+
+void inspector_free (void)
+{
+    /* queued jobs see this and just free themselves */
+    g_atomic_int_set (&_quitting, TRUE);
+    if (_resolve_pool != NULL) g_thread_pool_free (_resolve_pool, FALSE, TRUE);
+    _resolve_pool = NULL;
+    if (_probe_pool != NULL) g_thread_pool_free (_probe_pool, FALSE, TRUE);
+    _probe_pool = NULL;
+
+    inspector_backend_free ();
+    negative_cache_free ();
+    sid_free ();
+}
+
+const gchar *inspector_status (void)
+{
+    return _status_str;
+}
+
+static void _update_status (GList *l)
+{
+    _update_status_count (g_list_length (l));
+}
+
+static void _update_status_count (guint len)
+{
+    if (len > 1) g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, _("%d items added to the playlist."), len);
+    else if (len > 0) g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, _("One item added to the playlist."));
+    else g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, " ");
+    if (_status_update_func != NULL) _status_update_func ();
+}
+
+GList *inspector_run (gchar *path)
+{
+    gint i;
+    GList *l = NULL;
+    const gchar *p = g_strstrip (path); /* path must be null terminated string */
+    for (i = 0; i < sizeof (_supported_streams) / sizeof (char *); i++) {
+        if (g_str_has_prefix (p, _supported_streams[i]) == TRUE) {
+            if (g_str_has_suffix (p, ".pls") == TRUE) {
+                gchar *content = net_get ((const gchar *)p);
+                if (content != NULL) l = playlist_pls_parse_raw (content);
+                g_free (content);
+            } else {
+                l = _add_uri (p);
+            }
+            _update_status (l);
+            return l;
+        }
+    }
+    l = _run_path (p);
+    _update_status (l);
+    return l;
+}
+
+gboolean inspector_is_stream (const gchar *uri)
+{
+    if (uri == NULL) return FALSE;
+    for (gint i = 0; i < sizeof (_supported_streams) / sizeof (char *); i++) {
+        if (g_str_has_prefix (uri, _supported_streams[i]) == TRUE) return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean inspector_is_remote_playlist (const gchar *path)
+{
+    gboolean ret;
+    gchar *p;
+    if (path == NULL) return FALSE;
+    p = g_strstrip (g_strdup (path));
+    if (p == NULL) return FALSE;
+    ret = inspector_is_stream (p) && g_str_has_suffix (p, ".pls");
+    g_free (p);
+    return ret;
+}
+
+gboolean inspector_run_remote_playlist (const gchar *url, InspectorSongFoundFunc found, gpointer user_data)
+{
+    RemotePlaylistJob *job;
+    if (url == NULL || found == NULL || _resolve_pool == NULL) return FALSE;
+
+    job = g_new0 (RemotePlaylistJob, 1);
+    if (job == NULL) return FALSE;
+    job->url = g_strstrip (g_strdup (url));
+    if (job->url == NULL) {
+        g_free (job);
+        return FALSE;
+    }
+    job->found = found;
+    job->user_data = user_data;
+    job->ref = 1; /* released by _resolve_func */
+
+    g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, _("Loading stream playlist: %s"), job->url);
+    if (_status_update_func != NULL) _status_update_func ();
+
+    if (g_thread_pool_push (_resolve_pool, job, NULL) == FALSE) {
+        g_free (job->url);
+        g_free (job);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void _job_unref (RemotePlaylistJob *job)
+{
+    if (g_atomic_int_dec_and_test (&job->ref)) g_idle_add (_job_done_idle, job);
+}
+
+static gboolean _job_done_idle (gpointer user_data)
+{
+    RemotePlaylistJob *job = (RemotePlaylistJob *)user_data;
+    if (job->found_count == 0) {
+        g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, _("No streams found: %s"), job->url);
+        if (_status_update_func != NULL) _status_update_func ();
+    }
+    g_free (job->url);
+    g_free (job);
+    return FALSE;
+}
+
+/* thread pool. downloads playlist and queues its streams for probing */
+static void _resolve_func (gpointer data, gpointer user_data)
+{
+    RemotePlaylistJob *job = (RemotePlaylistJob *)data;
+    gchar *content = NULL;
+    GList *l = NULL;
+    (void)user_data;
+
+    if (g_atomic_int_get (&_quitting) == FALSE) {
+        content = net_get (job->url); /* bounded by network_timeout */
+        if (content != NULL) l = playlist_pls_parse_raw_streams (content);
+        g_free (content);
+    }
+
+    for (GList *p = l; p != NULL; p = p->next) {
+        ProbeTask *task = g_new0 (ProbeTask, 1);
+        if (task == NULL) {
+            song_delete ((Song *)p->data);
+            continue;
+        }
+        task->song = (Song *)p->data;
+        task->job = job;
+        g_atomic_int_inc (&job->ref);
+        if (g_thread_pool_push (_probe_pool, task, NULL) == FALSE) {
+            song_delete (task->song);
+            g_free (task);
+            _job_unref (job);
+        }
+    }
+    g_list_free (l);
+    _job_unref (job);
+}
+
+/* thread pool. probes one stream */
+static void _probe_func (gpointer data, gpointer user_data)
+{
+    ProbeTask *task = (ProbeTask *)data;
+    gboolean bret = FALSE;
+    gint64 start;
+    (void)user_data;
+
+    if (g_atomic_int_get (&_quitting) == FALSE) {
+        start = g_get_monotonic_time ();
+        bret = inspector_backend_probe_stream (task->song->uri);
+        _count_probe (start, bret);
+    }
+    if (bret == TRUE) {
+        g_idle_add (_song_found_idle, task);
+        return;
+    }
+    song_delete (task->song);
+    _job_unref (task->job);
+    g_free (task);
+}
+
+static gboolean _song_found_idle (gpointer user_data)
+{
+    ProbeTask *task = (ProbeTask *)user_data;
+    RemotePlaylistJob *job = task->job;
+
+    job->found (task->song, job->user_data);
+    job->found_count++;
+    _update_status_count (job->found_count);
+    if (_playlist_update_func != NULL) _playlist_update_func ();
+
+    _job_unref (job);
+    g_free (task);
+    return FALSE;
+}
+
+GList *inspector_add_no_check (gchar *path)
+{
+    gboolean bret;
+    gint i;
+    gchar *uri = NULL;
+    GList *l = NULL;
+    if (inspector_backend_uri_is_valid (path)) {
+        uri = g_strdup (path);
+    } else {
+        uri = inspector_backend_filename_to_uri (path);
+    }
+    if (uri == NULL) return NULL;
+    Song *s = song_new (uri);
+    if (s == NULL) goto no_check_error;
+    const gchar *p = g_strstrip (uri); /* path must be null terminated string */
+    for (i = 0; i < sizeof (_supported_streams) / sizeof (char *); i++) {
+        if (g_str_has_prefix (p, _supported_streams[i]) == TRUE) {
+            song_set_type (s, SONG_TYPE_STREAM);
+            l = g_list_append (l, s);
+            g_free (uri);
+            return l;
+        }
+    }
+    /* for normal files normal check */
+    song_set_type (s, SONG_TYPE_FILE);
+    bret = inspector_try_uri (uri, s);
+    if (bret == FALSE) goto no_check_error;
+    else l = g_list_append (l, s);
+    g_free (uri);
+    return l;
+no_check_error:
+    g_free (uri);
+    if (s != NULL) song_delete (s);
+    return NULL;
+}
+
+guint inspector_clear_quarantine (void)
+{
+    return inspector_backend_quarantine_clear () + negative_cache_clear (NEGATIVE_CACHE_NOT_PLAYABLE);
+}
+
+gboolean inspector_try_uri (gchar *uri, Song *s)
+{
+    return _probe (uri, s) == INSPECTOR_PROBE_FOUND;
+}
+
+static GList *_add_uri (const gchar *uri)
+{
+    GList *l = NULL;
+    gchar *ptitle;
+    gchar *tmp = NULL;
+    gboolean bret = FALSE;
+    size_t len = strlen (uri);
+    if (len < 4) goto uri_error; /* is long enough */
+    tmp = g_strdup (uri);
+    if (tmp == NULL) goto uri_error; 
+    ptitle = tmp;
+    while (*ptitle != ' ' && *ptitle != '\0') ptitle++; /* find next space */
+    if (*ptitle == ' ') {
+        *ptitle = '\0'; /* actual uri */
+        ptitle++;
+    }
+    while (*ptitle == ' ' && *ptitle != '\0') ptitle++; /* removes extra spaces */
+    if (*ptitle == '\0') ptitle = tmp; /* use uri as title */
+
+    if (inspector_backend_uri_is_valid (tmp)) {
+        Song *s = song_new (tmp);
+        if (s == NULL) return NULL;
+        song_set_type (s, SONG_TYPE_STREAM);
+        bret = inspector_try_uri (tmp, s);
+        song_set_stream_title (s, ptitle);
+        if (bret == FALSE) song_delete (s);
+        else l = g_list_prepend (l, s);
+    }
+uri_error:
+    if (tmp != NULL) g_free (tmp);
+    return l;
+}
+
+static GList *_run_path (const gchar *path)
+{
+    GList *l = NULL;
+    GList *l0 = NULL;
+    GList *dirs = NULL;
+    GList *dir = NULL;
+
+    if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+        dirs = g_list_prepend (dirs, g_strdup (path));
+        for (dir = g_list_last (dirs); dir != NULL; dir = dir->prev) {
+            g_snprintf (_status_str, ABSOLUTELY_MAX_STR_LEN-1, _("%c Scanning dir: %s"), util_progress (), (gchar *)dir->data);
+            if (_status_update_func != NULL) _status_update_func ();
+            l0 = _add_dir (dir->data, &dirs);
+            g_free (dir->data);
+            if (l0 != NULL) l = g_list_concat (l, l0);
+        }
+        g_list_free (dirs);
+    } else {
+        l0 = _try_add_file (path);
+        if (l0 != NULL) l = g_list_concat (l, l0);
+    }
+    l = g_list_sort (l, song_sort_by_path); /* FIXME: !!!*/
+    return l;
+}
+
+static GList *_add_dir (const gchar *dirpath, GList **dirs)
+{
+    GList *l = NULL;
+    GList *l0 = NULL;
+    const gchar *name;
+    GDir *dir;
+    GError *error = NULL;
+
+    dir = g_dir_open (dirpath, 0, &error);
+    if (error != NULL) { /* FIXME: Files also !!!*/
+        return NULL;
+    }
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar path[ABSOLUTELY_MAX_STR_LEN];
+        // FIXME: is there better way to concat paths
+        g_snprintf (path, ABSOLUTELY_MAX_STR_LEN, "%s%s%s", dirpath, G_DIR_SEPARATOR_S, name);
+        if (g_file_test (path, G_FILE_TEST_IS_DIR)) {
+            *dirs = g_list_prepend (*dirs, g_strdup (path));
+        } else {
+            l0 = _try_add_file (path);
+            if (l0 != NULL) {
+                l = g_list_concat (l, l0);
+            }
+        }
+    }
+
+    g_dir_close (dir);
+
+    return l;
+}
+
+static GList *_try_add_file (const gchar *filepath0)
+{
+    gchar *uri = NULL;
+    GList *l = NULL;
+    Song *s = NULL;
+    gint ret;
+    gboolean bret = FALSE;
+    InspectorProbeResult result;
+    gchar filepath[PATH_MAX] = "";
+    if (FALSE == util_expand_tilde (filepath0, filepath)) return NULL;
+    stats_inc (STATS_FILES_WALKED);
+
+    /* known junk from earlier scans */
+    if (negative_cache_has (filepath, NEGATIVE_CACHE_NOT_PLAYABLE) == TRUE) return NULL;
+
+    if (inspector_backend_uri_is_valid (filepath)) {
+        uri = g_strdup (filepath);
+    } else {
+        uri = inspector_backend_filename_to_uri (filepath);
+    }
+    if (uri == NULL) goto try_add_file_error;
+
+    s = song_new (uri);
+    if (s == NULL) goto try_add_file_error;
+
+    ret = song_set_type (s, SONG_TYPE_FILE);
+
+    /* common formats without building a pipeline */
+    bret = _try_native_tags (filepath, s);
+    if (bret == TRUE) goto try_add_file_error;
+
+    stats_inc (STATS_MAGIC_CHECKS);
+    if (inspector_backend_is_possibly_supported (filepath) == FALSE) {
+        negative_cache_add (filepath, NEGATIVE_CACHE_NOT_PLAYABLE | NEGATIVE_CACHE_NOT_PLAYLIST);
+        goto try_add_file_error;
+    }
+
+    result = _probe (uri, s);
+    bret = result == INSPECTOR_PROBE_FOUND;
+    /* timeouts and temporary failures are tried again on next scan */
+    if (result == INSPECTOR_PROBE_NOT_PLAYABLE) negative_cache_add (filepath, NEGATIVE_CACHE_NOT_PLAYABLE);
+try_add_file_error:
+    if (bret == FALSE) song_delete (s);
+    else if (s != NULL) l = g_list_prepend (l, s);
+    g_free (uri);
+    (void)ret;
+    return l;
+}
+
+/* header parsing, no pipeline needed */
+static gboolean _try_native_tags (const gchar *filepath, Song *s)
+{
+    gint tunes;
+    if (tag_reader_read (filepath, s) == FALSE) return FALSE;
+    if (s->type == SONG_TYPE_SID) {
+        tunes = inspector_backend_sid_tunes (s->tunes);
+        if (tunes < 0) { /* no decoder, backend decides */
+            (void)song_set_type (s, SONG_TYPE_FILE);
+            return FALSE;
+        }
+        sid_setup_song (s, tunes);
+    }
+    return TRUE;
+}
+
+static InspectorProbeResult _probe (const gchar *uri, Song *s)
+{
+    gint64 start = g_get_monotonic_time ();
+    InspectorProbeResult result = inspector_backend_try_uri (uri, s);
+    _count_probe (start, result == INSPECTOR_PROBE_FOUND);
+    return result;
+}
+
+static void _count_probe (gint64 start, gboolean hit)
+{
+    stats_record (STATS_PROBE_LATENCY, g_get_monotonic_time () - start);
+    stats_inc (STATS_PROBES);
+    stats_inc (hit == TRUE ? STATS_PROBE_HITS : STATS_PROBE_MISSES);
+}
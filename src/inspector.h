@@ -24,7 +24,11 @@
 
 typedef void (*ScreenStatusUpdateFunc)(void);
 
-gboolean inspector_init (ScreenStatusUpdateFunc status_update);
+/* Called from main loop for each song found in background. Callee owns song. */
+typedef void (*InspectorSongFoundFunc)(Song *s, gpointer user_data);
+
+/* playlist_update is called when background search has added songs */
+gboolean inspector_init (ScreenStatusUpdateFunc status_update, ScreenStatusUpdateFunc playlist_update);
 void inspector_free (void);
 
 const gchar *inspector_status (void);
@@ -32,6 +36,18 @@ const gchar *inspector_status (void);
 GList *inspector_run (gchar *path);
 GList *inspector_add_no_check (gchar *uri);
 
+gboolean inspector_is_stream (const gchar *uri);
+/* TRUE if path is .pls behind network address */
+gboolean inspector_is_remote_playlist (const gchar *path);
+/*
+ * Downloads and parses playlist in background thread. Streams are probed
+ * in parallel with deadline and found ones are given to found one by one.
+ */
+gboolean inspector_run_remote_playlist (const gchar *url, InspectorSongFoundFunc found, gpointer user_data);
+
+/* Files which have timed out are probed again. Returns their count. */
+guint inspector_clear_quarantine (void);
+
 /* Actual test part. Used also in raw/net downloaded playlist */
 gboolean inspector_try_uri (gchar *uri, Song *s);
 
@@ -23,8 +23,39 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOG_RING_LINES 128 /* per thread, must be power of two */
+#define LOG_LINE_MAX 512 /* longer lines are split */
+#define LOG_DRAIN_MIN_MS 20
+#define LOG_DRAIN_MAX_MS 500 /* idle drainer backs off to this */
+
+/* Single producer (owner thread), single consumer (drain thread) */
+typedef struct {
+    guint head; /* next line to write. owner only stores */
+    guint tail; /* next line to drain. drain thread only stores */
+    gint dead; /* owner thread has exited */
+    long tid;
+    gint64 second; /* of cached date */
+    gchar date[32]; /* "YYYY-MM-DD HH:MM:SS" */
+    gchar lines[LOG_RING_LINES][LOG_LINE_MAX];
+} LogRing;
+
+static LogRing *_ring (void);
+static void _ring_release (gpointer data);
+static gsize _prefix (LogRing *r, int level, const char *func, gchar *buf, gsize size);
+static guint _reserve (LogRing *r);
+static void _write_split (LogRing *r, const gchar *prefix, gsize len, const gchar *msg);
+static gboolean _drain_ring (LogRing *r);
+static gboolean _drain (void);
+static gpointer _drain_thread (gpointer data);
+
+static const char *_level_names[] = { "ERROR", "INFO", "DEBUG" };
 
 FILE *log_file = 0;
 int log_debugging_on = 0;
@@ -33,6 +64,13 @@ static int stderr_fd = -1;
 static int save_err = -1;
 #endif
 
+static GPrivate _local = G_PRIVATE_INIT (_ring_release);
+static GMutex _mutex; /* _rings, _quit and drain passes */
+static GCond _cond;
+static GSList *_rings = NULL;
+static GThread *_thread = NULL;
+static gboolean _quit = FALSE;
+
 int log_init (const char *file_path) {
     int retval = 0;
 #if defined(REDIRECT_STDERR_TO_FILE)
@@ -48,6 +86,8 @@ int log_init (const char *file_path) {
         return -1;
     }
     log_file = file;
+    _quit = FALSE;
+    _thread = g_thread_new ("Log", _drain_thread, NULL);
 #if defined(REDIRECT_STDERR_TO_FILE)
     /* stderr to file. some gst plugings for example might have problems and
      * prints to stderr */
@@ -75,10 +115,35 @@ error:
 }
 
 void log_destroy (void) {
+    LogRing *r;
+    if (_thread != NULL) {
+        g_mutex_lock (&_mutex);
+        _quit = TRUE;
+        g_cond_signal (&_cond);
+        g_mutex_unlock (&_mutex);
+        g_thread_join (_thread); /* drains all */
+        _thread = NULL;
+    }
+    g_mutex_lock (&_mutex);
     if (log_file) {
         fclose (log_file);
         log_file = 0;
     }
+    /* calling thread gets new ring if log is opened again */
+    r = (LogRing *)g_private_get (&_local);
+    if (r != NULL) __atomic_store_n (&r->dead, TRUE, __ATOMIC_RELEASE);
+    g_private_set (&_local, NULL);
+    /* rings of threads still alive are theirs, they stay listed */
+    for (GSList *l = _rings; l != NULL;) {
+        GSList *next = l->next;
+        r = (LogRing *)l->data;
+        if (__atomic_load_n (&r->dead, __ATOMIC_ACQUIRE) == TRUE) {
+            _rings = g_slist_delete_link (_rings, l);
+            g_free (r);
+        }
+        l = next;
+    }
+    g_mutex_unlock (&_mutex);
 #if defined(REDIRECT_STDERR_TO_FILE)
     fflush (stderr);
     if (stderr_fd > 0) close (stderr_fd);
@@ -88,3 +153,170 @@ void log_destroy (void) {
     }
 #endif
 }
+
+void log_write (int level, const char *func, const char *fmt, ...)
+{
+    va_list args;
+    LogRing *r = _ring ();
+    gchar *line;
+    gchar prefix[LOG_LINE_MAX];
+    gchar *msg;
+    gsize len;
+    int n;
+    guint head;
+
+    if (r == NULL) return;
+    head = _reserve (r);
+    line = r->lines[head & (LOG_RING_LINES - 1)];
+    len = _prefix (r, level, func, line, LOG_LINE_MAX);
+    va_start (args, fmt);
+    n = vsnprintf (line + len, LOG_LINE_MAX - len, fmt, args);
+    va_end (args);
+    if (n < 0) return;
+    if (len + n + 1 < LOG_LINE_MAX) {
+        line[len + n] = '\n';
+        line[len + n + 1] = '\0';
+        __atomic_store_n (&r->head, head + 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    /* too long: split to lines with same prefix */
+    len = MIN (len, LOG_LINE_MAX / 2);
+    memcpy (prefix, line, len);
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    _write_split (r, prefix, len, msg);
+    g_free (msg);
+}
+
+/* first line of thread registers its ring */
+static LogRing *_ring (void)
+{
+    LogRing *r = (LogRing *)g_private_get (&_local);
+    if (G_LIKELY (r != NULL)) return r;
+
+    r = g_new0 (LogRing, 1);
+    if (r == NULL) return NULL;
+    r->tid = (long)syscall (SYS_gettid);
+    r->second = -1;
+    g_mutex_lock (&_mutex);
+    _rings = g_slist_prepend (_rings, r);
+    g_mutex_unlock (&_mutex);
+    g_private_set (&_local, r);
+    return r;
+}
+
+/* thread exit. drain thread frees ring when it is empty */
+static void _ring_release (gpointer data)
+{
+    LogRing *r = (LogRing *)data;
+    __atomic_store_n (&r->dead, TRUE, __ATOMIC_RELEASE);
+}
+
+/* "YYYY-MM-DD HH:MM:SS.uuuuuu [tid] [LEVEL] func: " */
+static gsize _prefix (LogRing *r, int level, const char *func, gchar *buf, gsize size)
+{
+    gint64 now = g_get_real_time ();
+    gint64 second = now / G_USEC_PER_SEC;
+    int n;
+
+    if (second != r->second) {
+        struct tm tm;
+        time_t t = (time_t)second;
+        localtime_r (&t, &tm);
+        strftime (r->date, sizeof (r->date), "%Y-%m-%d %H:%M:%S", &tm);
+        r->second = second;
+    }
+    n = snprintf (buf, size, "%s.%06d [%ld] [%s] %s: ", r->date, (int)(now % G_USEC_PER_SEC),
+        r->tid, _level_names[level], func);
+    if (n < 0) return 0;
+    return (gsize)n < size ? (gsize)n : size - 1;
+}
+
+/*
+ * Returns head of a free line. When ring is full owner drains it itself
+ * instead of writing around it, so its lines stay in order.
+ */
+static guint _reserve (LogRing *r)
+{
+    guint head = __atomic_load_n (&r->head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n (&r->tail, __ATOMIC_ACQUIRE) < LOG_RING_LINES) return head;
+    g_mutex_lock (&_mutex);
+    if (log_file == NULL) { /* closed after caller checked it */
+        __atomic_store_n (&r->tail, head, __ATOMIC_RELEASE);
+    } else if (_drain_ring (r) == TRUE) {
+        fflush (log_file);
+    }
+    g_mutex_unlock (&_mutex);
+    return head;
+}
+
+/* prefix is len bytes, not terminated. utf-8 characters are not split */
+static void _write_split (LogRing *r, const gchar *prefix, gsize len, const gchar *msg)
+{
+    gsize room = LOG_LINE_MAX - len - 2; /* newline and terminator */
+    gsize left = strlen (msg);
+    do {
+        guint head = _reserve (r);
+        gchar *line = r->lines[head & (LOG_RING_LINES - 1)];
+        gsize take = MIN (left, room);
+        while (take < left && take > 1 && (msg[take] & 0xC0) == 0x80) take--;
+        memcpy (line, prefix, len);
+        memcpy (line + len, msg, take);
+        line[len + take] = '\n';
+        line[len + take + 1] = '\0';
+        __atomic_store_n (&r->head, head + 1, __ATOMIC_RELEASE);
+        msg += take;
+        left -= take;
+    } while (left > 0);
+}
+
+/* called locked. Returns TRUE if something was written */
+static gboolean _drain_ring (LogRing *r)
+{
+    gboolean wrote = FALSE;
+    guint tail = r->tail;
+    guint head = __atomic_load_n (&r->head, __ATOMIC_ACQUIRE);
+    for (; tail != head; tail++) {
+        fputs (r->lines[tail & (LOG_RING_LINES - 1)], log_file);
+        wrote = TRUE;
+    }
+    __atomic_store_n (&r->tail, tail, __ATOMIC_RELEASE);
+    return wrote;
+}
+
+/* called locked. Returns TRUE if something was written */
+static gboolean _drain (void)
+{
+    gboolean wrote = FALSE;
+    GSList *l = _rings;
+    while (l != NULL) {
+        GSList *next = l->next;
+        LogRing *r = (LogRing *)l->data;
+        gboolean dead = __atomic_load_n (&r->dead, __ATOMIC_ACQUIRE);
+        if (_drain_ring (r) == TRUE) wrote = TRUE;
+        if (dead == TRUE) { /* nothing can be added any more */
+            _rings = g_slist_delete_link (_rings, l);
+            g_free (r);
+        }
+        l = next;
+    }
+    if (wrote == TRUE) fflush (log_file);
+    return wrote;
+}
+
+static gpointer _drain_thread (gpointer data)
+{
+    gint64 wait_ms = LOG_DRAIN_MIN_MS;
+    (void)data;
+    g_mutex_lock (&_mutex);
+    while (_quit == FALSE) {
+        if (_drain () == TRUE) wait_ms = LOG_DRAIN_MIN_MS;
+        else wait_ms = MIN (wait_ms * 2, LOG_DRAIN_MAX_MS);
+        g_cond_wait_until (&_cond, &_mutex, g_get_monotonic_time () + wait_ms * G_TIME_SPAN_MILLISECOND);
+    }
+    (void)_drain ();
+    g_mutex_unlock (&_mutex);
+    return NULL;
+}
@@ -22,17 +22,23 @@
 
 #include <stdio.h>
 
-#define LOG(str, ...) \
-    (void)(log_file ? (fprintf(log_file ? log_file : stdout, "[INFO] %s: " str "\n", \
-        __func__, ##__VA_ARGS__), fflush(log_file)) : 0)
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_DEBUG 2
+
+/* Levels above this are compiled out, arguments are not evaluated either.
+ * For example CFLAGS=-DLOG_LEVEL_MAX=LOG_LEVEL_INFO */
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX LOG_LEVEL_DEBUG
+#endif
 
-#define LOG_ERROR(str, ...) \
-    (void)(log_file ? (fprintf(log_file ? log_file : stdout, "[ERROR] %s: " str "\n", \
-        __func__, ##__VA_ARGS__), fflush(log_file)) : 0)
+#define LOG_AT(level, str, ...) \
+    (void)(((level) <= LOG_LEVEL_MAX && log_file && ((level) < LOG_LEVEL_DEBUG || log_debugging_on)) ? \
+        (log_write ((level), __func__, str, ##__VA_ARGS__), 0) : 0)
 
-#define LOG_DEBUG(str, ...) \
-    (void)((log_debugging_on && log_file) ? (fprintf(log_file ? log_file : stdout, "[DEBUG] %s: " str "\n", \
-        __func__, ##__VA_ARGS__), fflush(log_file)) : 0)
+#define LOG(str, ...) LOG_AT (LOG_LEVEL_INFO, str, ##__VA_ARGS__)
+#define LOG_ERROR(str, ...) LOG_AT (LOG_LEVEL_ERROR, str, ##__VA_ARGS__)
+#define LOG_DEBUG(str, ...) LOG_AT (LOG_LEVEL_DEBUG, str, ##__VA_ARGS__)
 
 extern FILE *log_file;
 extern int log_debugging_on;
@@ -40,6 +46,14 @@ extern int log_debugging_on;
 /* File path can be null. */
 int log_init (const char *file_path);
 
+/* Writes everything still buffered */
 void log_destroy (void);
 
+/*
+ * Use macros above. Line gets time and thread id and goes to ring buffer
+ * of calling thread, background thread writes it to file. Lock-free
+ * after the first line of a thread.
+ */
+void log_write (int level, const char *func, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+
 #endif
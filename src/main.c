@@ -33,7 +33,6 @@
 #include "util.h"
 /* playlist */
 #include "playlist.h"
-#include "playlist-pls.h"
 #include "paths.h"
 #include "ncurses-screen.h"
 /* other */
@@ -43,6 +42,7 @@
 #include "keys.h"
 #include "player.h"
 #include "net.h"
+#include "stats.h"
 
 static GMainLoop *loop = NULL;
 static const char *help_str =
@@ -56,6 +56,9 @@ static const char *help_str =
     "-k:             Print key values for configuring keybindings.";
 
 static gboolean _add_idle (gpointer data);
+static gboolean _load_snapshot (guint8 *volume);
+static void _start_journal (void);
+static void _log_stats (void);
 
 static void quit (int signum)
 {
@@ -74,6 +77,7 @@ int main (int argc, char **argv)
     char log_file_path_str[PATH_MAX] = {0};
     int c;
     GSList *to_add = NULL;
+    guint8 volume = 100;
 
     /* parse command line options */
     while ((c = getopt(argc, argv, "hc:g:l:dk")) != -1) {
@@ -143,6 +147,7 @@ int main (int argc, char **argv)
     bindtextdomain (PACKAGE, LOCALEDIR);
     textdomain (PACKAGE);
 
+    stats_init ();
     playlist_init ();
 
     /* player might need preinit */
@@ -158,6 +163,8 @@ int main (int argc, char **argv)
 
     /* curl init for net downloads */
     curl_global_init (CURL_GLOBAL_DEFAULT);
+    /* not fatal. network features just fail without worker */
+    (void)net_init ();
 
     /* if user has not set config use default one */
     if (config_file_path == NULL) {
@@ -209,10 +216,18 @@ int main (int argc, char **argv)
         goto error;
     }
 
-    /* Add default playlist to end of list */
-    to_add = g_slist_append (to_add,  paths_saved_data_default_playlist ());
+    /* Restore last session, or add default playlist to end of list */
+    if (_load_snapshot (&volume) == TRUE) {
+        ncurses_screen_update_force ();
+    } else {
+        to_add = g_slist_append (to_add,  paths_saved_data_default_playlist ());
+    }
+
+    player_set_volume(volume);
 
-    player_set_volume(100);
+    if (config.playlist_save_at_exit == TRUE) {
+        _start_journal ();
+    }
 
     g_timeout_add (1, ncurses_event_idle, NULL); /* read keyboard and mouse */
 
@@ -221,11 +236,8 @@ int main (int argc, char **argv)
     }
     g_main_loop_run (loop);
     if (config.playlist_save_at_exit == TRUE) {
-        gchar *pl = paths_saved_data_default_playlist ();
-        if (pl != NULL) {
-            playlist_pls_save (playlist_get (), pl);
-            g_free (pl);
-        }
+        /* changes are already in journal */
+        playlist_stop_journal (player_volume ());
     }
 
 error:
@@ -247,6 +259,7 @@ error:
     command_destroy ();
     net_free ();
     curl_global_cleanup ();
+    _log_stats ();
     log_destroy();
     return retval;
 }
@@ -270,3 +283,53 @@ static gboolean _add_idle (gpointer data)
     ncurses_screen_update_force ();
     return FALSE;
 }
+
+/* snapshot and journal are used only if default playlist has not been written after them */
+static gboolean _load_snapshot (guint8 *volume)
+{
+    gboolean ret = FALSE;
+    struct stat ss, js, ps;
+    time_t newest = 0;
+    gchar *snapshot = paths_saved_data_playlist_snapshot ();
+    gchar *journal = paths_saved_data_playlist_journal ();
+    gchar *pl = paths_saved_data_default_playlist ();
+    if (snapshot == NULL || journal == NULL || pl == NULL) goto load_snapshot_error;
+
+    if (stat (snapshot, &ss) == 0) newest = ss.st_mtime;
+    if (stat (journal, &js) == 0 && js.st_mtime > newest) newest = js.st_mtime;
+    if (newest == 0) goto load_snapshot_error;
+    if (stat (pl, &ps) == 0 && ps.st_mtime > newest) {
+        LOG_DEBUG("Default playlist is newer than snapshot, snapshot not used.");
+        goto load_snapshot_error;
+    }
+    ret = playlist_load_snapshot (snapshot, journal, volume);
+load_snapshot_error:
+    g_free (snapshot);
+    g_free (journal);
+    g_free (pl);
+    return ret;
+}
+
+static void _start_journal (void)
+{
+    gchar *snapshot = paths_saved_data_playlist_snapshot ();
+    gchar *journal = paths_saved_data_playlist_journal ();
+    gchar *pl = paths_saved_data_default_playlist ();
+    if (snapshot != NULL && journal != NULL) {
+        if (playlist_start_journal (journal, snapshot, pl) == FALSE) {
+            LOG_ERROR("Failed to start playlist journal. Playlist changes are not saved.");
+        }
+    }
+    g_free (snapshot);
+    g_free (journal);
+    g_free (pl);
+}
+
+/* one line, so it is easy to grep from log */
+static void _log_stats (void)
+{
+    gchar *json = stats_to_json ();
+    if (json == NULL) return;
+    LOG ("stats %s", json);
+    g_free (json);
+}
@@ -35,6 +35,7 @@
 #include "ncurses-window-filebrowser.h"
 #include "ncurses-window-help.h"
 #include "ncurses-window-lyrics.h"
+#include "ncurses-window-diagnostics.h"
 #include "ncurses-window-command-prompt.h"
 #include "ncurses-window-user-info.h"
 #include "ncurses-window-error.h"
@@ -43,17 +44,21 @@
 
 #include "playlist.h"
 #include "playlist-pls.h"
+#include "playlist-m3u.h"
 #include "song.h"
 #include "player.h"
 #include "inspector.h"
+#include "prefetch.h"
 #include "command.h"
 #include "cmdline.h"
 #include "paths.h"
 #include "util.h"
 #include "config.h"
 #include "log.h"
+#include "stats.h"
 
 #define MAX_USERINFO_LEN 1024
+#define TAG_REDRAW_INTERVAL_MS 500
 
 static int _quit_callback (int argc, char **argv);
 static int _add_callback (int argc, char **argv);
@@ -69,6 +74,9 @@ static int _help_callback (int argc, char **argv);
 static int _print_working_directory_callback (int argc, char **argv);
 static int _seek_callback (int argc, char **argv);
 static int _volume_callback (int argc, char **argv);
+static int _stats_callback (int argc, char **argv);
+static int _unquarantine_callback (int argc, char **argv);
+static int _diagnostics_callback (int argc, char **argv);
 #include "commands.h"
 
 typedef enum {
@@ -77,7 +85,8 @@ typedef enum {
     NCURSES_SCREEN_MODE_SEARCH,
     NCURSES_SCREEN_MODE_FILEBROWSER,
     NCURSES_SCREEN_MODE_HELP,
-    NCURSES_SCREEN_MODE_LYRICS
+    NCURSES_SCREEN_MODE_LYRICS,
+    NCURSES_SCREEN_MODE_DIAGNOSTICS
 } NCursesScreenMode;
 
 static void _del_wins (void);
@@ -87,12 +96,19 @@ static gboolean _resize_screen_idle (gpointer data);
 static void _change_song_to_index (gint to_index, gboolean call_player_stop);
 static void _play (void);
 static void _stop (gboolean call_player_stop);
+static void _preroll_next (void);
+static void _prefetch_next (void);
+static void _tune_end (void);
+static void _screen_update_tags (void);
+static gboolean _tag_redraw_timeout (gpointer data);
+static gboolean _stream_error_action_is (const gchar *action);
 
 static void _event_mouse (MEVENT *m);
 static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_repeats,
     gboolean is_num_keybind_repeats_specified);
 
 static gboolean _screen_update_idle (gpointer data);
+static void _screen_update_request (void);
 static gboolean _next_song_idle (gpointer data);
 static gboolean _change_tune_idle (gpointer data);
 static gboolean _update_time_idle (gpointer data);
@@ -120,6 +136,9 @@ static gint _current_index; /* actual playing song index */
 static gint _playlist_len = 0;
 
 static NCursesScreenMode _mode;
+
+static guint _tag_redraw_id = 0;
+static gint64 _tag_redraw_last = 0;
 static NCursesScreenMode _mode_before_help = NCURSES_SCREEN_MODE_PLAYLIST;
 
 /* ncurses */
@@ -138,16 +157,29 @@ static gboolean _command_changed_userinfo;
 
 static gint _sid_tune_index = 0;
 
+static SCREEN *_term = NULL; /* when not in stdout */
+
 gboolean ncurses_screen_init (void)
+{
+    return ncurses_screen_init_term (NULL, NULL, NULL);
+}
+
+gboolean ncurses_screen_init_term (const char *type, FILE *out, FILE *in)
 {
     _mode = NCURSES_SCREEN_MODE_PLAYLIST;
     _current_index = -1;
 
     if (_init_callbacks () == FALSE) goto error;
     if (player_init (_player_status_update_func) == FALSE) goto error;
-    if (inspector_init (_inspector_status_update_func) == FALSE) goto error;
+    if (inspector_init (_inspector_status_update_func, ncurses_screen_update_force) == FALSE) goto error;
+    if (prefetch_init () == FALSE) goto error;
 
-    initscr ();
+    if (out == NULL) {
+        initscr ();
+    } else {
+        _term = newterm (type, out, in);
+        if (_term == NULL) goto error;
+    }
     set_escdelay (0);
     ncurses_colors_init ();
     raw ();
@@ -164,13 +196,14 @@ gboolean ncurses_screen_init (void)
     ncurses_window_playlist_init ();
     ncurses_window_filebrowser_init ();
     ncurses_window_help_init ();
-    ncurses_window_lyrics_init (_screen_update_idle);
+    ncurses_window_lyrics_init (ncurses_screen_update_force);
+    ncurses_window_diagnostics_init ();
     ncurses_window_user_info_init ();
     ncurses_window_error_init ();
 
     _last_ch = 0; /* debug */
     if (_resize_screen () == FALSE) goto error;
-    g_idle_add (_screen_update_idle, NULL);
+    _screen_update_request ();
 
     _cmdline = "";
     cmdline_init (command_commands());
@@ -196,6 +229,7 @@ static gboolean _resize_screen (void)
     ncurses_window_filebrowser_resize (_width-2*NCURSES_WINDOW_MARGIN, _height - 11, NCURSES_WINDOW_MARGIN, 8);
     ncurses_window_help_resize (_width-2*NCURSES_WINDOW_MARGIN, _height - 11, NCURSES_WINDOW_MARGIN, 8);
     ncurses_window_lyrics_resize (_width-2*NCURSES_WINDOW_MARGIN, _height - 11, NCURSES_WINDOW_MARGIN, 8);
+    ncurses_window_diagnostics_resize (_width-2*NCURSES_WINDOW_MARGIN, _height - 11, NCURSES_WINDOW_MARGIN, 8);
     ncurses_window_user_info_resize (_width-2*NCURSES_WINDOW_MARGIN, 1, NCURSES_WINDOW_MARGIN, _height - 2);
     ncurses_window_command_prompt_resize (_width, 1, 0, _height - 1);
     ncurses_window_error_resize (0, 1, 1, _height - 1);
@@ -208,6 +242,7 @@ resize_error:
 static gboolean _resize_screen_idle (gpointer data)
 {
     if (_resize_screen () == FALSE) (void)raise (SIGINT); /* quit if could not resize */
+    stats_inc (STATS_REDRAWS_REQUESTED);
     g_timeout_add(100, _screen_update_idle, NULL);
     return FALSE;
 }
@@ -222,6 +257,7 @@ static void _del_wins (void)
     ncurses_window_filebrowser_delete ();
     ncurses_window_help_delete ();
     ncurses_window_lyrics_delete ();
+    ncurses_window_diagnostics_delete ();
     ncurses_window_user_info_delete ();
     ncurses_window_command_prompt_delete ();
     ncurses_window_error_delete ();
@@ -229,11 +265,21 @@ static void _del_wins (void)
 
 void ncurses_screen_free (void)
 {
+    prefetch_free ();
     inspector_free ();
     player_free ();
+    if (_tag_redraw_id > 0) g_source_remove (_tag_redraw_id);
+    _tag_redraw_id = 0;
     _del_wins ();
     ncurses_window_filebrowser_free ();
+    ncurses_window_help_free ();
+    ncurses_window_lyrics_free ();
+    ncurses_window_diagnostics_free ();
     endwin ();
+    if (_term != NULL) {
+        delscreen (_term);
+        _term = NULL;
+    }
     cmdline_free ();
 }
 
@@ -297,7 +343,7 @@ void ncurses_screen_event (NCursesEvent *e)
         _cursor_pos = -1;
     }
 
-    g_idle_add (_screen_update_idle, NULL);
+    _screen_update_request ();
 }
 
 static void _event_mouse (MEVENT *m)
@@ -378,8 +424,10 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
                 playlist_mode_next ();
                 _current_index = playlist_get_song_index (_current_song);
             }
+            _preroll_next ();
         } else if (_check_key (&config.key_playlist_loop_toggle, keybind_name)) {
             playlist_loop_toggle ();
+            _preroll_next ();
         } else if (_check_key (&config.key_playlist_remove_songs, keybind_name)) {
             GSList *remove_list = g_slist_alloc ();
             for (gint i = selection_min_index; i < selection_max_index+1; i++) {
@@ -485,7 +533,7 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
         if (_check_key (&config.key_common_abort, keybind_name)) {
             _mode = NCURSES_SCREEN_MODE_PLAYLIST;
             ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
-            g_idle_add (_screen_update_idle, NULL);
+            _screen_update_request ();
         } else if (ch == 10) {
             _execute_cmdline ();
             if (!_command_changed_mode) {
@@ -501,7 +549,7 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
             playlist_search_free ();
             _mode = NCURSES_SCREEN_MODE_PLAYLIST;
             ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
-            g_idle_add (_screen_update_idle, NULL);
+            _screen_update_request ();
         } else if (ch == 10) { /* enter */
             if (_cmdline != NULL && strlen (_cmdline) > 0) {
                 g_snprintf (_tmp, ABSOLUTELY_MAX_LINE_LEN, "s %s", _cmdline);
@@ -559,7 +607,7 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
             } else if (_check_key (&config.key_common_abort, keybind_name) || _check_key (&config.key_quit, keybind_name)) {
                 _mode = NCURSES_SCREEN_MODE_PLAYLIST;
                 ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
-                g_idle_add (_screen_update_idle, NULL);
+                _screen_update_request ();
             } else if (_check_key (&config.key_command_mode, keybind_name)) {
                 cmdline_mode_set (CMDLINE_MODE_FILEBROWSER);
                 cmdline_clear ();
@@ -672,7 +720,7 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
             }
             _mode = next_mode;
             ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
-            g_idle_add (_screen_update_idle, NULL);
+            _screen_update_request ();
         } else if (_check_key (&config.key_move_up, keybind_name)) {
             ncurses_window_help_up ();
         } else if (_check_key (&config.key_move_down, keybind_name)) {
@@ -691,7 +739,7 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
             _check_key (&config.key_quit, keybind_name)) {
             _mode = NCURSES_SCREEN_MODE_PLAYLIST;
             ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
-            g_idle_add (_screen_update_idle, NULL);
+            _screen_update_request ();
         } else if (_check_key (&config.key_move_up, keybind_name)) {
             ncurses_window_lyrics_up ();
         } else if (_check_key (&config.key_move_down, keybind_name)) {
@@ -705,6 +753,25 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
         } else if (_check_key (&config.key_move_full_page_up, keybind_name)) {
             ncurses_window_lyrics_up_full_page ();
         }
+    } else if (_mode == NCURSES_SCREEN_MODE_DIAGNOSTICS) {
+        if (_check_key (&config.key_common_abort, keybind_name) ||
+            _check_key (&config.key_quit, keybind_name)) {
+            _mode = NCURSES_SCREEN_MODE_PLAYLIST;
+            ncurses_window_playlist_mode_set (NCURSES_WINDOW_PLAYLIST_MODE_NORMAL);
+            _screen_update_request ();
+        } else if (_check_key (&config.key_move_up, keybind_name)) {
+            ncurses_window_diagnostics_up ();
+        } else if (_check_key (&config.key_move_down, keybind_name)) {
+            ncurses_window_diagnostics_down ();
+        } else if (_check_key (&config.key_move_half_page_down, keybind_name)) {
+            ncurses_window_diagnostics_down_half_page ();
+        } else if (_check_key (&config.key_move_half_page_up, keybind_name)) {
+            ncurses_window_diagnostics_up_half_page ();
+        } else if (_check_key (&config.key_move_full_page_down, keybind_name)) {
+            ncurses_window_diagnostics_down_full_page ();
+        } else if (_check_key (&config.key_move_full_page_up, keybind_name)) {
+            ncurses_window_diagnostics_up_full_page ();
+        }
     }
 
     if (_mode == NCURSES_SCREEN_MODE_PLAYLIST) {
@@ -764,12 +831,20 @@ static void _event_ch (int ch, const char *keybind_name, uint32_t num_keybind_re
     _last_ch = ch;
 }
 
+static void _screen_update_request (void)
+{
+    stats_inc (STATS_REDRAWS_REQUESTED);
+    g_idle_add (_screen_update_idle, NULL);
+}
+
 static gboolean _screen_update_idle (gpointer data)
 {
+    gint64 start = g_get_monotonic_time ();
     ncurses_window_volume_and_mode_clear ();
     ncurses_window_filebrowser_clear();
     ncurses_window_help_clear();
     ncurses_window_lyrics_clear();
+    ncurses_window_diagnostics_clear ();
 
     if (_height < SCREEN_MIN_HEIGHT || _width < SCREEN_MIN_WIDTH) return FALSE;
 
@@ -783,12 +858,16 @@ static gboolean _screen_update_idle (gpointer data)
         ncurses_window_help_update ();
     } else if (_mode == NCURSES_SCREEN_MODE_LYRICS) {
         ncurses_window_lyrics_update ();
+    } else if (_mode == NCURSES_SCREEN_MODE_DIAGNOSTICS) {
+        ncurses_window_diagnostics_update ();
     } else {
         ncurses_window_playlist_update ();
     }
     _screen_update_userinfo ();
     _screen_update_cmd ();
     ncurses_window_error_update ();
+    stats_inc (STATS_REDRAWS);
+    stats_record (STATS_FRAME_TIME, g_get_monotonic_time () - start);
     return FALSE; /* call only once */
 }
 
@@ -797,18 +876,6 @@ static inline void _screen_update_time (void)
     gint64 ms = player_get_current_time ();
     Song *o = _current_song;
     ncurses_window_time_update (o, _sid_tune_index, ms);
-
-    /* logic to change sid tune */
-    if (o != NULL && o->type == SONG_TYPE_SID) {
-        if (ms > o->tune_duration[_sid_tune_index]) {
-            _sid_tune_index++;
-            if (_sid_tune_index > o->tunes-1) {
-                g_idle_add (_next_song_idle, NULL);
-            } else {
-                g_idle_add (_change_tune_idle, NULL);
-            }
-        }
-    }
     _screen_update_cmd ();
 }
 
@@ -817,21 +884,31 @@ void _player_status_update_func (PlayerMessage m, gpointer data)
     switch (m) {
         case PLAYER_MESSAGE_ERROR: {
             ncurses_window_error_set ((gchar *)data);
+            if (_stream_error_action_is ("next") == TRUE) g_idle_add (_next_song_idle, NULL);
             break;
         }
         case PLAYER_MESSAGE_EOS: {
+            if (_stream_error_action_is ("pause") == TRUE) break; /* stays stopped on the stream */
             g_idle_add (_next_song_idle, NULL);
             break;
         }
+        case PLAYER_MESSAGE_BUFFERING: {
+            _screen_update_request ();
+            break;
+        }
+        case PLAYER_MESSAGE_TUNE_END: {
+            _tune_end ();
+            break;
+        }
         case PLAYER_MESSAGE_ABOUT_TO_FINISH: {
             static gboolean call_player_stop = FALSE;
             g_idle_add (_next_song_idle, &call_player_stop);
             break;
         }
         case PLAYER_MESSAGE_TAG: {
-            Song *s = (Song *)data; 
-            song_tags_copy (_current_song, s);
-            g_idle_add (_screen_update_idle, NULL);
+            Song *s = (Song *)data;
+            if (s != _current_song) song_tags_copy (_current_song, s); /* prerolled one */
+            _screen_update_tags ();
             break;
         }
         default:
@@ -849,8 +926,8 @@ static inline void _screen_update_userinfo ()
 {
     CmdlineMenuMode menumode = cmdline_menu_mode ();
     if (menumode == CMDLINE_MENU_MODE_LIST) {
-        GSList *options = cmdline_found_paths ();
-        if (options == NULL) options = cmdline_found_commands ();
+        GPtrArray *options = cmdline_found_paths ();
+        if (options == NULL || options->len == 0) options = cmdline_found_commands ();
         ncurses_window_user_info_set_cmdline_options (options);
         ncurses_window_user_info_set_cmline_options_index (cmdline_selected_index ());
     } else {
@@ -915,6 +992,7 @@ static void _play (void)
     } else {
         _update_time_id = 0;
     }
+    _preroll_next ();
 
     if (config.lyrics_service != 0) {
         if (_current_song != NULL) {
@@ -924,9 +1002,74 @@ static void _play (void)
     }
 }
 
+/* next skip only swaps pipelines if the player has this one ready */
+static void _preroll_next (void)
+{
+    Song *o = _current_song;
+    if (o == NULL) return;
+    if (o->type == SONG_TYPE_SID && _sid_tune_index + 1 < o->tunes) {
+        player_preroll (o, _sid_tune_index + 1);
+    } else {
+        player_preroll (playlist_peek_next_song (), 0);
+    }
+    _prefetch_next ();
+}
+
+/* upcoming files in the order they will be played */
+static void _prefetch_next (void)
+{
+    Song *next[PLAYLIST_PEEK_MAX];
+    gint n = CLAMP (config.prefetch_tracks, 0, PLAYLIST_PEEK_MAX);
+    if (n == 0) return;
+    n = playlist_peek_next_songs (next, n);
+    prefetch_songs (next, n);
+}
+
+/* player already tried reconnecting, if that was the action */
+static gboolean _stream_error_action_is (const gchar *action)
+{
+    if (_current_song == NULL || _current_song->type != SONG_TYPE_STREAM) return FALSE;
+    return g_strcmp0 (config.stream_error_action, action) == 0;
+}
+
+/* player cut the SID tune or module at its duration: next tune or song */
+static void _tune_end (void)
+{
+    Song *o = _current_song;
+    if (o == NULL) return;
+    if (o->type == SONG_TYPE_SID && _sid_tune_index + 1 < o->tunes) {
+        _sid_tune_index++;
+        g_idle_add (_change_tune_idle, NULL);
+    } else {
+        g_idle_add (_next_song_idle, NULL);
+    }
+}
+
+/* streams may change tags many times a second, one redraw per interval is enough */
+static void _screen_update_tags (void)
+{
+    gint64 wait;
+    if (_tag_redraw_id > 0) return;
+    wait = _tag_redraw_last + TAG_REDRAW_INTERVAL_MS * 1000 - g_get_monotonic_time ();
+    if (wait <= 0) {
+        (void)_tag_redraw_timeout (NULL);
+        return;
+    }
+    _tag_redraw_id = g_timeout_add ((guint)(wait / 1000) + 1, _tag_redraw_timeout, NULL);
+}
+
+static gboolean _tag_redraw_timeout (gpointer data)
+{
+    _tag_redraw_id = 0;
+    _tag_redraw_last = g_get_monotonic_time ();
+    _screen_update_request ();
+    return FALSE;
+}
+
 static gboolean _update_time_idle (gpointer data)
 {
     _screen_update_time ();
+    if (_mode == NCURSES_SCREEN_MODE_DIAGNOSTICS) _screen_update_request (); /* new numbers */
     return TRUE;
 }
 
@@ -944,16 +1087,25 @@ static gboolean _next_song_idle (gpointer data)
     if (next_index < len && next_index >= 0) {
         _change_song_to_index (next_index, call_player_stop);
     }
-    g_idle_add (_screen_update_idle, NULL);
+    _screen_update_request ();
     return FALSE;
 }
 
 static gboolean _change_tune_idle (gpointer data)
 { 
+    if (_current_song != NULL && player_is_prerolled (_current_song, _sid_tune_index) == FALSE) {
+        /* same song: try switching in the running decoder first */
+        _sid_tune_index = player_set_sid_tune (_sid_tune_index);
+        if (player_apply_sid_tune () == TRUE) {
+            _preroll_next ();
+            _screen_update_request ();
+            return FALSE;
+        }
+    }
     _stop (TRUE);
     _sid_tune_index = player_set_sid_tune (_sid_tune_index);
     _play ();
-    g_idle_add (_screen_update_idle, NULL);
+    _screen_update_request ();
 
     return FALSE;
 }
@@ -962,7 +1114,7 @@ static gboolean _change_tune_idle (gpointer data)
 
 void ncurses_screen_update_force (void)
 {
-    g_idle_add (_screen_update_idle, NULL);
+    _screen_update_request ();
 }
 
 void ncurses_screen_set_user_info(const gchar *userinfo)
@@ -1111,6 +1263,15 @@ static gboolean _init_callbacks (void)
    if (command_register(&volume_command)) {
        return FALSE;
    }
+   if (command_register(&stats_command)) {
+       return FALSE;
+   }
+   if (command_register(&unquarantine_command)) {
+       return FALSE;
+   }
+   if (command_register(&diagnostics_command)) {
+       return FALSE;
+   }
    return TRUE;
 }
 
@@ -1221,7 +1382,11 @@ static int _write_playlist_callback (int argc, char **argv)
             ncurses_window_error_set (_("Error: Write playlist. Invalid arguments."));
             return -1;
         }
-        success = playlist_pls_save (playlist_get (), argv[1]);
+        if (g_str_has_suffix (argv[1], ".m3u") || g_str_has_suffix (argv[1], ".m3u8")) {
+            success = playlist_m3u_save (playlist_get (), argv[1]);
+        } else {
+            success = playlist_pls_save (playlist_get (), argv[1]);
+        }
         playlistfile = argv[1];
         memcpy(saved_playlist, argv[1], strlen(argv[1])+1);
     }
@@ -1544,6 +1709,44 @@ static int _volume_callback (int argc, char **argv)
     return 0;
 }
 
+static int _stats_callback (int argc, char **argv)
+{
+    gchar *summary;
+    if (argc != 1) {
+        ncurses_window_error_set (_("Error: Stats. Wrong number of arguments."));
+        return -1;
+    }
+    summary = stats_summary ();
+    ncurses_screen_format_user_info ("%s", summary);
+    g_free (summary);
+    _command_changed_userinfo = TRUE;
+    return 0;
+}
+
+static int _unquarantine_callback (int argc, char **argv)
+{
+    guint n;
+    if (argc != 1) {
+        ncurses_window_error_set (_("Error: Unquarantine. Wrong number of arguments."));
+        return -1;
+    }
+    n = inspector_clear_quarantine ();
+    ncurses_screen_format_user_info (_("%u files will be probed again."), n);
+    _command_changed_userinfo = TRUE;
+    return 0;
+}
+
+static int _diagnostics_callback (int argc, char **argv)
+{
+    if (argc != 1) {
+        ncurses_window_error_set (_("Error: Diagnostics. Wrong number of arguments."));
+        return -1;
+    }
+    _mode = NCURSES_SCREEN_MODE_DIAGNOSTICS;
+    _command_changed_mode = TRUE;
+    return 0;
+}
+
 static void _execute_cmdline (void)
 {
     _command_changed_userinfo = FALSE;
@@ -20,10 +20,14 @@
 #ifndef _KK_NCURSES_SCREEN_H_
 #define _KK_NCURSES_SCREEN_H_
 
+#include <stdio.h>
 #include <glib.h>
 #include "ncurses-event.h"
 
 gboolean ncurses_screen_init (void);
+/* Draws to out instead of stdout, for example in benchmarks. type is
+ * terminal type, NULL uses TERM. */
+gboolean ncurses_screen_init_term (const char *type, FILE *out, FILE *in);
 void ncurses_screen_free (void);
 
 void ncurses_screen_event (NCursesEvent *e);
@@ -17,7 +17,7 @@
  * USA.
  */
 
-#include <ctype.h>
+#include <string.h>
 
 #include "ncurses-subwindow-textview.h"
 #include "ncurses-common.h"
@@ -25,25 +25,24 @@
 
 /* ncurses */
 static gchar _tmp[ABSOLUTELY_MAX_LINE_LEN];
-static gchar _tmp2[ABSOLUTELY_MAX_LINE_LEN];
 
-static gint _calculate_total_lines (NCursesSubwindowTextview *t);
-static gboolean _get_running_line (NCursesSubwindowTextview *t, gchar *text, gint *len);
-static void _find_new_position_to_line (NCursesSubwindowTextview *t, gint line);
-static gboolean _find_prev_running_line (NCursesSubwindowTextview *t);
-static gboolean _find_next_running_line (NCursesSubwindowTextview *t);
+static void _reflow (NCursesSubwindowTextview *t);
+static gint _char_columns (const gchar *c, const gchar *end, gint *bytes);
+static void _line_text (NCursesSubwindowTextview *t, const NCursesTextviewLine *l, gchar *out, gsize size);
 
 gboolean ncurses_subwindow_textview_init (NCursesSubwindowTextview *t)
 {
+    if (t->lines != NULL) g_array_free (t->lines, TRUE);
     memset (t, 0, sizeof (NCursesSubwindowTextview));
     return TRUE;
 }
 
 gboolean ncurses_subwindow_textview_resize (NCursesSubwindowTextview *t, gint width, gint height, gint x, gint y)
 {
+    gboolean reflow = (t->width != width || t->lines == NULL);
     t->width = width;
     t->height = height;
-    t->total_lines = _calculate_total_lines(t);
+    if (reflow == TRUE) _reflow (t);
     t->last_line = t->total_lines - t->height;
     if (t->last_line < 1) t->last_line = t->total_lines - 1;
     if (t->last_line < 1) t->last_line = 0;
@@ -67,11 +66,21 @@ void ncurses_subwindow_textview_delete (NCursesSubwindowTextview *t)
     if (t->free_text == TRUE) {
         g_free (t->text);
         t->text = NULL;
+        if (t->lines != NULL) g_array_set_size (t->lines, 0);
+        t->total_lines = 0;
     }
     if (t->win != NULL) delwin (t->win);
     t->win = NULL;
 }
 
+void ncurses_subwindow_textview_free (NCursesSubwindowTextview *t)
+{
+    ncurses_subwindow_textview_delete (t);
+    if (t->lines != NULL) g_array_free (t->lines, TRUE);
+    t->lines = NULL;
+    t->total_lines = 0;
+}
+
 void ncurses_subwindow_textview_clear (NCursesSubwindowTextview *t)
 {
     wclear (t->win);
@@ -79,27 +88,22 @@ void ncurses_subwindow_textview_clear (NCursesSubwindowTextview *t)
 
 void ncurses_subwindow_textview_update (NCursesSubwindowTextview *t)
 {
-    gint len = 0;
-    gint y = 0;
-    gint i = 0;
+    gint line;
 
     if (t->text == NULL) return;
     else if (t->total_lines < 1) return;
     else if (t->height == 0) return;
 
-    gint line = t->scroller.page_start_index;
+    line = t->scroller.page_start_index;
     if (line > t->last_line) line = t->last_line;
-    _find_new_position_to_line (t, line);
+    if (line < 0) line = 0;
     t->current_line = line;
 
-    for (; i < t->height; i++) {
-        if (_get_running_line (t, _tmp, &len) == FALSE) break;
-        g_snprintf (_tmp2, ABSOLUTELY_MAX_LINE_LEN, "%-*s", t->width, _tmp);
-        mvwprintw (t->win, y++, 0, "%s", _tmp2);
-    }
-    for (; i < t->height; i++) {
-        g_snprintf (_tmp2, ABSOLUTELY_MAX_LINE_LEN, "%-*s", t->width, " ");
-        mvwprintw (t->win, y++, 0, "%s", _tmp2);
+    for (gint y = 0; y < t->height; y++, line++) {
+        const NCursesTextviewLine *l = NULL;
+        if (line < t->total_lines) l = &g_array_index (t->lines, NCursesTextviewLine, line);
+        _line_text (t, l, _tmp, sizeof (_tmp));
+        mvwprintw (t->win, y, 0, "%s", _tmp);
     }
     wrefresh (t->win);
 }
@@ -110,8 +114,6 @@ void ncurses_subwindow_textview_setup (NCursesSubwindowTextview *t)
     else if (t->height == 0) return;
 
     ncurses_scroller_page_height (&t->scroller, t->height);
-    t->running = t->current;
-
 }
 
 void ncurses_subwindow_textview_down (NCursesSubwindowTextview *t)
@@ -144,109 +146,6 @@ void ncurses_subwindow_textview_up_full_page (NCursesSubwindowTextview *t)
     ncurses_scroller_scroll_up_full_page (&t->scroller);
 }
 
-gint _calculate_total_lines (NCursesSubwindowTextview *t)
-{
-    if (t->text == NULL) return 0;
-    else if (t->width < 1 || t->height < 1) return 0;
-    gint lines = 0;
-    gboolean not_end;
-    t->running = t->current = t->text;
-    do {
-        not_end = _find_next_running_line (t);
-        lines++;
-    } while (not_end == TRUE);
-    return lines;
-}
-
-gboolean _get_running_line (NCursesSubwindowTextview *t, char *text, gint *len)
-{
-    const gchar *c = t->running;
-    gint w = 0;
-    size_t s = strlen(t->text);
-    if (s < 1) return FALSE;
-    const gchar *end = &t->text[s];
-    if (c == end) return FALSE;
-    *len = 0;
-    for (; c != end && w < t->width; c++) {
-        if (*c == '\0') {
-            break;
-        }
-        if (*c == '\n') {
-            c++;
-            break;
-        }
-        text[w++] = (gchar)*c;
-    }
-    t->running = c;
-    *len = w;
-    text[w] = '\0';
-    return TRUE;
-}
-
-void _find_new_position_to_line (NCursesSubwindowTextview *t, gint line)
-{
-    t->running = t->current;
-    gint delta = line - t->current_line;
-    if (delta == 0) return;
-    else if (delta > 0) { // forward
-        for (gint i = 0; i < delta; i++) {
-            if (_find_next_running_line (t) == FALSE) {
-                break;
-            }
-        }
-    } else if (delta < 0) { // backwards
-        for (gint i = 0; i < -delta; i++) {
-            if (_find_prev_running_line (t) == FALSE) {
-                break;
-            }
-        }
-    }
-    t->current = t->running;
-}
-
-gboolean _find_next_running_line (NCursesSubwindowTextview *t)
-{
-    gboolean ret = TRUE;
-    const gchar *c = t->running;
-    gint w = 0;
-    size_t len = strlen(t->text);
-    if (len < 1) return FALSE;
-    const gchar *end = &t->text[len];
-    if (c == end) ret = FALSE;
-    for (; c != end && w < t->width; c++) {
-        w++;
-        if (*c == '\n') {
-            c++;
-            break;
-        }
-    }
-    if (c == end) ret = FALSE;
-    t->running = c;
-    return ret;
-}
-
-gboolean _find_prev_running_line (NCursesSubwindowTextview *t)
-{
-    gboolean ret = TRUE;
-    const gchar *c = t->running - 2;
-    gint w = 0;
-    const gchar *start = &t->text[0];
-    if (c <= start) {
-        t->running = start;
-        return FALSE;
-    }
-    for (; c != start && w < t->width; c--) {
-        w++;
-        if (*c == '\n') {
-            c++;
-            break;
-        }
-    }
-    if (c == start) ret = FALSE;
-    t->running = c;
-    return ret;
-}
-
 gboolean ncurses_subwindow_textview_text (NCursesSubwindowTextview *t, const gchar *text, gboolean alloc_text, gboolean free_text)
 {
     if (text == NULL) goto set_text_error;
@@ -266,8 +165,8 @@ gboolean ncurses_subwindow_textview_text (NCursesSubwindowTextview *t, const gch
     }
 
     ncurses_scroller_init (&t->scroller, 0, 0);
-    t->running = t->current = t->text;
-    t->total_lines = _calculate_total_lines(t);
+    _reflow (t);
+    t->current_line = 0;
     t->last_line = t->total_lines - t->height;
     if (t->last_line < 1) t->last_line = t->total_lines - 1;
     if (t->last_line < 1) t->last_line = 0;
@@ -279,3 +178,67 @@ set_text_error:
     return FALSE;
 }
 
+/* One pass over text: line feeds end lines, lines wider than the view wrap */
+static void _reflow (NCursesSubwindowTextview *t)
+{
+    NCursesTextviewLine l = { 0, 0, 0 };
+    const gchar *c, *end;
+
+    if (t->lines == NULL) t->lines = g_array_new (FALSE, FALSE, sizeof (NCursesTextviewLine));
+    g_array_set_size (t->lines, 0);
+    t->total_lines = 0;
+    if (t->text == NULL || t->width < 1) return;
+
+    c = t->text;
+    end = c + strlen (t->text);
+    while (c < end) {
+        gint bytes;
+        gint cols;
+        if (*c == '\n') {
+            g_array_append_val (t->lines, l);
+            c++;
+            l.start = (guint)(c - t->text);
+            l.len = l.columns = 0;
+            continue;
+        }
+        cols = _char_columns (c, end, &bytes);
+        if (l.columns + cols > (guint)t->width && l.len > 0) {
+            g_array_append_val (t->lines, l);
+            l.start = (guint)(c - t->text);
+            l.len = l.columns = 0;
+        }
+        l.len += bytes;
+        l.columns += cols;
+        c += bytes;
+    }
+    if (l.len > 0 || t->lines->len == 0) g_array_append_val (t->lines, l);
+    t->total_lines = (gint)t->lines->len;
+}
+
+/* broken UTF-8 is shown byte by byte */
+static gint _char_columns (const gchar *c, const gchar *end, gint *bytes)
+{
+    gunichar uc = g_utf8_get_char_validated (c, end - c);
+    if (uc == (gunichar)-1 || uc == (gunichar)-2) {
+        *bytes = 1;
+        return 1;
+    }
+    *bytes = (gint)(g_utf8_next_char (c) - c);
+    if (g_unichar_iszerowidth (uc) == TRUE) return 0;
+    if (g_unichar_iswide (uc) == TRUE) return 2;
+    return 1;
+}
+
+/* line padded with spaces to view width, empty line if l is NULL */
+static void _line_text (NCursesSubwindowTextview *t, const NCursesTextviewLine *l, gchar *out, gsize size)
+{
+    gsize n = 0;
+    gint pad = t->width;
+    if (l != NULL) {
+        n = MIN ((gsize)l->len, size - 1);
+        memcpy (out, t->text + l->start, n);
+        pad -= (gint)l->columns;
+    }
+    for (; pad > 0 && n < size - 1; pad--) out[n++] = ' ';
+    out[n] = '\0';
+}
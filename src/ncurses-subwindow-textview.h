@@ -26,7 +26,15 @@
 
 /*
  * Text can be static, allocated outside or Textview can allocate it if needed.
+ * Wrapped lines are indexed once per text and width, so drawing any page
+ * does not walk the text.
  */
+typedef struct {
+    guint start;          /* byte offset in text */
+    guint len;            /* bytes, line feed not included */
+    guint columns;        /* screen columns */
+} NCursesTextviewLine;
+
 typedef struct ncurses_subwindow_textview {
     gint width;
     gint height;
@@ -35,16 +43,17 @@ typedef struct ncurses_subwindow_textview {
 
     gchar *text;          /* text */
     gboolean free_text;   /* free text when needed */
-    gint total_lines;     /* total lines in help_str fitted to window width */
-    gint current_line;    /* current line in help_str fitted to window width */
-    gint last_line;       /* total lines - height. help_str fitted to window width */
-    const gchar *current; /* current position in help_str*/
-    const gchar *running; /* used as tmp to get actual position */
+    GArray *lines;        /* NCursesTextviewLine, text wrapped to width */
+    gint total_lines;     /* total lines in text fitted to window width */
+    gint current_line;    /* first line drawn */
+    gint last_line;       /* total lines - height */
 } NCursesSubwindowTextview;
 
 gboolean ncurses_subwindow_textview_init (NCursesSubwindowTextview *t);
 gboolean ncurses_subwindow_textview_resize (NCursesSubwindowTextview *t, gint width, gint height, gint x, gint y);
 void ncurses_subwindow_textview_delete (NCursesSubwindowTextview *t);
+/* delete and line index, when textview is not used any more */
+void ncurses_subwindow_textview_free (NCursesSubwindowTextview *t);
 void ncurses_subwindow_textview_clear (NCursesSubwindowTextview *t);
 void ncurses_subwindow_textview_update (NCursesSubwindowTextview *t);
 void ncurses_subwindow_textview_setup (NCursesSubwindowTextview *t);
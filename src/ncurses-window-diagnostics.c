@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <ncurses.h>
+#include <libintl.h>
+#define _(String) gettext (String)
+
+#include "ncurses-common.h"
+#include "ncurses-colors.h"
+#include "ncurses-window-diagnostics.h"
+#include "ncurses-subwindow-textview.h"
+
+#include "player.h"
+
+/* ncurses */
+static gint _width = 0;
+static gint _height = 0;
+
+static WINDOW *_win = NULL;
+
+static NCursesSubwindowTextview _textview;
+
+gboolean ncurses_window_diagnostics_init (void)
+{
+    ncurses_subwindow_textview_init (&_textview);
+    return TRUE;
+}
+
+gboolean ncurses_window_diagnostics_resize (gint width, gint height, gint x, gint y)
+{
+    _width = width;
+    _height = 2;
+
+    ncurses_subwindow_textview_resize (&_textview, width, height - 2, x, y + 2);
+    ncurses_subwindow_textview_setup (&_textview);
+
+    if (_win != NULL) ncurses_window_diagnostics_delete ();
+    _win = newwin (_height, _width, y, x);
+    if (_win == NULL) goto resize_error;
+
+    ncurses_colors_pair_set (_win, COLOR_PAIR_BLUE_BLACK);
+
+    return TRUE;
+resize_error:
+    return FALSE;
+}
+
+void ncurses_window_diagnostics_delete (void)
+{
+    ncurses_subwindow_textview_delete (&_textview);
+    if (_win != NULL) delwin (_win);
+    _win = NULL;
+}
+
+void ncurses_window_diagnostics_free (void)
+{
+    ncurses_window_diagnostics_delete ();
+    ncurses_subwindow_textview_free (&_textview);
+}
+
+void ncurses_window_diagnostics_clear (void)
+{
+    wclear (_win);
+    ncurses_subwindow_textview_clear (&_textview);
+}
+
+void ncurses_window_diagnostics_update (void)
+{
+    NCursesScroller scroller = _textview.scroller;
+    gchar *text = player_diagnostics ();
+    if (text == NULL) text = g_strdup (_("No numbers yet. Diagnostics are turned on with diagnostics in config."));
+    ncurses_subwindow_textview_text (&_textview, text, FALSE, TRUE);
+    /* new numbers every second, keep the scroll */
+    ncurses_scroller_page_max_index (&scroller, _textview.scroller.page_max_index);
+    _textview.scroller = scroller;
+    ncurses_subwindow_textview_setup (&_textview);
+
+    mvwprintw (_win, 0, 2, "%s", _("Diagnostics"));
+    ncurses_subwindow_textview_update (&_textview);
+    wrefresh (_win);
+}
+
+void ncurses_window_diagnostics_down (void)
+{
+    ncurses_subwindow_textview_down (&_textview);
+}
+
+void ncurses_window_diagnostics_up (void)
+{
+    ncurses_subwindow_textview_up (&_textview);
+}
+
+void ncurses_window_diagnostics_down_half_page (void)
+{
+    ncurses_subwindow_textview_down_half_page (&_textview);
+}
+
+void ncurses_window_diagnostics_up_half_page (void)
+{
+    ncurses_subwindow_textview_up_half_page (&_textview);
+}
+
+void ncurses_window_diagnostics_down_full_page (void)
+{
+    ncurses_subwindow_textview_down_full_page (&_textview);
+}
+
+void ncurses_window_diagnostics_up_full_page (void)
+{
+    ncurses_subwindow_textview_up_full_page (&_textview);
+}
@@ -68,6 +68,12 @@ void ncurses_window_help_delete (void)
     _win = NULL;
 }
 
+void ncurses_window_help_free (void)
+{
+    ncurses_window_help_delete ();
+    ncurses_subwindow_textview_free (&_textview);
+}
+
 void ncurses_window_help_clear (void)
 {
     wclear (_win);
@@ -27,6 +27,7 @@ gboolean ncurses_window_help_resize (gint width, gint height, gint x, gint y);
 void ncurses_window_help_delete (void);
 void ncurses_window_help_clear (void);
 void ncurses_window_help_update (void);
+void ncurses_window_help_free (void);
 
 void ncurses_window_help_up (void);
 void ncurses_window_help_down (void);
@@ -19,6 +19,8 @@
 
 #include <ncurses.h>
 #include <ctype.h>
+#include <libintl.h>
+#define _(String) gettext (String)
 
 #include "ncurses-common.h"
 #include "ncurses-colors.h"
@@ -35,6 +37,8 @@ static gint _height = 0;
 
 static WINDOW *_win = NULL;
 
+static void _stream_status_line (void);
+
 gboolean ncurses_window_info_init (void)
 {
     return TRUE;
@@ -99,7 +103,7 @@ void ncurses_window_info_update (gint sid_tune_index)
                 g_snprintf(_tmp, ABSOLUTELY_MAX_LINE_LEN, "%-*s", _width-2, current_song->title);
             }
             mvwprintw(_win, 1, 0, "%s", _tmp);
-            g_snprintf(_tmp, ABSOLUTELY_MAX_LINE_LEN, "%-*s", _width-2, "-");
+            _stream_status_line ();
             mvwprintw(_win, 2, 0, "%s", _tmp);
         } else {
             if (current_song->artist != NULL) g_snprintf (_tmp, ABSOLUTELY_MAX_LINE_LEN, "%-*s", _width-2, current_song->artist);
@@ -120,3 +124,17 @@ void ncurses_window_info_update (gint sid_tune_index)
     }
     wrefresh (_win);
 }
+
+static void _stream_status_line (void)
+{
+    gchar line[ABSOLUTELY_MAX_LINE_LEN];
+    PlayerStreamStatus st;
+    player_stream_status (&st);
+    if (st.reconnecting == TRUE) {
+        g_snprintf (line, ABSOLUTELY_MAX_LINE_LEN, _("Reconnecting (%u)..."), st.reconnects + 1);
+    } else {
+        g_snprintf (line, ABSOLUTELY_MAX_LINE_LEN, _("Buffer %d%%  underruns %u  reconnects %u"),
+            st.buffer_percent, st.underruns, st.reconnects);
+    }
+    g_snprintf (_tmp, ABSOLUTELY_MAX_LINE_LEN, "%-*s", _width-2, line);
+}
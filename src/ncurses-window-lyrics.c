@@ -44,9 +44,9 @@ static gchar _title[ABSOLUTELY_MAX_LINE_LEN] = "Lyrics";
 
 static NCursesSubwindowTextview _textview;
 
-GSourceFunc _update;
+static void (*_update) (void) = NULL;
 
-gboolean ncurses_window_lyrics_init (GSourceFunc update)
+gboolean ncurses_window_lyrics_init (void (*update) (void))
 {
     _update = update;
     ncurses_subwindow_textview_init (&_textview);
@@ -82,6 +82,12 @@ void ncurses_window_lyrics_delete (void)
     _win = NULL;
 }
 
+void ncurses_window_lyrics_free (void)
+{
+    ncurses_window_lyrics_delete ();
+    ncurses_subwindow_textview_free (&_textview);
+}
+
 void ncurses_window_lyrics_clear (void)
 {
     wclear (_win);
@@ -156,9 +162,7 @@ static gboolean _got_lyrics (gpointer data)
     ncurses_subwindow_textview_resize (&_textview, _width, _subheight, _x, _suby);
     ncurses_subwindow_textview_text (&_textview, lyrics, FALSE, TRUE);
 
-    g_idle_add (_update, NULL);
-
-    net_join_lyrics_thread ();
+    if (_update != NULL) _update ();
 
     return FALSE;
 }
@@ -23,11 +23,12 @@
 #include <glib.h>
 #include "net.h"
 
-gboolean ncurses_window_lyrics_init (GSourceFunc update);
+gboolean ncurses_window_lyrics_init (void (*update) (void));
 gboolean ncurses_window_lyrics_resize (gint width, gint height, gint x, gint y);
 void ncurses_window_lyrics_delete (void);
 void ncurses_window_lyrics_clear (void);
 void ncurses_window_lyrics_update (void);
+void ncurses_window_lyrics_free (void);
 
 void ncurses_window_lyrics_up (void);
 void ncurses_window_lyrics_down (void);
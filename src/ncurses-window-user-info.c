@@ -36,7 +36,7 @@ static gint _height = 0;
 static WINDOW *_win = NULL;
 
 /* cmdline stuff */
-static GSList *_cmdline_options = NULL; /* possible options */
+static GPtrArray *_cmdline_options = NULL; /* possible options */
 static gint _cmdline_options_index = -1; /* current index */
 static gint _cmdline_options_first_visible_index = 0; /* first visible option */
 static gint _cmdline_options_visible_count = 0; /* how many visible */
@@ -77,7 +77,7 @@ void ncurses_window_user_info_clear (void)
 void ncurses_window_user_info_update (const gchar *info)
 {
     if (_cmdline_options != NULL && _cmdline_options_visible_count > -1 && _cmdline_options_index > -1) {
-        gint len = g_slist_length (_cmdline_options) - 1;
+        gint len = (gint)_cmdline_options->len - 1;
         gint pos = 0;
         if (_cmdline_options_first_visible_index > 0) {
             ncurses_colors_pair_set(_win, COLOR_PAIR_BLACK_WHITE);
@@ -85,7 +85,7 @@ void ncurses_window_user_info_update (const gchar *info)
             pos += 2;
         }
         for (gint i = _cmdline_options_first_visible_index; i < (_cmdline_options_first_visible_index + _cmdline_options_visible_count); i++) {
-            CmdlineItem *item = (CmdlineItem *)g_slist_nth_data (_cmdline_options, i);
+            CmdlineItem *item = (CmdlineItem *)g_ptr_array_index (_cmdline_options, i);
             if (item->str == NULL) continue;
             gint len = g_utf8_strlen (item->str, -1);
             ncurses_colors_pair_set(_win, COLOR_PAIR_BLACK_WHITE);
@@ -111,7 +111,7 @@ void ncurses_window_user_info_update (const gchar *info)
     wrefresh (_win);
 }
 
-void ncurses_window_user_info_set_cmdline_options (GSList *options)
+void ncurses_window_user_info_set_cmdline_options (GPtrArray *options)
 {
     _cmdline_options = options;
 }
@@ -121,7 +121,7 @@ void ncurses_window_user_info_set_cmline_options_index (gint index)
     _cmdline_options_index = index;
     if (_cmdline_options_index > -1 && _cmdline_options != NULL){
         /* paging */
-        gint len = g_slist_length (_cmdline_options) - 1;
+        gint len = (gint)_cmdline_options->len - 1;
         _find_page (index, len);
         _calculate_visible_count_from_index (_cmdline_options_first_visible_index, len);
     } else { /* unset */
@@ -137,7 +137,7 @@ static void _find_page (gint index, gint len)
     _cmdline_options_first_visible_index = 0;
 
     for (gint pos = 0; pos < len; pos++) {
-        CmdlineItem *item = (CmdlineItem *)g_slist_nth_data (_cmdline_options, pos);
+        CmdlineItem *item = (CmdlineItem *)g_ptr_array_index (_cmdline_options, pos);
         strlen += g_utf8_strlen (item->str, -1);
         if (_width < strlen || pos == index) {
             if (_width < strlen && items_added_count > 0) {
@@ -164,7 +164,7 @@ static void _calculate_visible_count_from_index (gint index, gint len)
     for (_cmdline_options_visible_count = 0;
             _cmdline_options_visible_count + index < len;
             _cmdline_options_visible_count++) {
-        CmdlineItem *item = (CmdlineItem *)g_slist_nth_data (_cmdline_options, index + _cmdline_options_visible_count);
+        CmdlineItem *item = (CmdlineItem *)g_ptr_array_index (_cmdline_options, index + _cmdline_options_visible_count);
         strlen += g_utf8_strlen (item->str, -1);
         if (_cmdline_options_visible_count == 0 && _width < g_utf8_strlen (item->str, -1)) {
             _cmdline_options_visible_count = 1;
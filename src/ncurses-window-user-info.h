@@ -28,7 +28,7 @@ void ncurses_window_user_info_delete (void);
 void ncurses_window_user_info_clear (void);
 void ncurses_window_user_info_update (const gchar *info);
 
-void ncurses_window_user_info_set_cmdline_options (GSList *options);
+void ncurses_window_user_info_set_cmdline_options (GPtrArray *options);
 
 void ncurses_window_user_info_set_cmline_options_index (gint index);
 
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "negative-cache.h"
+#include "log.h"
+#include "paths.h"
+#include "util.h"
+
+#define MAX_ENTRIES 200000
+
+typedef struct {
+    gint64 size;
+    gint64 mtime;
+    guint flags;
+} NegativeCacheEntry;
+
+static gchar *_key (const gchar *path);
+static gboolean _stat (const gchar *path, gint64 *size, gint64 *mtime);
+
+static GHashTable *_entries = NULL; /* canonical path -> NegativeCacheEntry */
+static gboolean _changed = FALSE;
+static GMutex _mutex;
+
+void negative_cache_init (void)
+{
+    gchar *path;
+    gchar *str = NULL;
+
+    g_mutex_lock (&_mutex);
+    if (_entries != NULL) goto init_out;
+    _entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    if (_entries == NULL) goto init_out;
+    _changed = FALSE;
+
+    path = paths_saved_data_negative_cache ();
+    if (path == NULL) goto init_out;
+    if (g_file_test (path, G_FILE_TEST_EXISTS) && util_file_load_to_str (path, &str) == 0) {
+        /* flags<TAB>size<TAB>mtime<TAB>path */
+        gchar **lines = g_strsplit (str, "\n", -1);
+        for (gint i = 0; lines != NULL && lines[i] != NULL; i++) {
+            gchar **f = g_strsplit (lines[i], "\t", 4);
+            if (g_strv_length (f) == 4 && *f[3] != '\0') {
+                NegativeCacheEntry *e = g_new0 (NegativeCacheEntry, 1);
+                if (e != NULL) {
+                    e->flags = (guint)strtoul (f[0], NULL, 10);
+                    e->size = g_ascii_strtoll (f[1], NULL, 10);
+                    e->mtime = g_ascii_strtoll (f[2], NULL, 10);
+                    g_hash_table_replace (_entries, g_strdup (f[3]), e);
+                }
+            }
+            g_strfreev (f);
+        }
+        g_strfreev (lines);
+    }
+    g_free (str);
+    g_free (path);
+init_out:
+    g_mutex_unlock (&_mutex);
+}
+
+void negative_cache_free (void)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+    GString *s;
+    gchar *path;
+
+    g_mutex_lock (&_mutex);
+    if (_entries == NULL) goto free_out;
+    if (_changed == FALSE) goto free_destroy;
+
+    path = paths_saved_data_negative_cache ();
+    if (path == NULL) goto free_destroy;
+    s = g_string_new (NULL);
+    g_hash_table_iter_init (&iter, _entries);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        NegativeCacheEntry *e = (NegativeCacheEntry *)value;
+        g_string_append_printf (s, "%u\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%s\n",
+            e->flags, e->size, e->mtime, (const gchar *)key);
+    }
+    if (util_file_write_data (path, s->str, s->len) != 0) {
+        LOG_ERROR ("Could not save negative cache %s.", path);
+    }
+    g_string_free (s, TRUE);
+    g_free (path);
+free_destroy:
+    g_hash_table_destroy (_entries);
+    _entries = NULL;
+free_out:
+    g_mutex_unlock (&_mutex);
+}
+
+gboolean negative_cache_has (const gchar *path, NegativeCacheFlags flags)
+{
+    NegativeCacheEntry *e;
+    gboolean ret = FALSE;
+    gint64 size, mtime;
+    gchar *key;
+
+    if (_entries == NULL || path == NULL) return FALSE;
+    key = _key (path);
+    if (key == NULL) return FALSE;
+
+    g_mutex_lock (&_mutex);
+    e = (NegativeCacheEntry *)g_hash_table_lookup (_entries, key);
+    if (e != NULL && (e->flags & flags) == flags) {
+        if (_stat (key, &size, &mtime) == TRUE && size == e->size && mtime == e->mtime) {
+            ret = TRUE;
+        } else { /* file has changed, try it again */
+            g_hash_table_remove (_entries, key);
+            _changed = TRUE;
+        }
+    }
+    g_mutex_unlock (&_mutex);
+    g_free (key);
+    return ret;
+}
+
+void negative_cache_add (const gchar *path, NegativeCacheFlags flags)
+{
+    NegativeCacheEntry *e;
+    gint64 size, mtime;
+    gchar *key;
+
+    if (_entries == NULL || path == NULL) return;
+    key = _key (path);
+    if (key == NULL) return;
+    if (_stat (key, &size, &mtime) == FALSE) {
+        g_free (key);
+        return;
+    }
+
+    g_mutex_lock (&_mutex);
+    e = (NegativeCacheEntry *)g_hash_table_lookup (_entries, key);
+    if (e != NULL && e->size == size && e->mtime == mtime) {
+        e->flags |= flags;
+        g_free (key);
+    } else if (g_hash_table_size (_entries) < MAX_ENTRIES || e != NULL) {
+        e = g_new0 (NegativeCacheEntry, 1);
+        if (e != NULL) {
+            e->size = size;
+            e->mtime = mtime;
+            e->flags = flags;
+            g_hash_table_replace (_entries, key, e); /* takes key */
+        } else {
+            g_free (key);
+        }
+    } else {
+        g_free (key);
+    }
+    _changed = TRUE;
+    g_mutex_unlock (&_mutex);
+}
+
+guint negative_cache_clear (NegativeCacheFlags flags)
+{
+    GHashTableIter iter;
+    gpointer value;
+    guint n = 0;
+
+    if (_entries == NULL) return 0;
+    g_mutex_lock (&_mutex);
+    g_hash_table_iter_init (&iter, _entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        NegativeCacheEntry *e = (NegativeCacheEntry *)value;
+        if ((e->flags & flags) == 0) continue;
+        e->flags &= ~flags;
+        if (e->flags == 0) g_hash_table_iter_remove (&iter);
+        n++;
+    }
+    if (n > 0) _changed = TRUE;
+    g_mutex_unlock (&_mutex);
+    return n;
+}
+
+static gchar *_key (const gchar *path)
+{
+    gchar expanded[PATH_MAX] = "";
+    if (util_expand_tilde (path, expanded) == FALSE) return NULL;
+    return g_canonicalize_filename (expanded, NULL);
+}
+
+static gboolean _stat (const gchar *path, gint64 *size, gint64 *mtime)
+{
+    struct stat st;
+    if (stat (path, &st) != 0 || !S_ISREG (st.st_mode)) return FALSE;
+    *size = (gint64)st.st_size;
+    *mtime = (gint64)st.st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) + st.st_mtim.tv_nsec;
+    return TRUE;
+}
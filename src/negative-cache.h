@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_NEGATIVE_CACHE_H_
+#define _KK_NEGATIVE_CACHE_H_
+
+#include <glib.h>
+
+/*
+ * Persisted cache of local files which are known to be useless.
+ * Entry is valid as long as file size and mtime stay the same.
+ */
+
+typedef enum {
+    NEGATIVE_CACHE_NOT_PLAYABLE = 1 << 0,
+    NEGATIVE_CACHE_NOT_PLAYLIST = 1 << 1
+} NegativeCacheFlags;
+
+/* loads from saved data dir */
+void negative_cache_init (void);
+/* saves if changed */
+void negative_cache_free (void);
+
+/* TRUE if all flags are known for unchanged file */
+gboolean negative_cache_has (const gchar *path, NegativeCacheFlags flags);
+void negative_cache_add (const gchar *path, NegativeCacheFlags flags);
+/* forgets flags for all files. Returns count of files which had them */
+guint negative_cache_clear (NegativeCacheFlags flags);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "net-lyrics-cache.h"
+#include "config.h"
+#include "log.h"
+#include "paths.h"
+#include "util.h"
+
+#define LYRICS_SUFFIX ".txt"
+#define NOT_FOUND_SUFFIX ".none"
+
+static gchar *_normalize (const gchar *str);
+static gchar *_entry_path (NetLyricsService service, const gchar *artist, const gchar *title, const gchar *suffix);
+
+gboolean net_lyrics_cache_get (NetLyricsService service, const gchar *artist, const gchar *title, gchar **lyrics)
+{
+    gchar *path;
+    struct stat st;
+    gboolean found = FALSE;
+
+    *lyrics = NULL;
+
+    path = _entry_path (service, artist, title, LYRICS_SUFFIX);
+    if (path == NULL) return FALSE;
+    if (stat (path, &st) == 0 && st.st_size > 0) {
+        if (util_file_load_to_str (path, lyrics) == 0) found = TRUE;
+    }
+    g_free (path);
+    if (found == TRUE) return TRUE;
+
+    if (config.lyrics_not_found_ttl <= 0) return FALSE;
+    path = _entry_path (service, artist, title, NOT_FOUND_SUFFIX);
+    if (path == NULL) return FALSE;
+    if (stat (path, &st) == 0) {
+        if (time (NULL) - st.st_mtime < (time_t)config.lyrics_not_found_ttl * 3600) found = TRUE;
+        else unlink (path); /* expired */
+    }
+    g_free (path);
+    return found;
+}
+
+void net_lyrics_cache_put (NetLyricsService service, const gchar *artist, const gchar *title, const gchar *lyrics)
+{
+    gchar *path;
+    if (lyrics == NULL && config.lyrics_not_found_ttl <= 0) return;
+
+    path = _entry_path (service, artist, title, lyrics != NULL ? LYRICS_SUFFIX : NOT_FOUND_SUFFIX);
+    if (path == NULL) return;
+    if (util_file_write_data (path, lyrics != NULL ? lyrics : "", lyrics != NULL ? strlen (lyrics) : 0) != 0) {
+        LOG_ERROR ("Could not write lyrics cache file %s.", path);
+    }
+    g_free (path);
+
+    if (lyrics != NULL) {
+        /* found now, old "not found" is not valid anymore */
+        path = _entry_path (service, artist, title, NOT_FOUND_SUFFIX);
+        if (path != NULL) unlink (path);
+        g_free (path);
+    }
+}
+
+/* same song with different case, accents or spacing has same key */
+static gchar *_normalize (const gchar *str)
+{
+    gchar *norm;
+    gchar *folded;
+    GString *s;
+
+    norm = g_utf8_normalize (str, -1, G_NORMALIZE_ALL);
+    if (norm == NULL) return NULL;
+    folded = g_utf8_casefold (norm, -1);
+    g_free (norm);
+    if (folded == NULL) return NULL;
+
+    s = g_string_new (NULL);
+    for (gchar *p = g_strstrip (folded); *p != '\0'; p++) {
+        if (g_ascii_isspace (*p)) {
+            if (s->len > 0 && s->str[s->len-1] == ' ') continue;
+            g_string_append_c (s, ' ');
+        } else {
+            g_string_append_c (s, *p);
+        }
+    }
+    g_free (folded);
+    return g_string_free (s, FALSE);
+}
+
+static gchar *_entry_path (NetLyricsService service, const gchar *artist, const gchar *title, const gchar *suffix)
+{
+    gchar *a = NULL;
+    gchar *t = NULL;
+    gchar *key = NULL;
+    gchar *hash = NULL;
+    gchar *dir = NULL;
+    gchar *path = NULL;
+
+    if (artist == NULL || title == NULL) return NULL;
+    a = _normalize (artist);
+    if (a == NULL) goto entry_path_error;
+    t = _normalize (title);
+    if (t == NULL) goto entry_path_error;
+    key = g_strdup_printf ("%d\n%s\n%s", (gint)service, a, t);
+    if (key == NULL) goto entry_path_error;
+    hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+    if (hash == NULL) goto entry_path_error;
+    dir = paths_saved_data_lyrics_dir ();
+    if (dir == NULL) goto entry_path_error;
+    path = g_strdup_printf ("%s%c%s%s", dir, G_DIR_SEPARATOR, hash, suffix);
+
+entry_path_error:
+    g_free (a);
+    g_free (t);
+    g_free (key);
+    g_free (hash);
+    g_free (dir);
+    return path;
+}
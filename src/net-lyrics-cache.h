@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_NET_LYRICS_CACHE_H_
+#define _KK_NET_LYRICS_CACHE_H_
+
+#include <glib.h>
+
+#include "net.h"
+
+/*
+ * Persistent lyrics cache in saved data dir. Key is service and
+ * normalized artist and title.
+ * Returns TRUE if found from cache. lyrics is set NULL if cached result
+ * is "not found", otherwise caller owns it.
+ */
+gboolean net_lyrics_cache_get (NetLyricsService service, const gchar *artist, const gchar *title, gchar **lyrics);
+
+/* lyrics NULL stores "not found" result, which expires after lyrics_not_found_ttl. */
+void net_lyrics_cache_put (NetLyricsService service, const gchar *artist, const gchar *title, const gchar *lyrics);
+
+#endif
@@ -17,102 +17,108 @@
  * USA.
  */
 
-#include <curl/curl.h>
+#include <string.h>
 
 #include "net-lyrics.h"
-#include "net-common.h"
+#include "net-lyrics-cache.h"
+#include "net-worker.h"
+#include "config.h"
 #include "util.h"
 
-gchar *_get_chartlyrics (const gchar *url, const gchar *a, const gchar *t, gboolean use_and);
+static guint _request (NetLyricsData *data);
+static void _chartlyrics_done (gchar *result, NetWorkerError error, gpointer user_data);
+static gboolean _has_lyric (const gchar *result);
+static gchar *_parse_lyrics (gchar *result);
 
-gchar *_get_chartlyrics (const gchar *url, const gchar *a, const gchar *t, gboolean use_and)
+gboolean net_lyrics_chartlyrics_fetch (NetLyricsData *data)
+{
+    if (data == NULL) return FALSE;
+    data->error = 0;
+    data->use_and = TRUE; /* and-search first */
+    data->request_id = _request (data);
+    return data->request_id != 0;
+}
+
+static guint _request (NetLyricsData *data)
 {
     GString *artist = NULL;
     GString *title = NULL;
-    NetCommonDownload dl = {0,};
-    gchar *aurl = NULL;
-    char *enca = NULL;
-    char *enct = NULL;
-    CURLcode res;
-    CURL *curl = curl_easy_init();
-    if (curl == NULL) return NULL;
-
-    enca = curl_easy_escape(curl, a, strlen (a));
-    if (enca == NULL) goto _get_chartlyrics_error;
-    enct = curl_easy_escape(curl, t, strlen (t));
-    if (enct == NULL) goto _get_chartlyrics_error;
+    gchar *enca = NULL;
+    gchar *enct = NULL;
+    gchar *url = NULL;
+    guint id = 0;
+
+    enca = g_uri_escape_string (data->artist, NULL, FALSE);
+    if (enca == NULL) goto _request_error;
+    enct = g_uri_escape_string (data->title, NULL, FALSE);
+    if (enct == NULL) goto _request_error;
 
     artist = g_string_new (enca);
-    if (artist == NULL) goto _get_chartlyrics_error;
+    if (artist == NULL) goto _request_error;
     title = g_string_new (enct);
-    if (title == NULL) goto _get_chartlyrics_error;
+    if (title == NULL) goto _request_error;
 
     /* This does not work with every search. ...and some search does not work with this. */
-    if (TRUE == use_and) {
+    if (TRUE == data->use_and) {
         util_g_string_replace (artist, "%20", "&&", 0);
         util_g_string_replace (title, "%20", "&&", 0);
     }
-    aurl = g_strdup_printf (url, artist->str, title->str);
-    if (aurl == NULL) goto _get_chartlyrics_error;
+    url = g_strdup_printf ("%s?artist=%s&song=%s", config.lyrics_chartlyrics_url, artist->str, title->str);
+    if (url == NULL) goto _request_error;
 
-    curl_easy_setopt (curl, CURLOPT_URL, aurl);
-    curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, net_common_curl_write_data);
-    curl_easy_setopt (curl, CURLOPT_WRITEDATA, &dl);
-    res = curl_easy_perform (curl);
+    id = net_worker_get (url, _chartlyrics_done, data);
 
-_get_chartlyrics_error:
+_request_error:
     if (artist != NULL) g_string_free (artist, TRUE);
     if (title != NULL) g_string_free (title, TRUE);
-    if (enca != NULL) {
-        curl_free (enca);
-    }
-    if (enct != NULL) {
-        curl_free (enct);
-    }
-    g_free (aurl);
-    curl_easy_cleanup (curl);
-
-    dl.data = g_realloc (dl.data, dl.size + 1);
-    dl.data[dl.size] = '\0';
-
-    (void)res;
-    return dl.data;
+    g_free (enca);
+    g_free (enct);
+    g_free (url);
+    return id;
 }
 
-gpointer net_lyrics_chartlyrics_thread (gpointer user_data)
+static void _chartlyrics_done (gchar *result, NetWorkerError error, gpointer user_data)
 {
-    gchar *result = NULL;
+    NetLyricsData *data = (NetLyricsData *)user_data;
     gchar *lyrics = NULL;
-    gboolean found = FALSE;
-    if (user_data == NULL) return user_data;
-    NetLyricsThreadData *data = (NetLyricsThreadData *)user_data;
-    data->error = 0;
+    data->request_id = 0;
 
-    /* and-search */
-    result = _get_chartlyrics ("http://api.chartlyrics.com/apiv1.asmx/SearchLyricDirect?artist=%s&song=%s", data->artist, data->title, TRUE);
-    if (result != NULL && *result != '\0' ) {
-        /* if and-search does not work result is some weird string */
-        gchar *str = result;
-        do {
-            if (!strncmp(str, "<Lyric>", 7)) {
-                found = TRUE;
-                break;
-            }
-        } while (*str != '\0' && ((str = g_utf8_find_next_char (str, NULL)) != NULL));
-    } else if (result == NULL || *result == '\0' ) {
-        found = FALSE;
-    }
-
-    if (found == FALSE) {
+    /* if and-search does not work result is some weird string */
+    if (data->use_and == TRUE && _has_lyric (result) == FALSE) {
         g_free (result);
+        result = NULL;
         /* or-search */
-        result = _get_chartlyrics ("http://api.chartlyrics.com/apiv1.asmx/SearchLyricDirect?artist=%s&song=%s", data->artist, data->title, FALSE);
+        data->use_and = FALSE;
+        data->request_id = _request (data);
+        if (data->request_id != 0) return;
     }
     if (result == NULL || *result == '\0' ) {
         data->error = 1;
-        goto _thread_chartlyrics_error;
+    } else {
+        lyrics = _parse_lyrics (result);
     }
 
+    /* network errors are not cached, only real answers */
+    if (error == NET_WORKER_ERROR_NONE) {
+        net_lyrics_cache_put (NET_LYRICS_SERVICE_CHARTLYRICS, data->artist, data->title, lyrics);
+    }
+
+    /* already in main loop. request of next song has cancelled this if needed */
+    data->cb ((gpointer)(lyrics != NULL ? g_strdup (lyrics) : NULL));
+    g_free (result);
+}
+
+static gboolean _has_lyric (const gchar *result)
+{
+    if (result == NULL || *result == '\0') return FALSE;
+    return strstr (result, "<Lyric>") != NULL;
+}
+
+/* modifies result, returns pointer inside it */
+static gchar *_parse_lyrics (gchar *result)
+{
+    gchar *lyrics = NULL;
+    gboolean found = FALSE;
     gchar *str = result;
     do {
         if (*str == '\r') {
@@ -126,21 +132,9 @@ gpointer net_lyrics_chartlyrics_thread (gpointer user_data)
             break;
         }
     } while (*str != '\0' && ((str = g_utf8_find_next_char (str, NULL)) != NULL));
-    if (found == FALSE) lyrics = NULL;
-
-    if (lyrics != NULL && *lyrics != '\0') {
-        for (size_t i = strlen (lyrics) - 1; i >= 0; i--) {
-            if (lyrics[i] == ' ' || lyrics[i] == '\n') {
-                lyrics[i] = '\0';
-            } else {
-                break;
-            }
-        }
-    }
+    if (found == FALSE) return NULL;
 
-_thread_chartlyrics_error:
-    if (lyrics != NULL) g_idle_add (data->cb, (gpointer)g_strdup(lyrics));
-    else g_idle_add (data->cb, (gpointer)NULL);
-    g_free (result);
-    return user_data;
+    if (lyrics != NULL) g_strchomp (lyrics);
+    if (lyrics != NULL && *lyrics == '\0') lyrics = NULL;
+    return lyrics;
 }
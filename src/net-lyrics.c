@@ -19,7 +19,7 @@
 
 #include "net-lyrics.h"
 
-void net_lyrics_free_data (NetLyricsThreadData *data)
+void net_lyrics_free_data (NetLyricsData *data)
 {
     if (data != NULL) {
         g_free (data->artist);
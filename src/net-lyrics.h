@@ -27,9 +27,13 @@ typedef struct {
     gchar *artist;
     gchar *title;
     gint error;
-} NetLyricsThreadData;
+    guint request_id; /* net worker request in progress, 0 if none */
+    gboolean use_and;
+} NetLyricsData;
 
-void net_lyrics_free_data (NetLyricsThreadData *data);
-gpointer net_lyrics_chartlyrics_thread (gpointer user_data);
+void net_lyrics_free_data (NetLyricsData *data);
+
+/* Starts search. data->cb is called from main loop with result. */
+gboolean net_lyrics_chartlyrics_fetch (NetLyricsData *data);
 
 #endif
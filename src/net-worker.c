@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <curl/curl.h>
+
+#include "net-worker.h"
+#include "net-common.h"
+#include "config.h"
+#include "log.h"
+#include "stats.h"
+
+#define NET_WORKER_MAX_CONNECTS 8
+#define NET_WORKER_MAX_HOST_CONNECTS 2
+#define NET_WORKER_POLL_MS 1000
+#define NET_WORKER_CONNECT_TIMEOUT_MS 5000
+#define NET_WORKER_DEFAULT_TIMEOUT_S 15
+
+typedef enum {
+    REQUEST_STATE_QUEUED = 0,
+    REQUEST_STATE_RUNNING,
+    REQUEST_STATE_DONE
+} RequestState;
+
+typedef struct {
+    guint id;
+    gchar *url;
+    glong timeout_ms;
+    RequestState state;
+    gint64 start; /* monotonic, when transfer started */
+    gboolean cancelled;
+    gboolean sync;
+    guint idle_id;
+    CURL *easy;
+    NetCommonDownload dl;
+    NetWorkerError error;
+    NetWorkerDoneFunc done;
+    gpointer user_data;
+} NetWorkerRequest;
+
+static NetWorkerRequest *_request_new (const gchar *url);
+static void _request_free (NetWorkerRequest *req);
+static gboolean _queue_request (NetWorkerRequest *req);
+static gpointer _worker_thread (gpointer user_data);
+static void _start_queued (void);
+static void _remove_cancelled (void);
+static void _read_finished (void);
+static void _finish (NetWorkerRequest *req);
+static void _stop_all (void);
+static gboolean _deliver_idle (gpointer user_data);
+
+static GThread *_thread = NULL;
+static GMutex _mutex;
+static GCond _cond; /* signaled when sync request is done */
+static CURLM *_multi = NULL; /* used only by worker thread after init */
+static GQueue _queue = G_QUEUE_INIT; /* new requests. locked */
+static GList *_running = NULL; /* worker thread only */
+static GHashTable *_requests = NULL; /* id -> async request until delivered. locked */
+static guint _next_id = 1;
+static gboolean _quit = FALSE;
+
+gboolean net_worker_init (void)
+{
+    if (_thread != NULL) return TRUE;
+
+    _multi = curl_multi_init ();
+    if (_multi == NULL) goto init_error;
+    curl_multi_setopt (_multi, CURLMOPT_MAXCONNECTS, (long)NET_WORKER_MAX_CONNECTS);
+    curl_multi_setopt (_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)NET_WORKER_MAX_HOST_CONNECTS);
+
+    _requests = g_hash_table_new (g_direct_hash, g_direct_equal);
+    if (_requests == NULL) goto init_error;
+
+    _quit = FALSE;
+    _thread = g_thread_new ("NetWorkerThread", _worker_thread, NULL);
+    if (_thread == NULL) goto init_error;
+    return TRUE;
+init_error:
+    LOG_ERROR ("Could not start network worker.");
+    if (_requests != NULL) g_hash_table_destroy (_requests);
+    _requests = NULL;
+    if (_multi != NULL) curl_multi_cleanup (_multi);
+    _multi = NULL;
+    return FALSE;
+}
+
+void net_worker_free (void)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    if (_thread == NULL) return;
+
+    g_mutex_lock (&_mutex);
+    _quit = TRUE;
+    g_mutex_unlock (&_mutex);
+    curl_multi_wakeup (_multi);
+    g_thread_join (_thread);
+    _thread = NULL;
+
+    /* worker has stopped, so only not yet delivered requests are left */
+    g_hash_table_iter_init (&iter, _requests);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        NetWorkerRequest *req = (NetWorkerRequest *)value;
+        if (req->idle_id != 0) g_source_remove (req->idle_id);
+        _request_free (req);
+    }
+    g_hash_table_destroy (_requests);
+    _requests = NULL;
+    g_queue_clear (&_queue);
+
+    curl_multi_cleanup (_multi);
+    _multi = NULL;
+}
+
+guint net_worker_get (const gchar *url, NetWorkerDoneFunc done, gpointer user_data)
+{
+    guint id;
+    NetWorkerRequest *req;
+    if (url == NULL || done == NULL) return 0;
+
+    req = _request_new (url);
+    if (req == NULL) return 0;
+    req->done = done;
+    req->user_data = user_data;
+
+    g_mutex_lock (&_mutex);
+    id = req->id = _next_id++;
+    if (_next_id == 0) _next_id = 1;
+    g_mutex_unlock (&_mutex);
+
+    if (_queue_request (req) == FALSE) {
+        _request_free (req);
+        return 0;
+    }
+    return id;
+}
+
+void net_worker_cancel (guint id)
+{
+    NetWorkerRequest *req;
+    if (id == 0 || _requests == NULL) return;
+
+    g_mutex_lock (&_mutex);
+    req = (NetWorkerRequest *)g_hash_table_lookup (_requests, GUINT_TO_POINTER (id));
+    if (req != NULL) {
+        req->cancelled = TRUE;
+        if (req->state == REQUEST_STATE_QUEUED) {
+            g_queue_remove (&_queue, req);
+            g_hash_table_remove (_requests, GUINT_TO_POINTER (id));
+            _request_free (req);
+        }
+        /* running is removed by worker and done one by _deliver_idle */
+    }
+    g_mutex_unlock (&_mutex);
+    curl_multi_wakeup (_multi);
+}
+
+gchar *net_worker_get_sync (const gchar *url)
+{
+    gchar *data = NULL;
+    NetWorkerRequest *req;
+    if (url == NULL) return NULL;
+
+    req = _request_new (url);
+    if (req == NULL) return NULL;
+    req->sync = TRUE;
+
+    if (_queue_request (req) == FALSE) {
+        _request_free (req);
+        return NULL;
+    }
+
+    g_mutex_lock (&_mutex);
+    while (req->state != REQUEST_STATE_DONE) g_cond_wait (&_cond, &_mutex);
+    g_mutex_unlock (&_mutex);
+
+    if (req->error == NET_WORKER_ERROR_NONE) {
+        data = req->dl.data;
+        req->dl.data = NULL;
+    }
+    _request_free (req);
+    return data;
+}
+
+static NetWorkerRequest *_request_new (const gchar *url)
+{
+    NetWorkerRequest *req = g_new0 (NetWorkerRequest, 1);
+    if (req == NULL) return NULL;
+    req->url = g_strdup (url);
+    if (req->url == NULL) {
+        g_free (req);
+        return NULL;
+    }
+    /* config is only read in main thread */
+    req->timeout_ms = (config.network_timeout > 0 ? config.network_timeout : NET_WORKER_DEFAULT_TIMEOUT_S) * 1000L;
+    return req;
+}
+
+static void _request_free (NetWorkerRequest *req)
+{
+    if (req == NULL) return;
+    if (req->easy != NULL) curl_easy_cleanup (req->easy);
+    g_free (req->dl.data);
+    g_free (req->url);
+    g_free (req);
+}
+
+static gboolean _queue_request (NetWorkerRequest *req)
+{
+    g_mutex_lock (&_mutex);
+    if (_thread == NULL || _quit == TRUE) {
+        g_mutex_unlock (&_mutex);
+        return FALSE;
+    }
+    if (req->sync == FALSE) g_hash_table_insert (_requests, GUINT_TO_POINTER (req->id), req);
+    g_queue_push_tail (&_queue, req);
+    g_mutex_unlock (&_mutex);
+    curl_multi_wakeup (_multi);
+    return TRUE;
+}
+
+static gpointer _worker_thread (gpointer user_data)
+{
+    (void)user_data;
+    for (;;) {
+        int running = 0;
+
+        g_mutex_lock (&_mutex);
+        if (_quit == TRUE) {
+            g_mutex_unlock (&_mutex);
+            break;
+        }
+        _start_queued ();
+        _remove_cancelled ();
+        g_mutex_unlock (&_mutex);
+
+        curl_multi_perform (_multi, &running);
+        _read_finished ();
+        /* sleeps until socket activity, timeout or curl_multi_wakeup */
+        curl_multi_poll (_multi, NULL, 0, NET_WORKER_POLL_MS, NULL);
+    }
+
+    g_mutex_lock (&_mutex);
+    _stop_all ();
+    g_mutex_unlock (&_mutex);
+    return NULL;
+}
+
+/* called locked */
+static void _start_queued (void)
+{
+    NetWorkerRequest *req;
+    while ((req = (NetWorkerRequest *)g_queue_pop_head (&_queue)) != NULL) {
+        req->easy = curl_easy_init ();
+        if (req->easy == NULL) {
+            req->error = NET_WORKER_ERROR_TRANSFER;
+            _finish (req);
+            continue;
+        }
+        curl_easy_setopt (req->easy, CURLOPT_URL, req->url);
+        curl_easy_setopt (req->easy, CURLOPT_PRIVATE, req);
+        curl_easy_setopt (req->easy, CURLOPT_WRITEFUNCTION, net_common_curl_write_data);
+        curl_easy_setopt (req->easy, CURLOPT_WRITEDATA, &req->dl);
+        curl_easy_setopt (req->easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt (req->easy, CURLOPT_CONNECTTIMEOUT_MS, (long)NET_WORKER_CONNECT_TIMEOUT_MS);
+        curl_easy_setopt (req->easy, CURLOPT_TIMEOUT_MS, req->timeout_ms);
+        /* not very secure, but probably makes life again easier */
+        curl_easy_setopt (req->easy, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt (req->easy, CURLOPT_SSL_VERIFYHOST, 0L);
+
+        if (curl_multi_add_handle (_multi, req->easy) != CURLM_OK) {
+            req->error = NET_WORKER_ERROR_TRANSFER;
+            _finish (req);
+            continue;
+        }
+        req->state = REQUEST_STATE_RUNNING;
+        req->start = g_get_monotonic_time ();
+        stats_inc (STATS_NET_REQUESTS);
+        _running = g_list_prepend (_running, req);
+    }
+}
+
+/* called locked */
+static void _remove_cancelled (void)
+{
+    GList *l = _running;
+    while (l != NULL) {
+        GList *next = l->next;
+        NetWorkerRequest *req = (NetWorkerRequest *)l->data;
+        if (req->cancelled == TRUE) {
+            curl_multi_remove_handle (_multi, req->easy);
+            _running = g_list_delete_link (_running, l);
+            g_hash_table_remove (_requests, GUINT_TO_POINTER (req->id));
+            _request_free (req);
+        }
+        l = next;
+    }
+}
+
+static void _read_finished (void)
+{
+    CURLMsg *msg;
+    int left = 0;
+    while ((msg = curl_multi_info_read (_multi, &left)) != NULL) {
+        NetWorkerRequest *req = NULL;
+        CURLcode res;
+        long status = 0;
+
+        if (msg->msg != CURLMSG_DONE) continue;
+        res = msg->data.result; /* msg is not valid after remove */
+        curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **)&req);
+        if (req == NULL) continue;
+        curl_easy_getinfo (req->easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle (_multi, req->easy);
+        curl_easy_cleanup (req->easy);
+        req->easy = NULL;
+        stats_record (STATS_NET_LATENCY, g_get_monotonic_time () - req->start);
+
+        if (res != CURLE_OK) {
+            LOG_DEBUG ("%s: %s", req->url, curl_easy_strerror (res));
+            req->error = NET_WORKER_ERROR_TRANSFER;
+        } else if (status >= 400) {
+            LOG_DEBUG ("%s: HTTP %ld", req->url, status);
+            req->error = NET_WORKER_ERROR_HTTP;
+        }
+        if (req->error != NET_WORKER_ERROR_NONE) stats_inc (STATS_NET_FAILURES);
+
+        g_mutex_lock (&_mutex);
+        _running = g_list_remove (_running, req);
+        if (req->cancelled == TRUE) {
+            g_hash_table_remove (_requests, GUINT_TO_POINTER (req->id));
+            _request_free (req);
+        } else {
+            _finish (req);
+        }
+        g_mutex_unlock (&_mutex);
+    }
+}
+
+/* called locked. Hands request to waiter or main loop */
+static void _finish (NetWorkerRequest *req)
+{
+    req->dl.data = g_realloc (req->dl.data, req->dl.size + 1);
+    req->dl.data[req->dl.size] = '\0';
+    req->state = REQUEST_STATE_DONE;
+    if (req->sync == TRUE) g_cond_broadcast (&_cond);
+    else req->idle_id = g_idle_add (_deliver_idle, req);
+}
+
+/* called locked at exit. Async requests are freed by net_worker_free */
+static void _stop_all (void)
+{
+    NetWorkerRequest *req;
+    for (GList *l = _running; l != NULL; l = l->next) {
+        req = (NetWorkerRequest *)l->data;
+        curl_multi_remove_handle (_multi, req->easy);
+        if (req->sync == TRUE) {
+            req->error = NET_WORKER_ERROR_CANCELLED;
+            _finish (req);
+        }
+    }
+    g_list_free (_running);
+    _running = NULL;
+    while ((req = (NetWorkerRequest *)g_queue_pop_head (&_queue)) != NULL) {
+        if (req->sync == TRUE) {
+            req->error = NET_WORKER_ERROR_CANCELLED;
+            _finish (req);
+        }
+    }
+}
+
+static gboolean _deliver_idle (gpointer user_data)
+{
+    NetWorkerRequest *req = (NetWorkerRequest *)user_data;
+    gboolean cancelled;
+    gchar *data = NULL;
+
+    g_mutex_lock (&_mutex);
+    g_hash_table_remove (_requests, GUINT_TO_POINTER (req->id));
+    cancelled = req->cancelled;
+    g_mutex_unlock (&_mutex);
+
+    if (cancelled == FALSE) {
+        if (req->error == NET_WORKER_ERROR_NONE) {
+            data = req->dl.data;
+            req->dl.data = NULL;
+        }
+        req->done (data, req->error, req->user_data);
+    }
+    _request_free (req);
+    return FALSE;
+}
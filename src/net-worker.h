@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_NET_WORKER_H_
+#define _KK_NET_WORKER_H_
+
+#include <glib.h>
+
+typedef enum {
+    NET_WORKER_ERROR_NONE = 0,
+    NET_WORKER_ERROR_TRANSFER,  /* connect, timeout, ... */
+    NET_WORKER_ERROR_HTTP,      /* server replied with error status */
+    NET_WORKER_ERROR_CANCELLED
+} NetWorkerError;
+
+/*
+ * Called from main loop when request is done. data is null terminated
+ * and owned by callee, NULL on error. Not called for cancelled requests.
+ */
+typedef void (*NetWorkerDoneFunc) (gchar *data, NetWorkerError error, gpointer user_data);
+
+/*
+ * Starts network thread. All requests share one curl multi handle, so
+ * connections and dns results are reused between requests.
+ */
+gboolean net_worker_init (void);
+void net_worker_free (void);
+
+/* Queues GET request. Returns request id or 0 on error. */
+guint net_worker_get (const gchar *url, NetWorkerDoneFunc done, gpointer user_data);
+
+/* Cancels request. done is not called after this. */
+void net_worker_cancel (guint id);
+
+/* Blocking GET through worker. Can be called from any thread. */
+gchar *net_worker_get_sync (const gchar *url);
+
+#endif
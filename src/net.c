@@ -18,67 +18,59 @@
  */
 
 #include "net.h"
-#include "net-common.h"
 #include "net-lyrics.h"
+#include "net-lyrics-cache.h"
+#include "net-worker.h"
 
-#include <curl/curl.h>
+static NetLyricsData *_lyrics = NULL; /* current lyrics request */
 
-static GThread *_thread = NULL;
+gboolean net_init (void)
+{
+    return net_worker_init ();
+}
 
 void net_free (void)
 {
-    net_join_lyrics_thread ();
+    net_cancel_lyrics ();
+    net_worker_free ();
 }
 
 gchar *net_get (const gchar *url)
 {
-    NetCommonDownload dl = {0,};
-    CURLcode res;
-    CURL *curl = curl_easy_init();
-    if (curl == NULL) return NULL;
-
-    curl_easy_setopt (curl, CURLOPT_URL, url);
-    curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, net_common_curl_write_data);
-    curl_easy_setopt (curl, CURLOPT_WRITEDATA, &dl);
-
-    /* not very secure, but probably makes life again easier */
-    curl_easy_setopt (curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt (curl, CURLOPT_SSL_VERIFYHOST, 0L);
-    res = curl_easy_perform (curl);
-
-    curl_easy_cleanup (curl);
-
-    dl.data = g_realloc (dl.data, dl.size + 1);
-    dl.data[dl.size] = '\0';
-
-    (void)res;
-    return dl.data;
+    return net_worker_get_sync (url);
 }
 
-
 gint net_get_lyrics (const gchar *artist, const gchar *title, NetLyricsService service, GSourceFunc cb)
 {
-    NetLyricsThreadData *data = NULL;
+    NetLyricsData *data = NULL;
+    gchar *cached = NULL;
     gint ret = 0;
     if (cb == NULL) {
         return 1;
     }
 
-    /* Only one thread at the time */
-    net_join_lyrics_thread ();
+    /* Only one request at the time. Result of previous song is not needed anymore. */
+    net_cancel_lyrics ();
+
+    if (service >= NET_LYRICS_SERVICE_FIRST && service < NET_LYRICS_SERVICE_END &&
+            net_lyrics_cache_get (service, artist, title, &cached) == TRUE) {
+        /* no network needed. cb takes the string */
+        cb ((gpointer)cached);
+        return 0;
+    }
 
     switch (service) {
         case NET_LYRICS_SERVICE_CHARTLYRICS:
         {
-            data = g_new0 (NetLyricsThreadData, 1);
+            data = g_new0 (NetLyricsData, 1);
             if (data == NULL) goto lyrics_error;
             data->artist = g_strdup (artist);
             if (data->artist == NULL) goto lyrics_error;
             data->title = g_strdup (title);
             if (data->title == NULL) goto lyrics_error;
             data->cb = cb;
-            _thread = g_thread_new ("ChartLyricsThread", net_lyrics_chartlyrics_thread, (gpointer)data);
-            if (_thread == NULL) goto lyrics_error;
+            if (net_lyrics_chartlyrics_fetch (data) == FALSE) goto lyrics_error;
+            _lyrics = data;
         }
         break;
         case NET_LYRICS_SERVICE_NONE:
@@ -94,11 +86,11 @@ lyrics_error:
     return 100;
 }
 
-void net_join_lyrics_thread (void)
+void net_cancel_lyrics (void)
 {
-    if (_thread != NULL) {
-        NetLyricsThreadData *data = (NetLyricsThreadData *)g_thread_join (_thread);
-        if (data != NULL) net_lyrics_free_data (data);
-        _thread = NULL;
+    if (_lyrics != NULL) {
+        if (_lyrics->request_id != 0) net_worker_cancel (_lyrics->request_id);
+        net_lyrics_free_data (_lyrics);
+        _lyrics = NULL;
     }
 }
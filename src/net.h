@@ -29,11 +29,14 @@ typedef enum {
     NET_LYRICS_SERVICE_END
 } NetLyricsService;
 
+gboolean net_init (void);
 void net_free (void);
 
+/* Blocking download. Returns NULL on error. */
 gchar *net_get (const gchar *url);
 
+/* Cancels previous lyrics request and starts new one. */
 gint net_get_lyrics (const gchar *artist, const gchar *title, NetLyricsService service, GSourceFunc cb);
-void net_join_lyrics_thread (void);
+void net_cancel_lyrics (void);
 
 #endif
@@ -89,3 +89,58 @@ gchar *paths_saved_data_stderr_log (void) {
     return g_strdup (path);
 }
 
+gchar *paths_saved_data_lyrics_dir (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "lyrics", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    g_mkdir_with_parents (path, S_IRUSR | S_IWUSR | S_IXUSR);
+    return g_strdup (path);
+}
+
+gchar *paths_saved_data_quarantine (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "quarantine.txt", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    return g_strdup (path);
+}
+
+gchar *paths_saved_data_negative_cache (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "negative-cache.txt", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    return g_strdup (path);
+}
+
+gchar *paths_saved_data_playlist_snapshot (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "default.snapshot", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    return g_strdup (path);
+}
+
+gchar *paths_saved_data_playlist_journal (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "default.journal", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    return g_strdup (path);
+}
+
+gchar *paths_saved_data_render_cache_dir (void) {
+    gchar *dir = paths_saved_data_dir();
+    gchar path[PATH_MAX];
+    if (dir == NULL) return NULL;
+    g_snprintf (path, PATH_MAX, "%s%c" "render-cache", dir, G_DIR_SEPARATOR);
+    g_free (dir);
+    g_mkdir_with_parents (path, S_IRUSR | S_IWUSR | S_IXUSR);
+    return g_strdup (path);
+}
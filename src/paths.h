@@ -36,5 +36,11 @@ gchar *paths_saved_data_dir (void); /* Creates path if not there */
 gchar *paths_saved_data_default_playlist (void);
 gchar *paths_saved_data_default_log (void);
 gchar *paths_saved_data_stderr_log (void);
+gchar *paths_saved_data_lyrics_dir (void); /* Creates path if not there */
+gchar *paths_saved_data_quarantine (void);
+gchar *paths_saved_data_negative_cache (void);
+gchar *paths_saved_data_playlist_snapshot (void);
+gchar *paths_saved_data_playlist_journal (void);
+gchar *paths_saved_data_render_cache_dir (void); /* Creates path if not there */
 
 #endif
@@ -38,17 +38,28 @@ typedef enum {
     PLAYER_MESSAGE_ERROR,
     PLAYER_MESSAGE_ABOUT_TO_FINISH,
     PLAYER_MESSAGE_EOS,
-    PLAYER_MESSAGE_TAG
+    PLAYER_MESSAGE_TUNE_END, /* scheduled end of SID tune or module */
+    PLAYER_MESSAGE_BUFFERING, /* data: gint percent */
+    PLAYER_MESSAGE_TAG /* data: Song with changed tags, can be the playing song itself */
 } PlayerMessage;
 
 typedef void (*PlayerStatusUpdateFunc)(PlayerMessage mgs, gpointer data);
 
+typedef struct {
+    gint buffer_percent;
+    guint underruns; /* buffer ran empty while playing */
+    guint reconnects;
+    gboolean reconnecting;
+} PlayerStreamStatus;
+
 void player_preinit (int *argc, char **argv[]);
 
 gboolean player_init (PlayerStatusUpdateFunc status_update_func);
 void player_free (void);
 
 gint player_set_song (Song *s);
+void player_preroll (Song *s, gint tune); /* prepare likely next song, NULL drops it */
+gboolean player_is_prerolled (Song *s, gint tune);
 
 PlayerState player_play (void);
 PlayerState player_toggle_playpause (void);
@@ -68,5 +79,13 @@ PlayerState player_state (void);
 gint64 player_get_current_time (void);
 
 gint player_set_sid_tune (gint tune);
+/* Switch playing song to tune set above. FALSE: needs stop and play */
+gboolean player_apply_sid_tune (void);
+
+/* Current song, when it is a network stream */
+void player_stream_status (PlayerStreamStatus *status);
+
+/* Pipeline timings as text when diagnostics are on, otherwise NULL. Caller frees */
+gchar *player_diagnostics (void);
 #endif
 
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h> /* realpath */
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "playlist-file.h"
+#include "util.h"
+#include "log.h"
+
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+gboolean playlist_file_lines_open (PlaylistFileLines *lines, const gchar *filename)
+{
+    GError *error = NULL;
+    gchar expanded[PATH_MAX] = "";
+
+    memset (lines, 0, sizeof (PlaylistFileLines));
+    if (FALSE == util_expand_tilde (filename, expanded)) return FALSE;
+    lines->map = g_mapped_file_new (expanded, FALSE, &error);
+    if (lines->map == NULL) {
+        LOG_ERROR("Failed to read playlist (%s): %s", filename, error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+    playlist_file_lines_init (lines, g_mapped_file_get_contents (lines->map), g_mapped_file_get_length (lines->map));
+    return TRUE;
+}
+
+void playlist_file_lines_init (PlaylistFileLines *lines, const gchar *data, gsize len)
+{
+    lines->pos = data;
+    lines->end = data != NULL ? data + len : NULL;
+    if (len >= 3 && memcmp (data, "\xef\xbb\xbf", 3) == 0) lines->pos += 3; /* utf-8 bom */
+}
+
+gboolean playlist_file_lines_next (PlaylistFileLines *lines, const gchar **line, gsize *len)
+{
+    const gchar *start;
+    const gchar *stop;
+    const gchar *nl;
+
+    if (lines->pos == NULL || lines->pos >= lines->end) return FALSE;
+    start = lines->pos;
+    nl = memchr (start, '\n', lines->end - start);
+    stop = nl != NULL ? nl : lines->end;
+    lines->pos = nl != NULL ? nl + 1 : lines->end;
+
+    while (start < stop && g_ascii_isspace (*start)) start++;
+    while (stop > start && g_ascii_isspace (*(stop - 1))) stop--; /* also \r */
+    *line = start;
+    *len = stop - start;
+    return TRUE;
+}
+
+void playlist_file_lines_close (PlaylistFileLines *lines)
+{
+    if (lines->map != NULL) g_mapped_file_unref (lines->map);
+    memset (lines, 0, sizeof (PlaylistFileLines));
+}
+
+gchar *playlist_file_base_dir (const gchar *filename)
+{
+    char str[PATH_MAX];
+    gchar expanded[PATH_MAX] = "";
+    if (FALSE == util_expand_tilde (filename, expanded)) return NULL;
+    if (realpath (expanded, str) == NULL) return NULL;
+    return g_path_get_dirname (str);
+}
+
+gchar *playlist_file_resolve (const gchar *base_dir, const gchar *entry, gsize len)
+{
+    gchar *tmp;
+    gchar *scheme;
+    gchar *path = NULL;
+    gchar expanded[PATH_MAX] = "";
+
+    if (entry == NULL || len == 0) return NULL;
+    tmp = g_strndup (entry, len);
+    if (tmp == NULL) return NULL;
+
+    scheme = g_uri_parse_scheme (tmp);
+    if (scheme != NULL) { /* uri as it is */
+        g_free (scheme);
+        return tmp;
+    }
+    if (tmp[0] == '~') {
+        if (util_expand_tilde (tmp, expanded) == TRUE) path = g_strdup (expanded);
+    } else if (g_path_is_absolute (tmp)) {
+        path = g_canonicalize_filename (tmp, NULL);
+    } else if (base_dir != NULL) {
+        path = g_canonicalize_filename (tmp, base_dir);
+    }
+    g_free (tmp);
+    return path;
+}
+
+FILE *playlist_file_write_begin (const gchar *filename, gchar **tmpname)
+{
+    FILE *f;
+    int fd;
+    gchar expanded[PATH_MAX] = "";
+
+    *tmpname = NULL;
+    if (FALSE == util_expand_tilde (filename, expanded)) return NULL;
+    else if (strlen (expanded) == 0) return NULL;
+
+    *tmpname = g_strdup_printf ("%s.XXXXXX", expanded);
+    if (*tmpname == NULL) return NULL;
+    fd = g_mkstemp_full (*tmpname, O_WRONLY, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    if (fd < 0) goto write_begin_error;
+    f = fdopen (fd, "w");
+    if (f == NULL) {
+        close (fd);
+        unlink (*tmpname);
+        goto write_begin_error;
+    }
+    (void)setvbuf (f, NULL, _IOFBF, WRITE_BUFFER_SIZE);
+    return f;
+write_begin_error:
+    LOG_ERROR("Failed to write playlist (%s): Could not create file.", filename);
+    g_free (*tmpname);
+    *tmpname = NULL;
+    return NULL;
+}
+
+gboolean playlist_file_write_end (FILE *f, gchar *tmpname, const gchar *filename, gboolean ok)
+{
+    gchar expanded[PATH_MAX] = "";
+    if (f == NULL || tmpname == NULL) return FALSE;
+
+    if (fflush (f) != 0 || ferror (f) != 0) ok = FALSE;
+    if (ok == TRUE && fsync (fileno (f)) != 0) ok = FALSE; /* data before rename */
+    if (fclose (f) != 0) ok = FALSE;
+    if (ok == TRUE) ok = util_expand_tilde (filename, expanded);
+    if (ok == TRUE && rename (tmpname, expanded) != 0) ok = FALSE;
+    if (ok == FALSE) {
+        LOG_ERROR("Failed to write playlist (%s).", filename);
+        unlink (tmpname);
+    }
+    g_free (tmpname);
+    return ok;
+}
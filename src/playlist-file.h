@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_PLAYLIST_FILE_H_
+#define _KK_PLAYLIST_FILE_H_
+
+#include <stdio.h>
+#include <glib.h>
+
+/*
+ * Shared helpers for playlist readers and writers. Nothing here uses
+ * the working directory, so these can be used from any thread.
+ */
+
+typedef struct {
+    GMappedFile *map; /* NULL when reading from memory */
+    const gchar *pos;
+    const gchar *end;
+} PlaylistFileLines;
+
+/* Maps file to memory. Returns FALSE if file can not be opened. */
+gboolean playlist_file_lines_open (PlaylistFileLines *lines, const gchar *filename);
+
+/* Iterates content already in memory, which must outlive lines */
+void playlist_file_lines_init (PlaylistFileLines *lines, const gchar *data, gsize len);
+
+/* Next line without end of line and surrounding white space. Line is
+ * not null terminated and it points to the mapped data. */
+gboolean playlist_file_lines_next (PlaylistFileLines *lines, const gchar **line, gsize *len);
+
+void playlist_file_lines_close (PlaylistFileLines *lines);
+
+/* Directory of real location of playlist file. Free with g_free */
+gchar *playlist_file_base_dir (const gchar *filename);
+
+/* Uri or absolute path of playlist entry. Relative paths are relative to
+ * base_dir; with NULL base_dir they are not accepted. Free with g_free */
+gchar *playlist_file_resolve (const gchar *base_dir, const gchar *entry, gsize len);
+
+/* Buffered writing to temporary file which replaces filename in
+ * playlist_file_write_end (). ok FALSE drops written file. */
+FILE *playlist_file_write_begin (const gchar *filename, gchar **tmpname);
+gboolean playlist_file_write_end (FILE *f, gchar *tmpname, const gchar *filename, gboolean ok);
+
+#endif
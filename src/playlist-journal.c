@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "playlist-journal.h"
+#include "playlist-pls.h"
+#include "playlist-file.h"
+#include "log.h"
+
+#define JOURNAL_MAGIC "KKPJ"
+#define JOURNAL_VERSION 1
+#define JOURNAL_FLAG_EMPTY_BASE 1
+#define JOURNAL_COMPACT_SIZE (4 * 1024 * 1024)
+#define JOURNAL_IDLE_COMPACT_TIME (300 * G_USEC_PER_SEC)
+#define JOURNAL_RETRY_TIME (5 * G_USEC_PER_SEC) /* failed writes, e.g. disk full */
+
+typedef struct {
+    gchar magic[4];
+    guint32 version;
+    guint64 base_generation;
+    gint64 created; /* real time in seconds */
+    guint32 flags;
+    guint32 reserved;
+} JournalHeader;
+
+typedef struct {
+    guint32 len; /* payload */
+    guint32 hash; /* FNV-1a of payload */
+} RecordHeader; /* payload starts with JournalOp byte */
+
+typedef enum {
+    JOURNAL_OP_INSERT = 1,
+    JOURNAL_OP_REMOVE,
+    JOURNAL_OP_UPDATE,
+    JOURNAL_OP_STATE
+} JournalOp;
+
+/* writer thread only */
+static gchar *_filename = NULL;
+static gchar *_snapshot = NULL;
+static gchar *_pls = NULL;
+static int _fd = -1;
+static guint64 _base_generation = 0;
+static gboolean _empty_base = FALSE;
+static goffset _size = 0; /* records after header */
+static gboolean _compact_failed = FALSE;
+static GQueue _pending = G_QUEUE_INIT; /* records not written yet, in order */
+static gint _lost = FALSE; /* records were pending at close */
+
+static GThread *_thread = NULL;
+static GAsyncQueue *_queue = NULL;
+static gint _quit_marker;
+
+static gpointer _writer (gpointer data);
+static gboolean _start_new (guint64 base_generation, gboolean empty_base);
+static gboolean _flush_pending (void);
+static gboolean _write_record (GBytes *record);
+static void _compact (void);
+static GByteArray *_record_new (JournalOp op);
+static void _record_push (GByteArray *b);
+static guint32 _hash (const guchar *data, gsize len);
+static gboolean _apply (PlaylistSnapshot *ps, const guchar *p, const guchar *end);
+
+gboolean playlist_journal_open (const gchar *filename, const gchar *snapshot, const gchar *pls,
+                                guint64 base_generation, gboolean empty_base, goffset continue_at)
+{
+    if (_thread != NULL) return TRUE;
+    if (filename == NULL || snapshot == NULL) return FALSE;
+    _filename = g_strdup (filename);
+    _snapshot = g_strdup (snapshot);
+    _pls = g_strdup (pls);
+    _base_generation = base_generation;
+    _empty_base = empty_base;
+    _compact_failed = FALSE;
+    g_atomic_int_set (&_lost, FALSE);
+
+    if (continue_at > (goffset)sizeof (JournalHeader)) {
+        _fd = open (_filename, O_WRONLY);
+        if (_fd < 0 || ftruncate (_fd, continue_at) != 0 || lseek (_fd, 0, SEEK_END) < 0) {
+            if (_fd >= 0) close (_fd);
+            _fd = -1;
+        }
+        _size = continue_at - sizeof (JournalHeader);
+    }
+    if (_fd < 0 && _start_new (base_generation, empty_base) == FALSE) goto open_error;
+
+    _queue = g_async_queue_new ();
+    _thread = g_thread_try_new ("journal", _writer, NULL, NULL);
+    if (_thread == NULL) goto open_error;
+    return TRUE;
+open_error:
+    LOG_ERROR("Failed to open playlist journal %s.", filename);
+    if (_queue != NULL) g_async_queue_unref (_queue);
+    _queue = NULL;
+    if (_fd >= 0) close (_fd);
+    _fd = -1;
+    g_free (_filename);
+    g_free (_snapshot);
+    g_free (_pls);
+    _filename = _snapshot = _pls = NULL;
+    return FALSE;
+}
+
+gboolean playlist_journal_close (void)
+{
+    if (_thread == NULL) return TRUE;
+    g_async_queue_push (_queue, &_quit_marker);
+    g_thread_join (_thread);
+    _thread = NULL;
+    g_async_queue_unref (_queue);
+    _queue = NULL;
+    if (_fd >= 0) close (_fd);
+    _fd = -1;
+    g_free (_filename);
+    g_free (_snapshot);
+    g_free (_pls);
+    _filename = _snapshot = _pls = NULL;
+    return g_atomic_int_get (&_lost) == FALSE;
+}
+
+gboolean playlist_journal_is_open (void)
+{
+    return _thread != NULL;
+}
+
+void playlist_journal_insert (gint index, GList *songs)
+{
+    GByteArray *b;
+    guint32 count = 0;
+    gint32 i32 = index;
+    guint count_pos;
+    if (_thread == NULL || songs == NULL) return;
+
+    b = _record_new (JOURNAL_OP_INSERT);
+    g_byte_array_append (b, (const guint8 *)&i32, sizeof (i32));
+    count_pos = b->len;
+    g_byte_array_append (b, (const guint8 *)&count, sizeof (count));
+    for (GList *l = songs; l != NULL; l = l->next) {
+        if (l->data == NULL) continue;
+        playlist_snapshot_append_song (b, (const Song *)l->data);
+        count++;
+    }
+    memcpy (b->data + count_pos, &count, sizeof (count));
+    _record_push (b);
+}
+
+void playlist_journal_remove (GArray *indexes)
+{
+    GByteArray *b;
+    guint32 count;
+    if (_thread == NULL || indexes == NULL || indexes->len == 0) return;
+
+    b = _record_new (JOURNAL_OP_REMOVE);
+    count = indexes->len;
+    g_byte_array_append (b, (const guint8 *)&count, sizeof (count));
+    g_byte_array_append (b, (const guint8 *)indexes->data, sizeof (gint32) * count);
+    _record_push (b);
+}
+
+void playlist_journal_update (gint index, const Song *s)
+{
+    GByteArray *b;
+    gint32 i32 = index;
+    if (_thread == NULL || s == NULL) return;
+
+    b = _record_new (JOURNAL_OP_UPDATE);
+    g_byte_array_append (b, (const guint8 *)&i32, sizeof (i32));
+    playlist_snapshot_append_song (b, s);
+    _record_push (b);
+}
+
+void playlist_journal_state (guint mode, gboolean loop, gint current, guint8 volume, GArray *shuffle)
+{
+    GByteArray *b;
+    guint32 v[5];
+    if (_thread == NULL) return;
+
+    v[0] = mode;
+    v[1] = loop;
+    v[2] = (guint32)current;
+    v[3] = volume;
+    v[4] = shuffle != NULL ? shuffle->len : 0;
+    b = _record_new (JOURNAL_OP_STATE);
+    g_byte_array_append (b, (const guint8 *)v, sizeof (v));
+    if (v[4] > 0) g_byte_array_append (b, (const guint8 *)shuffle->data, sizeof (guint32) * v[4]);
+    _record_push (b);
+}
+
+gboolean playlist_journal_replay (const gchar *filename, PlaylistSnapshot *ps, gboolean have_base,
+                                  gboolean *empty_base, goffset *valid_end)
+{
+    GMappedFile *map;
+    JournalHeader h;
+    const guchar *start, *p, *end;
+    gboolean ret = FALSE;
+
+    if (valid_end != NULL) *valid_end = 0;
+    if (filename == NULL || ps == NULL) return FALSE;
+    if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) == FALSE) return FALSE;
+    map = g_mapped_file_new (filename, FALSE, NULL);
+    if (map == NULL) return FALSE;
+    start = p = (const guchar *)g_mapped_file_get_contents (map);
+    end = p + g_mapped_file_get_length (map);
+
+    if ((gsize)(end - p) < sizeof (h)) goto replay_error;
+    memcpy (&h, p, sizeof (h));
+    p += sizeof (h);
+    if (memcmp (h.magic, JOURNAL_MAGIC, 4) != 0 || h.version != JOURNAL_VERSION) goto replay_error;
+    if ((h.flags & JOURNAL_FLAG_EMPTY_BASE) == 0) {
+        /* written for other snapshot, which means it has been compacted already */
+        if (have_base == FALSE || h.base_generation != ps->generation) goto replay_error;
+    } else {
+        g_ptr_array_set_size (ps->songs, 0);
+        if (ps->shuffle != NULL) g_array_free (ps->shuffle, TRUE);
+        ps->shuffle = NULL;
+        ps->current = -1;
+        ps->generation = h.base_generation;
+        ps->saved = h.created;
+    }
+    if (empty_base != NULL) *empty_base = (h.flags & JOURNAL_FLAG_EMPTY_BASE) != 0;
+
+    while ((gsize)(end - p) >= sizeof (RecordHeader)) {
+        RecordHeader rh;
+        memcpy (&rh, p, sizeof (rh));
+        if (rh.len == 0 || (gsize)(end - p - sizeof (rh)) < rh.len) break; /* torn write */
+        if (_hash (p + sizeof (rh), rh.len) != rh.hash) break;
+        if (_apply (ps, p + sizeof (rh), p + sizeof (rh) + rh.len) == FALSE) break;
+        p += sizeof (rh) + rh.len;
+    }
+    if (p != end) LOG_ERROR("Playlist journal %s has invalid records at end, ignoring them.", filename);
+    if (ps->current >= (gint)ps->songs->len) ps->current = -1;
+    if (valid_end != NULL) *valid_end = p - start;
+    ret = TRUE;
+replay_error:
+    g_mapped_file_unref (map);
+    return ret;
+}
+
+static gboolean _apply (PlaylistSnapshot *ps, const guchar *p, const guchar *end)
+{
+    guint8 op = *p++;
+    gint32 index;
+    guint32 count;
+
+    switch (op) {
+        case JOURNAL_OP_INSERT:
+            if ((gsize)(end - p) < sizeof (index) + sizeof (count)) return FALSE;
+            memcpy (&index, p, sizeof (index));
+            memcpy (&count, p + sizeof (index), sizeof (count));
+            p += sizeof (index) + sizeof (count);
+            if (index < 0 || index > (gint32)ps->songs->len) index = ps->songs->len;
+            for (guint32 i = 0; i < count; i++) {
+                Song *s = playlist_snapshot_parse_song (&p, end);
+                if (s == NULL) return FALSE;
+                g_ptr_array_insert (ps->songs, index + i, s);
+            }
+            break;
+        case JOURNAL_OP_REMOVE:
+            if ((gsize)(end - p) < sizeof (count)) return FALSE;
+            memcpy (&count, p, sizeof (count));
+            p += sizeof (count);
+            if ((gsize)(end - p) < sizeof (gint32) * count) return FALSE;
+            for (guint32 i = 0; i < count; i++) {
+                memcpy (&index, p + i * sizeof (gint32), sizeof (index));
+                if (index < 0 || index >= (gint32)ps->songs->len) return FALSE;
+                g_ptr_array_remove_index (ps->songs, index);
+            }
+            break;
+        case JOURNAL_OP_UPDATE: {
+            Song *s;
+            if ((gsize)(end - p) < sizeof (index)) return FALSE;
+            memcpy (&index, p, sizeof (index));
+            p += sizeof (index);
+            if (index < 0 || index >= (gint32)ps->songs->len) return FALSE;
+            s = playlist_snapshot_parse_song (&p, end);
+            if (s == NULL) return FALSE;
+            song_delete (g_ptr_array_index (ps->songs, index));
+            g_ptr_array_index (ps->songs, index) = s;
+            return TRUE; /* order stays */
+        }
+        case JOURNAL_OP_STATE: {
+            guint32 v[5];
+            if ((gsize)(end - p) < sizeof (v)) return FALSE;
+            memcpy (v, p, sizeof (v));
+            p += sizeof (v);
+            if (v[4] > 0 && (v[4] != ps->songs->len || (gsize)(end - p) < sizeof (guint32) * v[4])) return FALSE;
+            ps->mode = v[0];
+            ps->loop = v[1] != 0;
+            ps->current = (gint32)v[2];
+            ps->volume = MIN (v[3], 100);
+            if (ps->shuffle != NULL) g_array_free (ps->shuffle, TRUE);
+            ps->shuffle = NULL;
+            if (v[4] > 0) {
+                ps->shuffle = g_array_sized_new (FALSE, FALSE, sizeof (guint32), v[4]);
+                g_array_append_vals (ps->shuffle, p, v[4]);
+                for (guint32 i = 0; i < v[4]; i++) {
+                    if (g_array_index (ps->shuffle, guint32, i) >= v[4]) return FALSE;
+                }
+            }
+            return TRUE;
+        }
+        default:
+            return FALSE;
+    }
+    /* suffle order and current song are known again from next state record */
+    if (ps->shuffle != NULL) g_array_free (ps->shuffle, TRUE);
+    ps->shuffle = NULL;
+    return TRUE;
+}
+
+static gpointer _writer (gpointer data)
+{
+    (void)data;
+    while (TRUE) {
+        guint64 timeout = g_queue_is_empty (&_pending) ? JOURNAL_IDLE_COMPACT_TIME : JOURNAL_RETRY_TIME;
+        gpointer msg = g_async_queue_timeout_pop (_queue, timeout);
+        if (msg == NULL) { /* idle */
+            /* journal must have all records before it is compacted */
+            if (_flush_pending () == TRUE && _size > 0) _compact ();
+            continue;
+        }
+        if (msg == &_quit_marker) break;
+        g_queue_push_tail (&_pending, msg);
+        if (_flush_pending () == FALSE) continue;
+
+        if (g_async_queue_length (_queue) > 0) continue; /* sync after burst */
+        if (_fd >= 0) (void)fdatasync (_fd);
+        if (_size >= JOURNAL_COMPACT_SIZE) _compact ();
+    }
+    if (_flush_pending () == FALSE) {
+        LOG_ERROR("Playlist journal %s could not be written, %u changes lost.", _filename, _pending.length);
+        g_atomic_int_set (&_lost, TRUE);
+        while (g_queue_is_empty (&_pending) == FALSE) g_bytes_unref ((GBytes *)g_queue_pop_head (&_pending));
+    }
+    if (_fd >= 0) (void)fdatasync (_fd);
+    return NULL;
+}
+
+/* writes records in order. FALSE if some are still pending */
+static gboolean _flush_pending (void)
+{
+    while (g_queue_is_empty (&_pending) == FALSE) {
+        GBytes *record = (GBytes *)g_queue_peek_head (&_pending);
+        if (_write_record (record) == FALSE) return FALSE;
+        g_bytes_unref ((GBytes *)g_queue_pop_head (&_pending));
+    }
+    return TRUE;
+}
+
+static gboolean _start_new (guint64 base_generation, gboolean empty_base)
+{
+    JournalHeader h;
+    gchar *tmpname = NULL;
+    FILE *f;
+    int fd;
+
+    memset (&h, 0, sizeof (h));
+    memcpy (h.magic, JOURNAL_MAGIC, 4);
+    h.version = JOURNAL_VERSION;
+    h.base_generation = base_generation;
+    h.created = g_get_real_time () / G_USEC_PER_SEC;
+    h.flags = empty_base == TRUE ? JOURNAL_FLAG_EMPTY_BASE : 0;
+
+    f = playlist_file_write_begin (_filename, &tmpname);
+    if (f == NULL) return FALSE;
+    fwrite (&h, sizeof (h), 1, f);
+    if (playlist_file_write_end (f, tmpname, _filename, TRUE) == FALSE) return FALSE;
+
+    fd = open (_filename, O_WRONLY | O_APPEND);
+    if (fd < 0) return FALSE;
+    if (_fd >= 0) close (_fd);
+    _fd = fd;
+    _size = 0;
+    _base_generation = base_generation;
+    _empty_base = empty_base;
+    return TRUE;
+}
+
+/* FALSE if record could not be written. Partly written one is cut off, so it can be retried */
+static gboolean _write_record (GBytes *record)
+{
+    gsize len = 0;
+    const guchar *data = g_bytes_get_data (record, &len);
+    gsize done = 0;
+    if (_fd < 0) return FALSE;
+
+    while (done < len) {
+        ssize_t r = write (_fd, data + done, len - done);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            LOG_ERROR("Failed to write playlist journal %s: %s", _filename, g_strerror (errno));
+            if (done > 0 && (ftruncate (_fd, sizeof (JournalHeader) + _size) != 0 ||
+                             lseek (_fd, 0, SEEK_END) < 0)) {
+                close (_fd);
+                _fd = -1; /* torn record would hide later ones, keep them pending */
+            }
+            return FALSE;
+        }
+        done += r;
+    }
+    _size += len;
+    return TRUE;
+}
+
+/* snapshot + journal to new snapshot, then new empty journal */
+static void _compact (void)
+{
+    PlaylistSnapshot ps;
+    GList *l = NULL;
+
+    if (_compact_failed == TRUE) return;
+    playlist_snapshot_init (&ps);
+    if (_empty_base == FALSE) {
+        if (playlist_snapshot_read (_snapshot, &ps) == FALSE || ps.generation != _base_generation) goto compact_error;
+    }
+    if (playlist_journal_replay (_filename, &ps, _empty_base == FALSE, NULL, NULL) == FALSE) goto compact_error;
+
+    ps.generation = _base_generation + 1;
+    ps.saved = g_get_real_time () / G_USEC_PER_SEC;
+    /* pls first, so snapshot is not older */
+    for (gint i = ps.songs->len - 1; i > -1; i--) l = g_list_prepend (l, g_ptr_array_index (ps.songs, i));
+    if (_pls != NULL) (void)playlist_pls_save (l, _pls); /* also empty, old songs must not come back */
+    g_list_free (l);
+    if (playlist_snapshot_write (_snapshot, &ps) == FALSE) goto compact_error;
+    if (_start_new (ps.generation, FALSE) == FALSE) goto compact_error;
+    LOG_DEBUG("Playlist journal compacted, %u songs.", ps.songs->len);
+    playlist_snapshot_clear (&ps);
+    return;
+compact_error:
+    LOG_ERROR("Failed to compact playlist journal %s.", _filename);
+    _compact_failed = TRUE; /* journal keeps growing, but nothing is lost */
+    playlist_snapshot_clear (&ps);
+}
+
+static GByteArray *_record_new (JournalOp op)
+{
+    RecordHeader rh = {0,};
+    guint8 o = op;
+    GByteArray *b = g_byte_array_new ();
+    g_byte_array_append (b, (const guint8 *)&rh, sizeof (rh));
+    g_byte_array_append (b, &o, 1);
+    return b;
+}
+
+static void _record_push (GByteArray *b)
+{
+    RecordHeader rh;
+    rh.len = b->len - sizeof (rh);
+    rh.hash = _hash (b->data + sizeof (rh), rh.len);
+    memcpy (b->data, &rh, sizeof (rh));
+    g_async_queue_push (_queue, g_byte_array_free_to_bytes (b));
+}
+
+static guint32 _hash (const guchar *data, gsize len)
+{
+    guint32 h = 2166136261u;
+    for (gsize i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_PLAYLIST_JOURNAL_H_
+#define _KK_PLAYLIST_JOURNAL_H_
+
+#include <glib.h>
+
+#include "song.h"
+#include "playlist-snapshot.h"
+
+/*
+ * Append-only journal of playlist changes on top of playlist snapshot.
+ * Records are queued from main loop and written by own thread. When
+ * journal grows, or has been idle for a while, it is compacted: snapshot
+ * and default pls are rewritten from snapshot + journal, and new empty
+ * journal is started.
+ */
+
+/* Starts writer thread. continue_at > 0 continues existing journal from
+ * that offset (end of its valid records), 0 starts new journal for base
+ * generation. empty_base journals do not need snapshot at all. */
+gboolean playlist_journal_open (const gchar *filename, const gchar *snapshot, const gchar *pls,
+                                guint64 base_generation, gboolean empty_base, goffset continue_at);
+/* Writes queued records and stops writer thread. FALSE if some records
+ * could not be written, then journal does not have all changes. */
+gboolean playlist_journal_close (void);
+gboolean playlist_journal_is_open (void);
+
+/* index -1 appends */
+void playlist_journal_insert (gint index, GList *songs);
+/* Songs removed one by one, index is position at time of removal */
+void playlist_journal_remove (GArray *indexes);
+void playlist_journal_update (gint index, const Song *s);
+/* shuffle can be NULL */
+void playlist_journal_state (guint mode, gboolean loop, gint current, guint8 volume, GArray *shuffle);
+
+/* Applies journal to ps. Returns FALSE if journal is missing or written
+ * for other snapshot. Torn records at end are ignored. */
+gboolean playlist_journal_replay (const gchar *filename, PlaylistSnapshot *ps, gboolean have_base,
+                                  gboolean *empty_base, goffset *valid_end);
+
+#endif
@@ -17,52 +17,112 @@
  * USA.
  */
 
+
+#include <string.h>
+
 #include "playlist-m3u.h"
+#include "playlist-file.h"
 #include "util.h"
 #include "inspector.h"
 #include "log.h"
 
-#define MAX_LINE_LEN 255
+#define EXTINF "#EXTINF:"
 
-GList *playlist_m3u_load (const gchar *filename)
+static gchar *_extinf_title (const gchar *line, gsize len);
+
+GList *playlist_m3u_load (const gchar *filename, const gchar *base_dir)
 {
     GList *l = NULL;
     GList *lt;
-    GIOChannel *channel;
-    GIOStatus status;
-    gchar *line = NULL;
+    PlaylistFileLines lines;
+    const gchar *line;
     gsize len;
-    gchar *curdir = g_get_current_dir ();
-    if (curdir == NULL) return NULL;
+    gchar *title = NULL; /* from #EXTINF, for next entry */
+    gchar *own_dir = NULL;
 
-    channel = g_io_channel_new_file (filename, "r", NULL);
-    if (channel == NULL) {
-        LOG_ERROR("g_io_channel_new_file() failed for file %s.", filename);
-        goto error;
+    if (filename == NULL) return NULL;
+    if (base_dir == NULL) {
+        own_dir = playlist_file_base_dir (filename);
+        if (own_dir == NULL) return NULL;
+        base_dir = own_dir;
     }
+    if (playlist_file_lines_open (&lines, filename) == FALSE) goto error;
 
-    if (util_chdir_filepath (filename) == FALSE) goto error;
-
-    while ((status = g_io_channel_read_line (channel, &line, &len, NULL, NULL)) == G_IO_STATUS_NORMAL) {
-        gboolean ignore = FALSE;
-        gchar *stripped = g_strstrip (line); /* strip does not make copy */
-        if (len > 0) {
-            if (stripped[0] == '#') ignore = TRUE; /* skip */
+    while (playlist_file_lines_next (&lines, &line, &len) == TRUE) {
+        gchar *path;
+        if (len == 0) continue;
+        if (line[0] == '#') {
+            if (len > strlen (EXTINF) && strncmp (line, EXTINF, strlen (EXTINF)) == 0) {
+                g_free (title);
+                title = _extinf_title (line, len);
+            }
+            continue; /* skip */
         }
-        if (ignore == FALSE && len > 0) {
-            lt = inspector_add_no_check (stripped);
-            l = g_list_concat (l, lt);
+        path = playlist_file_resolve (base_dir, line, len);
+        if (path != NULL) {
+            lt = inspector_add_no_check (path);
+            if (lt != NULL) {
+                Song *o = (Song *)lt->data;
+                if (o->type == SONG_TYPE_STREAM && title != NULL) song_set_stream_title (o, title);
+                l = g_list_concat (lt, l); /* lt has one song */
+            }
+            g_free (path);
         }
-        g_free (line);
-        line = NULL;
+        g_free (title);
+        title = NULL;
     }
+    playlist_file_lines_close (&lines);
 error:
-    (void)util_chdir (curdir);
-    g_free (curdir);
-    g_free (line);
-    if (channel) {
-        g_io_channel_unref (channel);
+    g_free (title);
+    g_free (own_dir);
+    return g_list_reverse (l);
+}
+
+gboolean playlist_m3u_save (GList *playlist, const gchar *filename)
+{
+    GList *p = playlist;
+    gchar *tmpname = NULL;
+    gchar *str;
+    FILE *f;
+    if (playlist == NULL || filename == NULL) return FALSE;
+
+    f = playlist_file_write_begin (filename, &tmpname);
+    if (f == NULL) return FALSE;
+
+    fputs ("#EXTM3U\n", f);
+    while (p != NULL) {
+        Song *o = p->data;
+        const gchar *title;
+        p = p->next;
+        if (o == NULL) continue;
+
+        if (o->type == SONG_TYPE_STREAM) str = g_strdup (o->uri);
+        else str = g_filename_from_uri (o->uri, NULL, NULL);
+        if (str == NULL) continue;
+
+        title = o->type == SONG_TYPE_STREAM ? o->stream_title : o->title;
+        if (title != NULL && strchr (title, '\n') == NULL) {
+            gint64 secs = o->duration > 0 ? o->duration / 1000 : -1;
+            if (o->type != SONG_TYPE_STREAM && o->artist != NULL && strchr (o->artist, '\n') == NULL) {
+                fprintf (f, EXTINF "%" G_GINT64_FORMAT ",%s - %s\n", secs, o->artist, title);
+            } else {
+                fprintf (f, EXTINF "%" G_GINT64_FORMAT ",%s\n", secs, title);
+            }
+        }
+        fprintf (f, "%s\n", str);
+        g_free (str);
     }
+    return playlist_file_write_end (f, tmpname, filename, TRUE);
+}
 
-    return l;
+/* #EXTINF:length,title */
+static gchar *_extinf_title (const gchar *line, gsize len)
+{
+    const gchar *comma = memchr (line, ',', len);
+    const gchar *end = line + len;
+    if (comma == NULL) return NULL;
+    comma++;
+    while (comma < end && g_ascii_isspace (*comma)) comma++;
+    if (comma >= end) return NULL;
+    return g_strndup (comma, end - comma);
 }
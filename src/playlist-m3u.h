@@ -22,6 +22,10 @@
 
 #include <glib.h>
 
-GList *playlist_m3u_load (const gchar *filename);
+/* Relative entries are relative to base_dir, NULL means playlist's own directory.
+ * Does not change working directory. */
+GList *playlist_m3u_load (const gchar *filename, const gchar *base_dir);
+/* Extended m3u with #EXTINF lines */
+gboolean playlist_m3u_save (GList *playlist, const gchar *filename);
 
 #endif
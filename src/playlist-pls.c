@@ -17,154 +17,273 @@
  * USA.
  */
 
+
+#include <string.h>
+
 #include "playlist-pls.h"
+#include "playlist-file.h"
 #include "util.h"
 #include "song.h"
 #include "inspector.h"
 
 #define MAX_KEY_SIZE 255
 
-static GList *_load_common (GKeyFile *kfile);
+typedef void (*PlsEntryFunc) (const gchar *file, const gchar *title, gpointer user_data);
+
+typedef struct {
+    guint index; /* 0 none */
+    gchar *file;
+    gchar *title;
+} PlsEntry;
+
+typedef struct {
+    const gchar *base_dir;
+    gboolean streams_only;
+    GList *l; /* reversed */
+} PlsLoadData;
 
-GList *playlist_pls_load (const gchar *filename)
+static gboolean _parse (PlaylistFileLines *lines, PlsEntryFunc func, gpointer user_data);
+static void _flush_entry (PlsEntry *e, PlsEntryFunc func, gpointer user_data);
+static gchar *_unescape (const gchar *value, gsize len);
+static void _write_escaped (FILE *f, const gchar *value);
+static gboolean _key_index (const gchar *key, gsize key_len, const gchar *name, guint *index);
+static void _add_entry (const gchar *file, const gchar *title, gpointer user_data);
+
+GList *playlist_pls_load (const gchar *filename, const gchar *base_dir)
 {
-    gint ret = 0;
-    GList *l = NULL;
-    GKeyFile *kfile = NULL;
-    gboolean success;
-    gchar *curdir = g_get_current_dir ();
-    gchar *str = NULL;
-    if (curdir == NULL) return NULL;
-
-    kfile = g_key_file_new ();
-    if (kfile == NULL) goto error;
-
-    ret = util_file_load_to_str (filename, &str);
-    if (ret != 0) goto error;
- 
-    success = g_key_file_load_from_data (kfile, str, -1, G_KEY_FILE_NONE, NULL);
-    if (success == FALSE) goto error;
-
-    if (util_chdir_filepath (filename) == FALSE) goto error;
-
-    l = _load_common (kfile);
-error:
-    g_free (str);
-    util_chdir (curdir);
-    g_free (curdir);
-    g_key_file_free (kfile);
-    return l;
+    PlaylistFileLines lines;
+    PlsLoadData data = {0,};
+    gchar *own_dir = NULL;
+
+    if (filename == NULL) return NULL;
+    if (base_dir == NULL) {
+        own_dir = playlist_file_base_dir (filename);
+        if (own_dir == NULL) return NULL;
+        base_dir = own_dir;
+    }
+    if (playlist_file_lines_open (&lines, filename) == FALSE) goto load_error;
+
+    data.base_dir = base_dir;
+    (void)_parse (&lines, _add_entry, &data);
+    playlist_file_lines_close (&lines);
+load_error:
+    g_free (own_dir);
+    return g_list_reverse (data.l);
 }
 
 gboolean playlist_pls_save (GList *playlist, const gchar *filename)
 {
-    gboolean ret = TRUE;
-    GKeyFile *kfile = NULL;
     GList *p = playlist;
-    gchar key[MAX_KEY_SIZE];
+    gchar *tmpname = NULL;
     gchar *str;
     gsize file_num = 1;
-    if (playlist == NULL || filename == NULL) return FALSE;
+    FILE *f;
+    if (filename == NULL) return FALSE; /* empty playlist is written too */
 
-    kfile = g_key_file_new ();
-    if (kfile == NULL) return FALSE;
+    f = playlist_file_write_begin (filename, &tmpname);
+    if (f == NULL) return FALSE;
 
+    fputs ("[playlist]\n", f);
     while (p != NULL) {
         Song *o = p->data;
-        if (o == NULL) break;
+        p = p->next;
+        if (o == NULL) continue;
 
         if (o->type == SONG_TYPE_STREAM) str = g_strdup (o->uri);
         else str = g_filename_from_uri (o->uri, NULL, NULL);
-        if (str == NULL) break;
+        if (str == NULL) continue;
 
-        g_snprintf (key, 254, "File%zu", file_num);
-        g_key_file_set_string (kfile, "playlist", key, str);
+        fprintf (f, "File%zu=", file_num);
+        _write_escaped (f, str);
         g_free (str);
         if (o->type == SONG_TYPE_STREAM && o->stream_title != NULL) {
-            g_snprintf (key, 254, "Title%zu", file_num);
-            g_key_file_set_string (kfile, "playlist", key, o->stream_title);
+            fprintf (f, "Title%zu=", file_num);
+            _write_escaped (f, o->stream_title);
         }
-        p = p->next;
         file_num++;
     }
-
-    if (file_num > 1) {
-        gsize len = 0;
-        gchar *content = g_key_file_to_data (kfile, &len, NULL);
-        if (len > 0) {
-            gint retval = util_file_write_data (filename, content, len);
-            if (retval != 0) ret = FALSE;
-        }
-    }
-    g_key_file_free (kfile);
-    return ret;
+    fprintf (f, "NumberOfEntries=%zu\nVersion=2\n", file_num - 1);
+    return playlist_file_write_end (f, tmpname, filename, TRUE);
 }
 
 GList *playlist_pls_parse_raw (const gchar *content)
 {
-    GList *l = NULL;
-    GList *p = NULL;
-    GKeyFile *kfile = NULL;
-    gboolean success;
-
-    kfile = g_key_file_new ();
-    if (kfile == NULL) goto error;
-
-    success = g_key_file_load_from_data (kfile, content, strlen (content), G_KEY_FILE_NONE, NULL);
-    if (success == FALSE) goto error;
-
-    p = l = _load_common (kfile);
-    if (p != NULL) {
-        while (p != NULL) {
-            Song *o = (Song *)p->data;
-            if (inspector_try_uri (o->uri, o) == FALSE) {
-                /* remove unsupported */
-                GList *next = p->next;
-                song_delete (o);
-                l = g_list_remove (l, p);
-                p = next;
-            } else {
-                p = p->next;
-            }
+    PlaylistFileLines lines;
+    PlsLoadData data = {0,};
+    GList *l, *p;
+
+    if (content == NULL) return NULL;
+    playlist_file_lines_init (&lines, content, strlen (content));
+    (void)_parse (&lines, _add_entry, &data); /* no base dir for remote playlist */
+
+    p = l = g_list_reverse (data.l);
+    while (p != NULL) {
+        Song *o = (Song *)p->data;
+        if (inspector_try_uri (o->uri, o) == FALSE) {
+            /* remove unsupported */
+            GList *next = p->next;
+            song_delete (o);
+            l = g_list_delete_link (l, p);
+            p = next;
+        } else {
+            p = p->next;
         }
     }
-error:
-    g_key_file_free (kfile);
     return l;
 }
 
-static GList *_load_common (GKeyFile *kfile)
+GList *playlist_pls_parse_raw_streams (const gchar *content)
+{
+    PlaylistFileLines lines;
+    PlsLoadData data = {0,};
+
+    if (content == NULL) return NULL;
+    data.streams_only = TRUE;
+    playlist_file_lines_init (&lines, content, strlen (content));
+    (void)_parse (&lines, _add_entry, &data);
+    return g_list_reverse (data.l);
+}
+
+static void _add_entry (const gchar *file, const gchar *title, gpointer user_data)
 {
-    GList *l = NULL;
+    PlsLoadData *data = (PlsLoadData *)user_data;
     GList *lt;
-    gsize len = 0;
-    gsize i;
-    gchar key[MAX_KEY_SIZE];
-    gchar *val = NULL;
     Song *o;
-    gchar **keys = NULL;
-
-    keys = g_key_file_get_keys (kfile, "playlist", &len, NULL);
-    if (len < 1) goto common_error;
-    for (i = 0; i < len; i++) {
-        g_snprintf (key, MAX_KEY_SIZE-1, "File%zu", i + 1); /* C99 */
-        val = g_key_file_get_string (kfile, "playlist", key, NULL);
-        if (val == NULL) break;
-        lt = inspector_add_no_check (val);
-        g_free (val);
-        if (lt != NULL) {
-            o = (Song *)lt->data;
-            if (o->type == SONG_TYPE_STREAM) {
-                g_snprintf (key, MAX_KEY_SIZE-1, "Title%zu", i + 1);
-                val = g_key_file_get_string (kfile, "playlist", key, NULL);
-                if (val != NULL) song_set_stream_title (o, val);
-                g_free (val);
+
+    if (data->streams_only == TRUE) {
+        if (inspector_is_stream (file) == FALSE) return; /* local files are not checked here */
+        o = song_new (file);
+        if (o == NULL) return;
+        song_set_type (o, SONG_TYPE_STREAM);
+        if (title != NULL) song_set_stream_title (o, title);
+        data->l = g_list_prepend (data->l, o);
+        return;
+    }
+
+    gchar *path = playlist_file_resolve (data->base_dir, file, strlen (file));
+    if (path == NULL) return;
+    lt = inspector_add_no_check (path);
+    g_free (path);
+    if (lt == NULL) return;
+    o = (Song *)lt->data;
+    if (o->type == SONG_TYPE_STREAM && title != NULL) song_set_stream_title (o, title);
+    data->l = g_list_concat (lt, data->l); /* lt has one song */
+}
+
+/* Calls func for every FileN of [playlist] group, in file order. TitleN is
+ * matched when it comes right before or after its FileN, like all writers put it.
+ * Returns FALSE if content is not pls. */
+static gboolean _parse (PlaylistFileLines *lines, PlsEntryFunc func, gpointer user_data)
+{
+    PlsEntry e = {0,};
+    gboolean is_pls = FALSE;
+    gboolean in_group = FALSE;
+    const gchar *line;
+    gsize len;
+
+    while (playlist_file_lines_next (lines, &line, &len) == TRUE) {
+        const gchar *eq;
+        gsize key_len;
+        guint index;
+
+        if (len == 0 || line[0] == '#' || line[0] == ';') continue;
+        if (line[0] == '[') {
+            _flush_entry (&e, func, user_data);
+            in_group = (len == 10 && g_ascii_strncasecmp (line, "[playlist]", 10) == 0);
+            if (in_group == TRUE) is_pls = TRUE;
+            continue;
+        }
+        if (is_pls == FALSE) return FALSE; /* something before group, not pls */
+        if (in_group == FALSE) continue;
+
+        eq = memchr (line, '=', len);
+        if (eq == NULL) continue;
+        key_len = eq - line;
+        while (key_len > 0 && g_ascii_isspace (line[key_len - 1])) key_len--;
+        eq++;
+        while (eq < line + len && g_ascii_isspace (*eq)) eq++;
+
+        if (_key_index (line, key_len, "File", &index) == TRUE) {
+            /* keeps a title which came before its file */
+            if (e.index != index || e.file != NULL) _flush_entry (&e, func, user_data);
+            e.index = index;
+            e.file = _unescape (eq, line + len - eq);
+        } else if (_key_index (line, key_len, "Title", &index) == TRUE) {
+            if (e.index != index) _flush_entry (&e, func, user_data);
+            e.index = index;
+            g_free (e.title);
+            e.title = _unescape (eq, line + len - eq);
+        }
+    }
+    _flush_entry (&e, func, user_data);
+    return is_pls;
+}
+
+static void _flush_entry (PlsEntry *e, PlsEntryFunc func, gpointer user_data)
+{
+    if (e->file != NULL && e->file[0] != '\0') func (e->file, e->title, user_data);
+    g_free (e->file);
+    g_free (e->title);
+    e->file = NULL;
+    e->title = NULL;
+    e->index = 0;
+}
+
+/* name followed by positive number, case does not matter */
+static gboolean _key_index (const gchar *key, gsize key_len, const gchar *name, guint *index)
+{
+    gsize name_len = strlen (name);
+    guint64 n = 0;
+    if (key_len <= name_len || key_len - name_len > 9) return FALSE;
+    if (g_ascii_strncasecmp (key, name, name_len) != 0) return FALSE;
+    for (gsize i = name_len; i < key_len; i++) {
+        if (g_ascii_isdigit (key[i]) == FALSE) return FALSE;
+        n = n * 10 + (key[i] - '0');
+    }
+    if (n == 0) return FALSE;
+    *index = (guint)n;
+    return TRUE;
+}
+
+/* GKeyFile escapes, so older saved playlists still load */
+static gchar *_unescape (const gchar *value, gsize len)
+{
+    gchar *str = g_malloc (len + 1);
+    gchar *o = str;
+    if (str == NULL) return NULL;
+    for (gsize i = 0; i < len; i++) {
+        if (value[i] == '\\' && i + 1 < len) {
+            i++;
+            switch (value[i]) {
+                case 's': *o++ = ' '; break;
+                case 'n': *o++ = '\n'; break;
+                case 't': *o++ = '\t'; break;
+                case 'r': *o++ = '\r'; break;
+                case '\\': *o++ = '\\'; break;
+                default: *o++ = '\\'; *o++ = value[i]; break;
             }
-            l = g_list_concat (l, lt);
+        } else {
+            *o++ = value[i];
         }
     }
-    g_strfreev (keys);
-common_error:
-    return l;
+    *o = '\0';
+    return str;
 }
 
+static void _write_escaped (FILE *f, const gchar *value)
+{
+    for (const gchar *p = value; *p != '\0'; p++) {
+        switch (*p) {
+            case ' ':
+                if (p == value) fputs ("\\s", f); /* leading space would be stripped */
+                else fputc (' ', f);
+                break;
+            case '\n': fputs ("\\n", f); break;
+            case '\t': fputs ("\\t", f); break;
+            case '\r': fputs ("\\r", f); break;
+            case '\\': fputs ("\\\\", f); break;
+            default: fputc (*p, f); break;
+        }
+    }
+    fputc ('\n', f);
+}
@@ -22,8 +22,12 @@
 
 #include <glib.h>
 
-GList *playlist_pls_load (const gchar *filename);
+/* Relative entries are relative to base_dir, NULL means playlist's own directory.
+ * Does not change working directory. */
+GList *playlist_pls_load (const gchar *filename, const gchar *base_dir);
 gboolean playlist_pls_save (GList *playlist, const gchar *filename);
 GList *playlist_pls_parse_raw (const gchar *content);
+/* Only stream entries, not checked. Does not use inspector pipeline, so can be called from any thread. */
+GList *playlist_pls_parse_raw_streams (const gchar *content);
 
 #endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <string.h>
+
+#include "playlist-snapshot.h"
+#include "playlist-file.h"
+#include "song.h"
+#include "util.h"
+#include "log.h"
+
+#define SNAPSHOT_MAGIC "KKPS"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_NULL_STR G_MAXUINT32
+
+typedef struct {
+    gchar magic[4];
+    guint32 version;
+    guint32 mode;
+    guint32 loop;
+    gint32 current;
+    guint32 volume;
+    gint64 saved;
+    guint64 generation;
+    guint32 num_songs;
+    guint32 num_shuffle;
+} SnapshotHeader;
+
+typedef struct {
+    guint32 type;
+    guint32 year;
+    guint32 track;
+    gint32 tunes;
+    gint64 duration;
+} SongRecord; /* followed by tune durations and strings */
+
+typedef struct {
+    const guchar *pos;
+    const guchar *end;
+} Reader;
+
+static void _append_str (GByteArray *buf, const gchar *str);
+static gboolean _read (Reader *r, void *buf, gsize len);
+static gboolean _read_str (Reader *r, gchar **str);
+
+void playlist_snapshot_init (PlaylistSnapshot *ps)
+{
+    memset (ps, 0, sizeof (PlaylistSnapshot));
+    ps->songs = g_ptr_array_new_with_free_func ((GDestroyNotify)song_delete);
+    ps->current = -1;
+    ps->volume = 100;
+}
+
+void playlist_snapshot_clear (PlaylistSnapshot *ps)
+{
+    if (ps->songs != NULL) g_ptr_array_free (ps->songs, TRUE);
+    if (ps->shuffle != NULL) g_array_free (ps->shuffle, TRUE);
+    ps->songs = NULL;
+    ps->shuffle = NULL;
+}
+
+gboolean playlist_snapshot_write (const gchar *filename, const PlaylistSnapshot *ps)
+{
+    SnapshotHeader h = {0,};
+    GByteArray *buf;
+    gchar *tmpname = NULL;
+    FILE *f;
+
+    if (filename == NULL || ps == NULL || ps->songs == NULL) return FALSE;
+    f = playlist_file_write_begin (filename, &tmpname);
+    if (f == NULL) return FALSE;
+
+    memcpy (h.magic, SNAPSHOT_MAGIC, 4);
+    h.version = SNAPSHOT_VERSION;
+    h.mode = ps->mode;
+    h.loop = ps->loop;
+    h.current = ps->current;
+    h.volume = ps->volume;
+    h.saved = ps->saved;
+    h.generation = ps->generation;
+    h.num_songs = ps->songs->len;
+    h.num_shuffle = ps->shuffle != NULL ? ps->shuffle->len : 0;
+    fwrite (&h, sizeof (h), 1, f);
+
+    buf = g_byte_array_new ();
+    for (guint i = 0; i < ps->songs->len; i++) {
+        g_byte_array_set_size (buf, 0);
+        playlist_snapshot_append_song (buf, g_ptr_array_index (ps->songs, i));
+        fwrite (buf->data, 1, buf->len, f);
+    }
+    g_byte_array_free (buf, TRUE);
+    if (h.num_shuffle > 0) fwrite (ps->shuffle->data, sizeof (guint32), h.num_shuffle, f);
+    fwrite (SNAPSHOT_MAGIC, 4, 1, f); /* end marker, catches truncated files */
+
+    return playlist_file_write_end (f, tmpname, filename, TRUE);
+}
+
+gboolean playlist_snapshot_read (const gchar *filename, PlaylistSnapshot *ps)
+{
+    GMappedFile *map;
+    SnapshotHeader h;
+    Reader r;
+    gchar end[4];
+    gboolean ok = FALSE;
+
+    if (filename == NULL || ps == NULL || ps->songs == NULL) return FALSE;
+    if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) == FALSE) return FALSE;
+    map = g_mapped_file_new (filename, FALSE, NULL);
+    if (map == NULL) return FALSE;
+    r.pos = (const guchar *)g_mapped_file_get_contents (map);
+    r.end = r.pos + g_mapped_file_get_length (map);
+
+    if (_read (&r, &h, sizeof (h)) == FALSE) goto read_error;
+    if (memcmp (h.magic, SNAPSHOT_MAGIC, 4) != 0 || h.version != SNAPSHOT_VERSION) {
+        LOG_DEBUG("Playlist snapshot %s has unknown version.", filename);
+        goto read_error;
+    }
+    /* every song takes at least record and uri */
+    if (h.num_songs > (gsize)(r.end - r.pos) / sizeof (SongRecord)) goto read_error;
+
+    g_ptr_array_set_size (ps->songs, 0);
+    for (guint32 i = 0; i < h.num_songs; i++) {
+        Song *s = playlist_snapshot_parse_song (&r.pos, r.end);
+        if (s == NULL) goto read_error;
+        g_ptr_array_add (ps->songs, s);
+    }
+    if (h.num_shuffle > 0) {
+        if (h.num_shuffle != h.num_songs) goto read_error;
+        ps->shuffle = g_array_sized_new (FALSE, FALSE, sizeof (guint32), h.num_shuffle);
+        g_array_set_size (ps->shuffle, h.num_shuffle);
+        if (_read (&r, ps->shuffle->data, sizeof (guint32) * h.num_shuffle) == FALSE) goto read_error;
+        for (guint32 i = 0; i < h.num_shuffle; i++) {
+            if (g_array_index (ps->shuffle, guint32, i) >= h.num_songs) goto read_error;
+        }
+    }
+    if (_read (&r, end, 4) == FALSE || memcmp (end, SNAPSHOT_MAGIC, 4) != 0) goto read_error;
+
+    ps->mode = h.mode;
+    ps->loop = h.loop != 0;
+    ps->current = h.current < (gint32)h.num_songs ? h.current : -1;
+    ps->volume = MIN (h.volume, 100);
+    ps->saved = h.saved;
+    ps->generation = h.generation;
+    ok = TRUE;
+read_error:
+    if (ok == FALSE) {
+        LOG_ERROR("Failed to read playlist snapshot %s.", filename);
+        g_ptr_array_set_size (ps->songs, 0);
+        if (ps->shuffle != NULL) g_array_free (ps->shuffle, TRUE);
+        ps->shuffle = NULL;
+    }
+    g_mapped_file_unref (map);
+    return ok;
+}
+
+void playlist_snapshot_append_song (GByteArray *buf, const Song *s)
+{
+    SongRecord rec;
+    gint32 tunes = CLAMP (s->tunes, 0, SONG_MAX_TUNES);
+
+    memset (&rec, 0, sizeof (rec)); /* no garbage from padding */
+    rec.type = s->type;
+    rec.year = s->year;
+    rec.track = s->track;
+    rec.tunes = tunes;
+    rec.duration = s->duration;
+    g_byte_array_append (buf, (const guint8 *)&rec, sizeof (rec));
+    if (tunes > 0) g_byte_array_append (buf, (const guint8 *)s->tune_duration, sizeof (gint64) * tunes);
+    _append_str (buf, s->uri);
+    _append_str (buf, s->artist);
+    _append_str (buf, s->album);
+    _append_str (buf, s->title);
+    _append_str (buf, s->stream_title);
+    _append_str (buf, s->codec);
+    _append_str (buf, s->copyright);
+}
+
+Song *playlist_snapshot_parse_song (const guchar **pos, const guchar *end)
+{
+    Reader r = {*pos, end};
+    SongRecord rec;
+    const guchar *tunes;
+    gchar *uri = NULL;
+    gchar *str[6] = {NULL,};
+    Song *s = NULL;
+
+    if (_read (&r, &rec, sizeof (rec)) == FALSE) return NULL;
+    if (rec.tunes < 0 || rec.tunes > SONG_MAX_TUNES) return NULL;
+    if ((gsize)(r.end - r.pos) < rec.tunes * sizeof (gint64)) return NULL;
+    tunes = r.pos;
+    r.pos += rec.tunes * sizeof (gint64);
+
+    if (_read_str (&r, &uri) == FALSE || uri == NULL) goto song_error;
+    for (gint i = 0; i < 6; i++) {
+        if (_read_str (&r, &str[i]) == FALSE) goto song_error;
+    }
+    s = song_new (uri);
+    if (s == NULL) goto song_error;
+    (void)song_set_type (s, rec.type);
+    (void)song_set_year (s, rec.year);
+    (void)song_set_track (s, rec.track);
+    (void)song_set_duration (s, rec.duration);
+    s->tunes = rec.tunes;
+    memcpy (s->tune_duration, tunes, rec.tunes * sizeof (gint64));
+    /* setters make own copies */
+    (void)song_set_artist (s, str[0]);
+    (void)song_set_album (s, str[1]);
+    (void)song_set_title (s, str[2]);
+    (void)song_set_stream_title (s, str[3]);
+    (void)song_set_codec (s, str[4]);
+    (void)song_set_copyright (s, str[5]);
+    *pos = r.pos;
+song_error:
+    g_free (uri);
+    for (gint i = 0; i < 6; i++) g_free (str[i]);
+    return s;
+}
+
+static void _append_str (GByteArray *buf, const gchar *str)
+{
+    guint32 len = str != NULL ? (guint32)strlen (str) : SNAPSHOT_NULL_STR;
+    g_byte_array_append (buf, (const guint8 *)&len, sizeof (len));
+    if (str != NULL && len > 0) g_byte_array_append (buf, (const guint8 *)str, len);
+}
+
+static gboolean _read (Reader *r, void *buf, gsize len)
+{
+    if ((gsize)(r->end - r->pos) < len) return FALSE;
+    memcpy (buf, r->pos, len);
+    r->pos += len;
+    return TRUE;
+}
+
+static gboolean _read_str (Reader *r, gchar **str)
+{
+    guint32 len;
+    *str = NULL;
+    if (_read (r, &len, sizeof (len)) == FALSE) return FALSE;
+    if (len == SNAPSHOT_NULL_STR) return TRUE;
+    if ((gsize)(r->end - r->pos) < len) return FALSE;
+    *str = g_strndup ((const gchar *)r->pos, len);
+    r->pos += len;
+    return *str != NULL;
+}
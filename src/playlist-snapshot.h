@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_PLAYLIST_SNAPSHOT_H_
+#define _KK_PLAYLIST_SNAPSHOT_H_
+
+#include <glib.h>
+
+#include "song.h"
+
+/*
+ * Binary snapshot of whole playlist state. Songs are restored with their
+ * tags and durations, so nothing needs to be inspected at startup.
+ * File format is versioned and native endian; a snapshot which does not
+ * match is just not read.
+ */
+
+typedef struct {
+    GPtrArray *songs; /* Song, owned */
+    GArray *shuffle; /* guint32 indexes to songs, NULL if not in suffle mode */
+    guint mode; /* PlaylistMode */
+    gboolean loop;
+    gint current; /* index to current list, -1 for none */
+    guint8 volume;
+    gint64 saved; /* real time in seconds when written */
+    guint64 generation; /* journal written after snapshot refers to this */
+} PlaylistSnapshot;
+
+void playlist_snapshot_init (PlaylistSnapshot *ps);
+void playlist_snapshot_clear (PlaylistSnapshot *ps);
+
+gboolean playlist_snapshot_write (const gchar *filename, const PlaylistSnapshot *ps);
+gboolean playlist_snapshot_read (const gchar *filename, PlaylistSnapshot *ps);
+
+/* Song record of snapshot format, also used by journal */
+void playlist_snapshot_append_song (GByteArray *buf, const Song *s);
+/* Reads record at *pos and moves *pos after it. NULL if record is not valid */
+Song *playlist_snapshot_parse_song (const guchar **pos, const guchar *end);
+
+#endif
@@ -21,16 +21,23 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include <libintl.h>
+#include <glib/gstdio.h>
 #define _(String) gettext (String)
 
 #include "playlist.h"
 #include "playlist-pls.h"
 #include "playlist-m3u.h"
+#include "playlist-snapshot.h"
+#include "playlist-journal.h"
 #include "util.h"
 #include "inspector.h"
+#include "negative-cache.h"
 #include "playlist-line.h"
 #include "ncurses-common.h"
+#include "log.h"
 
 static GList **_list = NULL;
 static GList *_playlist = NULL;
@@ -41,6 +48,8 @@ static gboolean _loop = FALSE;
 static gint _search_index = -1;
 static GList *_pastelist = NULL;
 static gboolean _with_tags = FALSE;
+static gint _random_ahead[PLAYLIST_PEEK_MAX]; /* drawn by peek, used by next in order */
+static gint _random_ahead_len = 0;
 
 #define ABSOLUTELY_MAX_STR_LEN 4096
 
@@ -53,7 +62,33 @@ static gint _search_from_index (gint start_index, gboolean backwards);
 static gboolean _search_test_line (const gchar *line);
 static gboolean _search_is_match (Song *o);
 static gboolean _add_list (GList *l);
+static void _add_found_song (Song *s, gpointer user_data);
 static gboolean _add_playlist_file (const char *filepath);
+static gboolean _has_playlist_suffix (const char *filepath);
+static gint _list_index (GList *list, GList *link);
+static GArray *_suffle_permutation (void);
+static void _journal_files_free (void);
+static gpointer _revalidate_thread (gpointer data);
+static gboolean _revalidate_done (gpointer data);
+static void _remove_songs_by_uri (GList **list, GHashTable *uris);
+static void _update_songs_by_uri (GList *list, GHashTable *songs);
+
+typedef struct {
+    GPtrArray *uris; /* local songs from snapshot */
+    gint64 saved;
+    GHashTable *missing; /* uri set */
+    GHashTable *changed; /* uri set */
+} RevalidateData;
+
+static GThread *_revalidate = NULL;
+static gint _revalidate_cancel = FALSE; /* atomic */
+
+/* what playlist_load_snapshot found */
+static guint64 _journal_generation = 0;
+static gboolean _journal_empty_base = FALSE;
+static goffset _journal_continue_at = 0;
+static gboolean _journal_have_base = FALSE; /* playlist came from snapshot */
+static gchar *_journal_files[3] = { NULL, NULL, NULL }; /* journal, snapshot, pls */
 
 static gint _length = 0;
 static gboolean _search_use_case_sensitive = FALSE;
@@ -93,18 +128,35 @@ static void _sufflelist_free (void)
 
 void playlist_free (void)
 {
+    if (_revalidate != NULL) {
+        g_atomic_int_set (&_revalidate_cancel, TRUE);
+        g_thread_join (_revalidate); /* result idle never runs, main loop has quit */
+        _revalidate = NULL;
+    }
     _pastelist_free ();
     _sufflelist_free ();
     if (_playlist != NULL) {
         g_list_foreach (_playlist, _free_song_list_items, NULL);
         g_list_free (_playlist);
+        _playlist = NULL;
     }
     search_free (&_search);
+    /* can be initialized again */
+    _list = &_playlist;
+    _current = NULL;
+    _mode = PLAYLIST_MODE_STANDARD;
+    _length = 0;
+    _search_index = -1;
+    _random_ahead_len = 0;
 }
 
 gboolean playlist_add (gchar *path)
 {
     if (path == NULL) return FALSE;
+    if (inspector_is_remote_playlist (path) == TRUE) {
+        /* songs are added when found */
+        return inspector_run_remote_playlist (path, _add_found_song, NULL);
+    }
     GList *l = inspector_run (path);
     gboolean ret = TRUE;
     if (l != NULL) {
@@ -134,6 +186,7 @@ gboolean playlist_mode_set (PlaylistMode mode)
     }
     _length = g_list_length (*_list);
     _current = *_list;
+    _random_ahead_len = 0;
     return TRUE;
 }
 
@@ -179,11 +232,14 @@ gboolean playlist_loop_toggle (void)
 Song *playlist_remove_list (GSList *remove_list)
 {
     GList *current = _current;
+    GArray *removed = g_array_new (FALSE, FALSE, sizeof (gint32));
 
     for (GSList *l0 = remove_list; l0 != NULL; l0 = l0->next) {
         GList *l = g_list_find (*_list, l0->data);
         if (l != NULL) {
             Song *s = (Song *)l->data;
+            gint32 index = g_list_position (*_list, l);
+            g_array_append_val (removed, index);
             if (current != NULL && s == (Song *)current->data) { /* change _current song if removed */
                 GList *new_cur = current->next;
                 if (new_cur == NULL) {
@@ -196,6 +252,9 @@ Song *playlist_remove_list (GSList *remove_list)
         }
     }
 
+    if (_list == &_playlist) playlist_journal_remove (removed);
+    g_array_free (removed, TRUE);
+
     _current = current;
     _length = g_list_length (*_list);
     if (_current == NULL) return NULL;
@@ -220,19 +279,59 @@ Song *playlist_get_next_song (void)
 {
     GList *list = _mode==PLAYLIST_MODE_SUFFLE ? _sufflelist : _playlist;
     if (_current == NULL) return NULL;
-    if (_mode == PLAYLIST_MODE_STANDARD || PLAYLIST_MODE_SUFFLE) {
+    if (_mode == PLAYLIST_MODE_STANDARD || _mode == PLAYLIST_MODE_SUFFLE) {
         _current = _current->next;
         if (_loop == TRUE && _current == NULL) {
             _current = list;
         }
         if (_current == NULL) return NULL;
     } else if (_mode == PLAYLIST_MODE_RANDOM) {
-        gint index = _playlist_random ();
+        gint index;
+        if (_random_ahead_len > 0 && _random_ahead[0] < _length) {
+            index = _random_ahead[0];
+            _random_ahead_len--;
+            memmove (_random_ahead, _random_ahead + 1, _random_ahead_len * sizeof (gint));
+        } else {
+            index = _playlist_random ();
+            _random_ahead_len = 0;
+        }
         return  playlist_get_nth_song (index);
     }
     return (Song *)_current->data;
 }
 
+Song *playlist_peek_next_song (void)
+{
+    Song *s = NULL;
+    (void)playlist_peek_next_songs (&s, 1);
+    return s;
+}
+
+gint playlist_peek_next_songs (Song **songs, gint n)
+{
+    GList *next;
+    gint i;
+    if (_current == NULL || _length == 0 || songs == NULL) return 0;
+    if (n > PLAYLIST_PEEK_MAX) n = PLAYLIST_PEEK_MAX;
+
+    if (_mode == PLAYLIST_MODE_RANDOM) {
+        for (i = 0; i < _random_ahead_len; i++) {
+            if (_random_ahead[i] >= _length) _random_ahead_len = 0; /* list got shorter */
+        }
+        while (_random_ahead_len < n) _random_ahead[_random_ahead_len++] = _playlist_random ();
+        for (i = 0; i < n; i++) songs[i] = playlist_get_nth_song_no_set (_random_ahead[i]);
+        return n;
+    }
+    next = _current;
+    for (i = 0; i < n; i++) {
+        next = next->next;
+        if (_loop == TRUE && next == NULL) next = *_list;
+        if (next == NULL || next == _current) break;
+        songs[i] = (Song *)next->data;
+    }
+    return i;
+}
+
 Song *playlist_get_nth_song_no_set (gint index)
 {
     if (*_list == NULL) return NULL;
@@ -420,7 +519,8 @@ gboolean playlist_copy_range (gint first_index, gint second_index)
 
 gboolean playlist_cut_range (gint first_index, gint second_index)
 {
-    gint i;
+    gint32 i;
+    GArray *removed;
     gint min = MIN (first_index, second_index);
     gint max = (min==first_index)?second_index:first_index;
     gint last_index = playlist_length () - 1;
@@ -429,6 +529,7 @@ gboolean playlist_cut_range (gint first_index, gint second_index)
     if (max > last_index) max = last_index;
     if (min < 0) min = 0;
     _pastelist_free ();
+    removed = g_array_new (FALSE, FALSE, sizeof (gint32));
 
     for (i = max; i > min - 1; i--) {
         GList *l = g_list_nth (*_list, i);
@@ -437,7 +538,10 @@ gboolean playlist_cut_range (gint first_index, gint second_index)
         if (s == NULL) continue;
         *_list = g_list_remove_link (*_list, l);
         _pastelist = g_list_prepend (_pastelist, s);
+        g_array_append_val (removed, i);
     }
+    if (_list == &_playlist) playlist_journal_remove (removed);
+    g_array_free (removed, TRUE);
     _length = g_list_length (*_list);
     return TRUE;
 }
@@ -464,11 +568,13 @@ gboolean playlist_copy_selected ()
 
 gboolean playlist_cut_selected ()
 {
-    gint i;
+    gint32 i;
     gint max = playlist_length () - 1;
+    GArray *removed;
 
     if (max < 0) return FALSE;
     _pastelist_free ();
+    removed = g_array_new (FALSE, FALSE, sizeof (gint32));
 
     for (i = max; i > -1; i--) {
         GList *l = g_list_nth (*_list, i);
@@ -478,8 +584,11 @@ gboolean playlist_cut_selected ()
         if (s->selected == TRUE) {
             *_list = g_list_remove_link (*_list, l);
             _pastelist = g_list_prepend (_pastelist, s);
+            g_array_append_val (removed, i);
         }
     }
+    if (_list == &_playlist) playlist_journal_remove (removed);
+    g_array_free (removed, TRUE);
     _length = g_list_length (*_list);
     return TRUE;
 }
@@ -491,6 +600,15 @@ gboolean playlist_paste_to (gint index)
     if (_pastelist == NULL) return FALSE;
     last_index = g_list_length (_pastelist) - 1;
 
+    if (_list == &_playlist) {
+        if (index < 0 || index > _length) { /* each one appended, so in reverse order */
+            GList *reversed = g_list_reverse (g_list_copy (_pastelist));
+            playlist_journal_insert (-1, reversed);
+            g_list_free (reversed);
+        } else {
+            playlist_journal_insert (index, _pastelist);
+        }
+    }
     for (i = last_index; i > -1; i--) {
         Song *s = (Song *)g_list_nth_data (_pastelist, i);
         if (s == NULL) continue;
@@ -510,6 +628,277 @@ gint playlist_num_to_paste (void)
     return g_list_length (_pastelist);
 }
 
+gboolean playlist_load_snapshot (const gchar *snapshot, const gchar *journal, guint8 *volume)
+{
+    PlaylistSnapshot ps;
+    RevalidateData *rd;
+    GList *l = NULL;
+    gboolean have_base;
+    gboolean have_journal;
+
+    playlist_snapshot_init (&ps);
+    have_base = playlist_snapshot_read (snapshot, &ps);
+    _journal_generation = ps.generation;
+    have_journal = playlist_journal_replay (journal, &ps, have_base, &_journal_empty_base, &_journal_continue_at);
+    if (have_journal == FALSE) {
+        _journal_continue_at = 0;
+        _journal_empty_base = FALSE;
+    } else {
+        _journal_generation = ps.generation;
+    }
+    if (have_base == FALSE && have_journal == FALSE) {
+        playlist_snapshot_clear (&ps);
+        return FALSE;
+    }
+    _journal_have_base = have_base;
+
+    rd = g_new0 (RevalidateData, 1);
+    rd->uris = g_ptr_array_new_with_free_func (g_free);
+    rd->saved = ps.saved;
+    for (gint i = ps.songs->len - 1; i > -1; i--) {
+        Song *s = g_ptr_array_index (ps.songs, i);
+        l = g_list_prepend (l, s);
+        if (s->type != SONG_TYPE_STREAM) g_ptr_array_add (rd->uris, g_strdup (s->uri));
+    }
+    g_ptr_array_set_free_func (ps.songs, NULL); /* songs are in list now */
+
+    if (_playlist != NULL) {
+        g_list_foreach (_playlist, _free_song_list_items, NULL);
+        g_list_free (_playlist);
+    }
+    _playlist = l;
+    _sufflelist_free ();
+    _loop = ps.loop;
+    _mode = ps.mode <= PLAYLIST_MODE_RANDOM ? ps.mode : PLAYLIST_MODE_STANDARD;
+    if (_mode == PLAYLIST_MODE_SUFFLE && ps.shuffle != NULL) {
+        for (gint i = ps.shuffle->len - 1; i > -1; i--) {
+            Song *s = g_ptr_array_index (ps.songs, g_array_index (ps.shuffle, guint32, i));
+            _sufflelist = g_list_prepend (_sufflelist, song_clone (s));
+        }
+        _list = &_sufflelist;
+        _length = g_list_length (*_list);
+        _current = ps.current >= 0 ? g_list_nth (*_list, ps.current) : *_list;
+    } else {
+        playlist_mode_set (_mode);
+        if (_mode != PLAYLIST_MODE_SUFFLE && ps.current >= 0) _current = g_list_nth (*_list, ps.current);
+    }
+    if (volume != NULL) *volume = ps.volume;
+    playlist_snapshot_clear (&ps);
+
+    /* stat in background, recheck changed ones in main loop */
+    g_atomic_int_set (&_revalidate_cancel, FALSE);
+    _revalidate = g_thread_try_new ("revalidate", _revalidate_thread, rd, NULL);
+    if (_revalidate == NULL) {
+        g_ptr_array_free (rd->uris, TRUE);
+        g_free (rd);
+    }
+    return TRUE;
+}
+
+gboolean playlist_start_journal (const gchar *journal, const gchar *snapshot, const gchar *pls)
+{
+    _journal_files_free ();
+    _journal_files[0] = g_strdup (journal);
+    _journal_files[1] = g_strdup (snapshot);
+    _journal_files[2] = g_strdup (pls);
+    if (_journal_continue_at > 0) {
+        return playlist_journal_open (journal, snapshot, pls, _journal_generation, _journal_empty_base, _journal_continue_at);
+    }
+    /* without snapshot playlist is built from scratch */
+    return playlist_journal_open (journal, snapshot, pls, _journal_generation, !_journal_have_base, 0);
+}
+
+void playlist_stop_journal (guint8 volume)
+{
+    GArray *shuffle = NULL;
+    gint current;
+
+    if (playlist_journal_is_open () == FALSE) {
+        _journal_files_free ();
+        return;
+    }
+    if (_mode == PLAYLIST_MODE_SUFFLE) {
+        shuffle = _suffle_permutation ();
+        current = shuffle != NULL ? _list_index (_sufflelist, _current) : -1;
+    } else {
+        current = _list_index (_playlist, _current);
+    }
+    playlist_journal_state (_mode, _loop, current, volume, shuffle);
+    if (shuffle != NULL) g_array_free (shuffle, TRUE);
+    if (playlist_journal_close () == FALSE) {
+        /* journal misses changes. pls has all, snapshot and journal must not be used over it */
+        if (_journal_files[2] != NULL && playlist_pls_save (_playlist, _journal_files[2]) == TRUE) {
+            (void)g_unlink (_journal_files[0]);
+            (void)g_unlink (_journal_files[1]);
+            LOG_ERROR("Playlist journal was incomplete, saved playlist to %s instead.", _journal_files[2]);
+        } else {
+            LOG_ERROR("Playlist journal was incomplete and playlist could not be saved.");
+        }
+    }
+    _journal_files_free ();
+}
+
+static void _journal_files_free (void)
+{
+    for (guint i = 0; i < G_N_ELEMENTS (_journal_files); i++) {
+        g_free (_journal_files[i]);
+        _journal_files[i] = NULL;
+    }
+}
+
+static gint _list_index (GList *list, GList *link)
+{
+    if (link == NULL) return -1;
+    return g_list_position (list, link);
+}
+
+/* indexes of suffle list songs in playlist. Suffle list has copies */
+static GArray *_suffle_permutation (void)
+{
+    GHashTable *positions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_queue_free);
+    GArray *perm = g_array_sized_new (FALSE, FALSE, sizeof (guint32), _length);
+    guint32 i = 0;
+
+    for (GList *l = _playlist; l != NULL; l = l->next, i++) {
+        Song *s = (Song *)l->data;
+        GQueue *q = g_hash_table_lookup (positions, s->uri);
+        if (q == NULL) {
+            q = g_queue_new ();
+            g_hash_table_insert (positions, s->uri, q);
+        }
+        g_queue_push_tail (q, GUINT_TO_POINTER (i));
+    }
+    for (GList *l = _sufflelist; l != NULL; l = l->next) {
+        Song *s = (Song *)l->data;
+        GQueue *q = g_hash_table_lookup (positions, s->uri);
+        if (q == NULL || g_queue_is_empty (q)) { /* lists differ, suffle again at load */
+            g_array_free (perm, TRUE);
+            perm = NULL;
+            break;
+        }
+        guint32 index = GPOINTER_TO_UINT (g_queue_pop_head (q));
+        g_array_append_val (perm, index);
+    }
+    if (perm != NULL && perm->len != i) {
+        g_array_free (perm, TRUE);
+        perm = NULL;
+    }
+    g_hash_table_destroy (positions);
+    return perm;
+}
+
+static gpointer _revalidate_thread (gpointer data)
+{
+    RevalidateData *rd = (RevalidateData *)data;
+    rd->missing = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    rd->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (guint i = 0; i < rd->uris->len; i++) {
+        const gchar *uri = g_ptr_array_index (rd->uris, i);
+        gchar *path;
+        struct stat st;
+        if (g_atomic_int_get (&_revalidate_cancel) == TRUE) break;
+        path = g_filename_from_uri (uri, NULL, NULL);
+        if (path == NULL) continue;
+        if (stat (path, &st) != 0) {
+            if (errno == ENOENT) g_hash_table_add (rd->missing, g_strdup (uri));
+        } else if (st.st_mtime >= rd->saved) {
+            g_hash_table_add (rd->changed, g_strdup (uri));
+        }
+        g_free (path);
+    }
+    if (g_atomic_int_get (&_revalidate_cancel) == TRUE) {
+        g_hash_table_destroy (rd->missing);
+        g_hash_table_destroy (rd->changed);
+        g_ptr_array_free (rd->uris, TRUE);
+        g_free (rd);
+        return NULL;
+    }
+    g_idle_add (_revalidate_done, rd);
+    return NULL;
+}
+
+static gboolean _revalidate_done (gpointer data)
+{
+    RevalidateData *rd = (RevalidateData *)data;
+    GHashTable *updated = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify)song_delete);
+    GHashTableIter iter;
+    gpointer key;
+
+    if (_revalidate != NULL) g_thread_join (_revalidate);
+    _revalidate = NULL;
+
+    /* changed ones like they were added again */
+    g_hash_table_iter_init (&iter, rd->changed);
+    while (g_hash_table_iter_next (&iter, &key, NULL) == TRUE) {
+        gchar *path = g_filename_from_uri ((const gchar *)key, NULL, NULL);
+        GList *l = path != NULL ? inspector_run (path) : NULL;
+        if (l != NULL) {
+            g_hash_table_insert (updated, key, l->data);
+            l = g_list_delete_link (l, l);
+            g_list_foreach (l, _free_song_list_items, NULL);
+            g_list_free (l);
+        } else {
+            g_hash_table_add (rd->missing, g_strdup ((const gchar *)key));
+        }
+        g_free (path);
+    }
+    _update_songs_by_uri (_playlist, updated);
+    _update_songs_by_uri (_sufflelist, updated);
+    if (g_hash_table_size (rd->missing) > 0) {
+        LOG_DEBUG("Removing %u missing songs from restored playlist.", g_hash_table_size (rd->missing));
+        _remove_songs_by_uri (&_playlist, rd->missing);
+        _remove_songs_by_uri (&_sufflelist, rd->missing);
+        _length = g_list_length (*_list);
+        if (_search.current != NULL) (void)_search_from_index (_search_index, FALSE);
+    }
+
+    g_hash_table_destroy (updated);
+    g_hash_table_destroy (rd->missing);
+    g_hash_table_destroy (rd->changed);
+    g_ptr_array_free (rd->uris, TRUE);
+    g_free (rd);
+    return FALSE;
+}
+
+static void _remove_songs_by_uri (GList **list, GHashTable *uris)
+{
+    GList *l = *list;
+    GArray *removed = g_array_new (FALSE, FALSE, sizeof (gint32));
+    gint32 index = 0;
+    while (l != NULL) {
+        GList *next = l->next;
+        Song *s = (Song *)l->data;
+        if (s != NULL && g_hash_table_contains (uris, s->uri)) {
+            if (l == _current) _current = l->next != NULL ? l->next : l->prev;
+            *list = g_list_delete_link (*list, l);
+            song_delete (s);
+            g_array_append_val (removed, index); /* next one is at same index now */
+        } else {
+            index++;
+        }
+        l = next;
+    }
+    if (list == &_playlist) playlist_journal_remove (removed);
+    g_array_free (removed, TRUE);
+}
+
+static void _update_songs_by_uri (GList *list, GHashTable *songs)
+{
+    gint index = 0;
+    if (g_hash_table_size (songs) == 0) return;
+    for (GList *l = list; l != NULL; l = l->next, index++) {
+        Song *s = (Song *)l->data;
+        Song *n = s != NULL ? g_hash_table_lookup (songs, s->uri) : NULL;
+        if (n == NULL) continue;
+        (void)song_tags_copy (s, n);
+        (void)song_set_type (s, n->type);
+        s->tunes = n->tunes;
+        memcpy (s->tune_duration, n->tune_duration, sizeof (s->tune_duration));
+        if (list == _playlist) playlist_journal_update (index, s);
+    }
+}
+
 static void _free_song_list_items (gpointer data, gpointer user_data)
 {
     if (data == NULL) return;
@@ -531,14 +920,29 @@ gint song_sort_by_path (gconstpointer p1, gconstpointer p2)
   return g_ascii_strncasecmp (s1->uri, s2->uri, ABSOLUTELY_MAX_STR_LEN);
 }
 
+static gboolean _has_playlist_suffix (const char *filepath)
+{
+    gboolean ret;
+    gchar *lower = g_ascii_strdown (filepath, -1);
+    if (lower == NULL) return FALSE;
+    ret = g_str_has_suffix (lower, ".pls") || g_str_has_suffix (lower, ".m3u") || g_str_has_suffix (lower, ".m3u8");
+    g_free (lower);
+    return ret;
+}
+
 static gboolean _add_playlist_file (const char *filepath)
 {
     GList *l;
     if (filepath == NULL) return FALSE;
+    if (negative_cache_has (filepath, NEGATIVE_CACHE_NOT_PLAYLIST) == TRUE) return FALSE;
     if (util_is_possibly_supported_file (filepath) == FALSE) return FALSE;
 
-    l = playlist_pls_load (filepath);
-    if (l == NULL) l = playlist_m3u_load (filepath);
+    l = playlist_pls_load (filepath, NULL);
+    if (l == NULL) l = playlist_m3u_load (filepath, NULL);
+    /* real playlist can be empty just because its songs are missing now */
+    if (l == NULL && _has_playlist_suffix (filepath) == FALSE) {
+        negative_cache_add (filepath, NEGATIVE_CACHE_NOT_PLAYLIST);
+    }
 
     if (l != NULL) {
         if (_add_list (l) == FALSE) {
@@ -552,6 +956,7 @@ static gboolean _add_list (GList *l)
 {
     if (l == NULL) return FALSE;
     if (playlist_length () + g_list_length (l) > INT_MAX) return FALSE;
+    playlist_journal_insert (-1, l);
     if (_playlist == NULL) _playlist = l;
     else _playlist = g_list_concat (_playlist, l);
     _length = g_list_length (_playlist);
@@ -561,6 +966,24 @@ static gboolean _add_list (GList *l)
     return TRUE;
 }
 
+static void _add_found_song (Song *s, gpointer user_data)
+{
+    GList *l = g_list_append (NULL, s);
+    (void)user_data;
+    if (l == NULL) {
+        song_delete (s);
+        return;
+    }
+    if (_add_list (l) == FALSE) {
+        song_delete (s);
+        g_list_free (l);
+        return;
+    }
+    if (_search.current != NULL) {
+        (void)_search_from_index (_search_index, FALSE);
+    }
+}
+
 static gint _playlist_random ()
 {
      return ((rand()+1)%(playlist_length ()));
@@ -24,6 +24,8 @@
 #include "song.h"
 #include "search.h"
 
+#define PLAYLIST_PEEK_MAX 16
+
 typedef enum {
    PLAYLIST_ORDER_PATH = 0,
    PLAYLIST_ORDER_ARTIST
@@ -64,6 +66,8 @@ Song *playlist_get_next_song (void);
 Song *playlist_get_nth_song (gint index);
 /* Does not change current song */
 Song *playlist_get_current_song (void);
+Song *playlist_peek_next_song (void); /* what get_next_song will return */
+gint playlist_peek_next_songs (Song **songs, gint n); /* next n in play order, returns count */
 Song *playlist_get_nth_song_no_set (gint index);
 
 gint playlist_get_song_index (Song *o);
@@ -89,6 +93,16 @@ gboolean playlist_paste_to (gint index);
 gint playlist_num_to_paste (void);
 
 /* Global GList reorder */
+/* Adds songs from snapshot and from journal written after it, without
+ * inspecting them. Local files which are changed or removed after that
+ * are rechecked in background. */
+gboolean playlist_load_snapshot (const gchar *snapshot, const gchar *journal, guint8 *volume);
+/* Journals playlist changes. Journal is compacted to snapshot and pls files */
+gboolean playlist_start_journal (const gchar *journal, const gchar *snapshot, const gchar *pls);
+/* Journals current song, mode, suffle order and volume, and stops journal.
+ * If journal could not be written, playlist is saved to pls instead. */
+void playlist_stop_journal (guint8 volume);
+
 gint song_sort_by_path (gconstpointer p1, gconstpointer p2);
 
 #endif
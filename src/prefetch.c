@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "prefetch.h"
+#include "config.h"
+#include "stats.h"
+#include "log.h"
+
+#define PREFETCH_CHUNK (256 * 1024)
+#define PREFETCH_RECENT_USEC (5 * 60 * G_USEC_PER_SEC) /* assume still cached */
+#define PREFETCH_RECENT_MAX 256
+
+typedef struct {
+    gchar **paths;
+    gint64 budget; /* bytes for all paths */
+    gint generation;
+} PrefetchBatch;
+
+static void _batch_free (PrefetchBatch *b);
+static void _prefetch_func (gpointer data, gpointer user_data);
+static gint64 _prefetch_file (const gchar *path, gint64 max, gint generation);
+static gboolean _recently_done (const gchar *path);
+
+static GThreadPool *_pool = NULL; /* one thread, disks like sequential reads */
+static gint _generation = 0; /* new batch cancels the old one */
+static GHashTable *_recent = NULL; /* path -> monotonic time, worker only */
+
+gboolean prefetch_init (void)
+{
+    _recent = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    if (_recent == NULL) goto error;
+    _pool = g_thread_pool_new (_prefetch_func, NULL, 1, FALSE, NULL);
+    if (_pool == NULL) goto error;
+    return TRUE;
+error:
+    prefetch_free ();
+    return FALSE;
+}
+
+void prefetch_free (void)
+{
+    g_atomic_int_inc (&_generation);
+    /* queued batches run to free themselves, stale generation ends them at once */
+    if (_pool != NULL) g_thread_pool_free (_pool, FALSE, TRUE);
+    _pool = NULL;
+    if (_recent != NULL) g_hash_table_destroy (_recent);
+    _recent = NULL;
+}
+
+void prefetch_songs (Song **songs, gint n)
+{
+    PrefetchBatch *b;
+    GPtrArray *paths;
+    if (_pool == NULL || config.prefetch_budget <= 0) return;
+
+    paths = g_ptr_array_new ();
+    for (gint i = 0; i < n; i++) {
+        gchar *path;
+        if (songs[i] == NULL || songs[i]->type == SONG_TYPE_STREAM) continue;
+        path = g_filename_from_uri (songs[i]->uri, NULL, NULL);
+        if (path != NULL) g_ptr_array_add (paths, path);
+    }
+    if (paths->len == 0) {
+        g_ptr_array_free (paths, TRUE);
+        return;
+    }
+    g_ptr_array_add (paths, NULL);
+
+    b = g_new0 (PrefetchBatch, 1);
+    b->paths = (gchar **)g_ptr_array_free (paths, FALSE);
+    b->budget = (gint64)config.prefetch_budget * 1024 * 1024;
+    b->generation = g_atomic_int_add (&_generation, 1) + 1;
+    if (g_thread_pool_push (_pool, b, NULL) == FALSE) _batch_free (b);
+}
+
+static void _batch_free (PrefetchBatch *b)
+{
+    g_strfreev (b->paths);
+    g_free (b);
+}
+
+static void _prefetch_func (gpointer data, gpointer user_data)
+{
+    PrefetchBatch *b = (PrefetchBatch *)data;
+    gint64 left = b->budget;
+    for (gint i = 0; b->paths[i] != NULL && left > 0; i++) {
+        if (g_atomic_int_get (&_generation) != b->generation) break;
+        if (_recently_done (b->paths[i]) == TRUE) continue;
+        left -= _prefetch_file (b->paths[i], left, b->generation);
+    }
+    _batch_free (b);
+}
+
+/* returns bytes read */
+static gint64 _prefetch_file (const gchar *path, gint64 max, gint generation)
+{
+    static gchar buf[PREFETCH_CHUNK]; /* single worker */
+    struct stat st;
+    gint64 len, done = 0;
+    gint fd = open (path, O_RDONLY|O_CLOEXEC);
+    if (fd < 0) return 0;
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode)) goto prefetch_file_error;
+
+    len = MIN ((gint64)st.st_size, max);
+    (void)posix_fadvise (fd, 0, len, POSIX_FADV_WILLNEED);
+    /* advice is only a hint, NFS and sleeping disks need a real read */
+    while (done < len && g_atomic_int_get (&_generation) == generation) {
+        ssize_t r = read (fd, buf, (size_t)MIN ((gint64)PREFETCH_CHUNK, len - done));
+        if (r <= 0) break;
+        done += r;
+    }
+    if (done >= len) {
+        gint64 *t = g_new (gint64, 1);
+        *t = g_get_monotonic_time ();
+        if (g_hash_table_size (_recent) >= PREFETCH_RECENT_MAX) g_hash_table_remove_all (_recent);
+        g_hash_table_replace (_recent, g_strdup (path), t);
+    }
+    stats_inc (STATS_PREFETCHED_FILES);
+    LOG_DEBUG ("%s: %" G_GINT64_FORMAT " bytes", path, done);
+
+prefetch_file_error:
+    close (fd);
+    return done;
+}
+
+static gboolean _recently_done (const gchar *path)
+{
+    gint64 *t = (gint64 *)g_hash_table_lookup (_recent, path);
+    if (t == NULL) return FALSE;
+    return g_get_monotonic_time () - *t < PREFETCH_RECENT_USEC;
+}
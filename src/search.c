@@ -20,6 +20,7 @@
 #include "search.h"
 #include "util.h"
 #include "config.h"
+#include "stats.h"
 
 gint search_init (SearchType *s)
 {
@@ -89,6 +90,7 @@ gint search_match (SearchType *s, const gchar *line, SearchMatchType *sm)
     else if (line == NULL) return -3;
     else if (sm == NULL) return -3;
 
+    stats_inc (STATS_SEARCH_EVALUATIONS);
     sm->num_matches = 0;
     const gchar *tst = line;
     regmatch_t results[MAX_REGEX_SUB_RESULTS];
@@ -24,6 +24,7 @@
 #include "sid.h"
 #include "config.h"
 #include "util.h"
+#include "stats.h"
 
 static gint64 _str_to_duration (gchar *str);
 
@@ -71,6 +72,7 @@ void sid_setup_song (Song *s, guint tunes)
     }
 
     if (_file == NULL) return; /* No songlength.md5 file */
+    stats_inc (STATS_SID_LOOKUPS);
 
     /* MD5 */
     md5c = g_checksum_new (G_CHECKSUM_MD5);
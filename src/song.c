@@ -86,6 +86,7 @@ int song_set_artist (Song *s, const gchar *artist)
 {
     if (s == NULL) return 1;
     if (artist == NULL) return 2;
+    if (g_strcmp0 (s->artist, artist) == 0) return 0; /* also keeps self copy safe */
     g_free (s->artist);
     s->artist = g_strdup (artist);
     if (s->artist == NULL) return 3;
@@ -96,6 +97,7 @@ int song_set_album (Song *s, const gchar *album)
 {
     if (s == NULL) return 1;
     if (album == NULL) return 2;
+    if (g_strcmp0 (s->album, album) == 0) return 0; /* also keeps self copy safe */
     g_free (s->album);
     s->album = g_strdup (album);
     if (s->album == NULL) return 3;
@@ -106,6 +108,7 @@ int song_set_title (Song *s, const gchar *title)
 {
     if (s == NULL) return 1;
     if (title == NULL) return 2;
+    if (g_strcmp0 (s->title, title) == 0) return 0; /* also keeps self copy safe */
     g_free (s->title);
     s->title = g_strdup (title);
     if (s->title == NULL) return 3;
@@ -116,6 +119,7 @@ int song_set_stream_title (Song *s, const gchar *title)
 {
     if (s == NULL) return 1;
     if (title == NULL) return 2;
+    if (g_strcmp0 (s->stream_title, title) == 0) return 0; /* also keeps self copy safe */
     g_free (s->stream_title);
     s->stream_title = g_strdup (title);
     if (s->stream_title == NULL) return 3;
@@ -154,6 +158,7 @@ int song_set_codec (Song *s, const gchar *codec)
 {
     if (s == NULL) return 1;
     if (codec == NULL) return 2;
+    if (g_strcmp0 (s->codec, codec) == 0) return 0; /* also keeps self copy safe */
     g_free (s->codec);
     s->codec = g_strdup (codec);
     if (s->codec == NULL) return 3;
@@ -164,6 +169,7 @@ int song_set_copyright (Song *s, const gchar *copyright)
 {
     if (s == NULL) return 1;
     if (copyright == NULL) return 2;
+    if (g_strcmp0 (s->copyright, copyright) == 0) return 0; /* also keeps self copy safe */
     g_free (s->copyright);
     s->copyright = g_strdup (copyright);
     if (s->copyright == NULL) return 3;
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <string.h>
+
+#include "stats.h"
+
+#define STATS_BUCKETS 32 /* bucket i has values from 2^i to 2^(i+1)-1 */
+
+typedef struct {
+    guint64 count;
+    guint64 sum;
+    guint64 max;
+    guint64 buckets[STATS_BUCKETS];
+} StatsHist;
+
+typedef struct {
+    guint64 counters[STATS_COUNTERS];
+    StatsHist hists[STATS_HISTOGRAMS];
+} StatsBlock;
+
+/* only owner thread writes its block, readers just must not see torn values */
+#define _LOAD(p) __atomic_load_n ((p), __ATOMIC_RELAXED)
+#define _STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELAXED)
+#define _BUMP(p, n) _STORE ((p), _LOAD (p) + (n))
+
+static StatsBlock *_block (void);
+static void _block_retire (gpointer data);
+static void _block_add (StatsBlock *to, StatsBlock *from);
+static void _sum (StatsBlock *total);
+static guint64 _percentile (const StatsHist *h, gdouble q);
+
+static const gchar *_counter_names[STATS_COUNTERS] = {
+    "files_walked", "magic_checks", "probes", "probe_hits", "probe_misses", "probe_timeouts",
+    "sid_lookups", "search_evaluations", "redraws_requested", "redraws", "net_requests", "net_failures",
+    "prefetched_files", "stream_underruns", "stream_reconnects",
+    "audio_underruns", "audio_rt_threads", "render_cache_hits", "rendered_tunes"
+};
+static const gchar *_histogram_names[STATS_HISTOGRAMS] = {
+    "probe_latency_us", "frame_time_us", "net_latency_us"
+};
+
+static GPrivate _local = G_PRIVATE_INIT (_block_retire);
+static GMutex _mutex; /* _blocks and _retired */
+static GSList *_blocks = NULL; /* of running threads */
+static StatsBlock _retired; /* sum of exited threads */
+static gint64 _start = 0;
+
+void stats_init (void)
+{
+    _start = g_get_monotonic_time ();
+}
+
+void stats_inc (StatsCounter c)
+{
+    _BUMP (&_block ()->counters[c], 1);
+}
+
+void stats_record (StatsHistogram h, gint64 usec)
+{
+    StatsHist *hist = &_block ()->hists[h];
+    guint64 v = usec > 0 ? (guint64)usec : 0;
+    guint bucket = v > 0 ? g_bit_storage (v) - 1 : 0;
+    if (bucket >= STATS_BUCKETS) bucket = STATS_BUCKETS - 1;
+
+    _BUMP (&hist->count, 1);
+    _BUMP (&hist->sum, v);
+    _BUMP (&hist->buckets[bucket], 1);
+    if (v > _LOAD (&hist->max)) _STORE (&hist->max, v);
+}
+
+gchar *stats_summary (void)
+{
+    StatsBlock t;
+    const guint64 *c = t.counters;
+    const StatsHist *probe = &t.hists[STATS_PROBE_LATENCY];
+    const StatsHist *frame = &t.hists[STATS_FRAME_TIME];
+    const StatsHist *net = &t.hists[STATS_NET_LATENCY];
+
+    _sum (&t);
+    return g_strdup_printf ("files %" G_GUINT64_FORMAT " magic %" G_GUINT64_FORMAT
+        " probes %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT
+        " p50 %" G_GUINT64_FORMAT "us | sid %" G_GUINT64_FORMAT " search %" G_GUINT64_FORMAT
+        " | redraws %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " p50/p99 %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT "us"
+        " | net %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT " p50 %" G_GUINT64_FORMAT "ms"
+        " | xruns %" G_GUINT64_FORMAT,
+        c[STATS_FILES_WALKED], c[STATS_MAGIC_CHECKS],
+        c[STATS_PROBES], c[STATS_PROBE_HITS], c[STATS_PROBE_MISSES], c[STATS_PROBE_TIMEOUTS],
+        _percentile (probe, 0.5), c[STATS_SID_LOOKUPS], c[STATS_SEARCH_EVALUATIONS],
+        c[STATS_REDRAWS], c[STATS_REDRAWS_REQUESTED], _percentile (frame, 0.5), _percentile (frame, 0.99),
+        c[STATS_NET_REQUESTS], c[STATS_NET_FAILURES], _percentile (net, 0.5) / 1000,
+        c[STATS_AUDIO_UNDERRUNS]);
+}
+
+gchar *stats_to_json (void)
+{
+    StatsBlock t;
+    GString *str = g_string_new (NULL);
+
+    _sum (&t);
+    g_string_append_printf (str, "{\"uptime_ms\":%" G_GINT64_FORMAT ",\"counters\":{",
+        _start > 0 ? (g_get_monotonic_time () - _start) / 1000 : 0);
+    for (gint i = 0; i < STATS_COUNTERS; i++) {
+        g_string_append_printf (str, "%s\"%s\":%" G_GUINT64_FORMAT, i > 0 ? "," : "",
+            _counter_names[i], t.counters[i]);
+    }
+    g_string_append (str, "},\"histograms\":{");
+    for (gint i = 0; i < STATS_HISTOGRAMS; i++) {
+        const StatsHist *h = &t.hists[i];
+        g_string_append_printf (str, "%s\"%s\":{\"count\":%" G_GUINT64_FORMAT ",\"sum\":%" G_GUINT64_FORMAT
+            ",\"max\":%" G_GUINT64_FORMAT ",\"p50\":%" G_GUINT64_FORMAT ",\"p90\":%" G_GUINT64_FORMAT
+            ",\"p99\":%" G_GUINT64_FORMAT "}", i > 0 ? "," : "", _histogram_names[i],
+            h->count, h->sum, h->max, _percentile (h, 0.5), _percentile (h, 0.9), _percentile (h, 0.99));
+    }
+    g_string_append (str, "}}");
+    return g_string_free (str, FALSE);
+}
+
+/* first use in thread registers its block */
+static StatsBlock *_block (void)
+{
+    StatsBlock *b = (StatsBlock *)g_private_get (&_local);
+    if (G_LIKELY (b != NULL)) return b;
+
+    b = g_new0 (StatsBlock, 1);
+    g_mutex_lock (&_mutex);
+    _blocks = g_slist_prepend (_blocks, b);
+    g_mutex_unlock (&_mutex);
+    g_private_set (&_local, b);
+    return b;
+}
+
+/* thread exit. counts are kept */
+static void _block_retire (gpointer data)
+{
+    StatsBlock *b = (StatsBlock *)data;
+    g_mutex_lock (&_mutex);
+    _blocks = g_slist_remove (_blocks, b);
+    _block_add (&_retired, b);
+    g_mutex_unlock (&_mutex);
+    g_free (b);
+}
+
+static void _block_add (StatsBlock *to, StatsBlock *from)
+{
+    for (gint i = 0; i < STATS_COUNTERS; i++) to->counters[i] += _LOAD (&from->counters[i]);
+    for (gint i = 0; i < STATS_HISTOGRAMS; i++) {
+        StatsHist *t = &to->hists[i];
+        StatsHist *f = &from->hists[i];
+        guint64 max = _LOAD (&f->max);
+        t->count += _LOAD (&f->count);
+        t->sum += _LOAD (&f->sum);
+        if (max > t->max) t->max = max;
+        for (gint j = 0; j < STATS_BUCKETS; j++) t->buckets[j] += _LOAD (&f->buckets[j]);
+    }
+}
+
+static void _sum (StatsBlock *total)
+{
+    g_mutex_lock (&_mutex);
+    memcpy (total, &_retired, sizeof (StatsBlock));
+    for (GSList *l = _blocks; l != NULL; l = l->next) _block_add (total, (StatsBlock *)l->data);
+    g_mutex_unlock (&_mutex);
+}
+
+/* upper bound of bucket, good enough for orders of magnitude */
+static guint64 _percentile (const StatsHist *h, gdouble q)
+{
+    guint64 seen = 0;
+    guint64 target;
+    if (h->count == 0) return 0;
+    target = (guint64)(h->count * q);
+    if (target == 0) target = 1;
+    for (gint i = 0; i < STATS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) return MIN (((guint64)2 << i) - 1, h->max);
+    }
+    return h->max;
+}
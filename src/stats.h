@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_STATS_H_
+#define _KK_STATS_H_
+
+#include <glib.h>
+
+/*
+ * Always on performance counters. Every thread updates its own block
+ * without locks or atomic read-modify-write, readers sum the blocks.
+ */
+
+typedef enum {
+    STATS_FILES_WALKED = 0,
+    STATS_MAGIC_CHECKS,
+    STATS_PROBES,
+    STATS_PROBE_HITS,
+    STATS_PROBE_MISSES,
+    STATS_PROBE_TIMEOUTS,
+    STATS_SID_LOOKUPS,
+    STATS_SEARCH_EVALUATIONS,
+    STATS_REDRAWS_REQUESTED,
+    STATS_REDRAWS,
+    STATS_NET_REQUESTS,
+    STATS_NET_FAILURES,
+    STATS_PREFETCHED_FILES,
+    STATS_STREAM_UNDERRUNS,
+    STATS_STREAM_RECONNECTS,
+    STATS_AUDIO_UNDERRUNS,
+    STATS_AUDIO_RT_THREADS,
+    STATS_RENDER_CACHE_HITS,
+    STATS_RENDERED_TUNES,
+    STATS_COUNTERS
+} StatsCounter;
+
+/* microseconds */
+typedef enum {
+    STATS_PROBE_LATENCY = 0,
+    STATS_FRAME_TIME,
+    STATS_NET_LATENCY,
+    STATS_HISTOGRAMS
+} StatsHistogram;
+
+void stats_init (void);
+
+void stats_inc (StatsCounter c);
+void stats_record (StatsHistogram h, gint64 usec);
+
+/* One line for userinfo. Caller frees. */
+gchar *stats_summary (void);
+/* All counters and histograms as one JSON object. Caller frees. */
+gchar *stats_to_json (void);
+
+#endif
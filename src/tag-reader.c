@@ -0,0 +1,625 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tag-reader.h"
+
+#define MAX_TAG_SIZE (1024 * 1024) /* larger tags (cover art) are read only partly */
+#define MP3_SYNC_SEARCH_SIZE 4096
+#define OGG_HEAD_SIZE (256 * 1024)
+#define OGG_TAIL_SIZE (64 * 1024)
+#define SID_HEADER_SIZE 0x76
+
+typedef struct {
+    gchar *artist;
+    gchar *title;
+    gchar *album;
+    gchar *copyright;
+    const gchar *codec;
+    guint year;
+    guint track;
+    gint64 duration; /* ms */
+    gboolean sid;
+    guint sid_tunes;
+} TagInfo;
+
+typedef struct {
+    guint version; /* 1, 2 or 25 (2.5) */
+    guint bitrate; /* kbps */
+    guint samplerate;
+    guint samples;
+    guint length; /* bytes */
+    gboolean mono;
+} Mp3Frame;
+
+static gssize _read_at (int fd, goffset offset, guchar *buf, gsize len);
+static guint32 _be32 (const guchar *p);
+static guint32 _be24 (const guchar *p);
+static guint16 _be16 (const guchar *p);
+static guint32 _le32 (const guchar *p);
+static guint16 _le16 (const guchar *p);
+static guint64 _le64 (const guchar *p);
+static guint32 _syncsafe32 (const guchar *p);
+static void _set_str (gchar **field, gchar *value);
+static guint _leading_number (const gchar *str);
+static gchar *_latin1 (const guchar *p, gsize max_len);
+
+static gboolean _read_mp3 (int fd, goffset size, gboolean mp3_suffix, TagInfo *info);
+static void _read_id3v2 (int fd, const guchar *header, guint tag_size, TagInfo *info);
+static void _id3v2_frame (const gchar *id, const guchar *data, gsize size, TagInfo *info);
+static gchar *_id3v2_text (const guchar *data, gsize size);
+static void _read_id3v1 (int fd, goffset size, TagInfo *info);
+static gboolean _parse_mp3_header (const guchar *p, Mp3Frame *f);
+static gboolean _read_mpeg_audio (int fd, goffset start, goffset size, gboolean search, TagInfo *info);
+static gboolean _read_flac (int fd, goffset start, TagInfo *info);
+static gboolean _read_ogg (int fd, goffset size, TagInfo *info);
+static void _read_vorbis_comments (const guchar *p, gsize len, TagInfo *info);
+static gboolean _read_sid (int fd, TagInfo *info);
+static void _apply (TagInfo *info, Song *s);
+
+gboolean tag_reader_read (const gchar *filepath, Song *s)
+{
+    TagInfo info = {0,};
+    guchar head[4];
+    gboolean ok = FALSE;
+    struct stat st;
+    int fd;
+
+    if (filepath == NULL || s == NULL) return FALSE;
+    fd = open (filepath, O_RDONLY);
+    if (fd < 0) return FALSE;
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode)) goto read_error;
+    if (_read_at (fd, 0, head, 4) < 4) goto read_error;
+
+    if (memcmp (head, "PSID", 4) == 0 || memcmp (head, "RSID", 4) == 0) {
+        ok = _read_sid (fd, &info);
+    } else if (memcmp (head, "fLaC", 4) == 0) {
+        ok = _read_flac (fd, 0, &info);
+    } else if (memcmp (head, "OggS", 4) == 0) {
+        ok = _read_ogg (fd, st.st_size, &info);
+    } else {
+        ok = _read_mp3 (fd, st.st_size, g_str_has_suffix (filepath, ".mp3") || g_str_has_suffix (filepath, ".MP3"), &info);
+    }
+    if (ok == TRUE) _apply (&info, s);
+
+read_error:
+    g_free (info.artist);
+    g_free (info.title);
+    g_free (info.album);
+    g_free (info.copyright);
+    close (fd);
+    return ok;
+}
+
+static void _apply (TagInfo *info, Song *s)
+{
+    if (info->artist != NULL) (void)song_set_artist (s, info->artist);
+    if (info->title != NULL) (void)song_set_title (s, info->title);
+    if (info->album != NULL) (void)song_set_album (s, info->album);
+    if (info->copyright != NULL) (void)song_set_copyright (s, info->copyright);
+    if (info->codec != NULL) (void)song_set_codec (s, info->codec);
+    if (info->year > 0) (void)song_set_year (s, info->year);
+    if (info->track > 0) (void)song_set_track (s, info->track);
+    if (info->sid == TRUE) {
+        (void)song_set_type (s, SONG_TYPE_SID);
+        s->tunes = info->sid_tunes; /* caller sets durations from songlengths */
+    } else {
+        (void)song_set_duration (s, info->duration > 0 ? info->duration : 0);
+    }
+}
+
+/* MP3 */
+
+static gboolean _read_mp3 (int fd, goffset size, gboolean mp3_suffix, TagInfo *info)
+{
+    guchar h[10];
+    goffset audio_start = 0;
+    gboolean have_id3 = FALSE;
+
+    if (_read_at (fd, 0, h, 10) < 10) return FALSE;
+    if (memcmp (h, "ID3", 3) == 0) {
+        guint tag_size = _syncsafe32 (&h[6]);
+        audio_start = 10 + (goffset)tag_size + ((h[5] & 0x10) ? 10 : 0); /* footer */
+        _read_id3v2 (fd, h, tag_size, info);
+        have_id3 = TRUE;
+
+        /* some encoders put id3 in front of flac too */
+        if (_read_at (fd, audio_start, h, 4) == 4 && memcmp (h, "fLaC", 4) == 0) {
+            return _read_flac (fd, audio_start, info);
+        }
+    }
+    /* without any hint that file is mp3, other formats could have sync word like bytes */
+    if (_read_mpeg_audio (fd, audio_start, size, have_id3 || mp3_suffix, info) == FALSE) return FALSE;
+    _read_id3v1 (fd, size, info);
+    return TRUE;
+}
+
+static void _read_id3v2 (int fd, const guchar *header, guint tag_size, TagInfo *info)
+{
+    guint major = header[3];
+    guint flags = header[5];
+    gsize hdr_len = major == 2 ? 6 : 10;
+    gsize len = MIN (tag_size, MAX_TAG_SIZE);
+    gsize pos = 0;
+    gssize n;
+    guchar *tag;
+
+    if (major < 2 || major > 4) return;
+    if (major == 2 && (flags & 0x40)) return; /* compressed */
+
+    tag = g_malloc (len + 1);
+    if (tag == NULL) return;
+    n = _read_at (fd, 10, tag, len);
+    if (n <= 0) goto id3v2_out;
+
+    if ((flags & 0x80) && major < 4) { /* whole tag unsynchronised */
+        gsize w = 0;
+        for (gsize r = 0; r < (gsize)n; r++) {
+            tag[w++] = tag[r];
+            if (tag[r] == 0xff && r + 1 < (gsize)n && tag[r+1] == 0x00) r++;
+        }
+        n = w;
+    }
+    if (major > 2 && (flags & 0x40) && n >= 4) { /* extended header */
+        pos = major == 3 ? 4 + _be32 (tag) : _syncsafe32 (tag);
+    }
+
+    while (pos + hdr_len <= (gsize)n) {
+        gchar id[5] = "";
+        gsize fsize;
+        guint fflags = 0;
+        const guchar *data;
+
+        if (tag[pos] == 0) break; /* padding */
+        if (major == 2) {
+            memcpy (id, &tag[pos], 3);
+            fsize = _be24 (&tag[pos+3]);
+        } else {
+            memcpy (id, &tag[pos], 4);
+            fsize = major == 4 ? _syncsafe32 (&tag[pos+4]) : _be32 (&tag[pos+4]);
+            fflags = _be16 (&tag[pos+8]);
+        }
+        if (fsize == 0 || fsize > (gsize)n - pos - hdr_len) break;
+        data = &tag[pos+hdr_len];
+
+        /* compressed or encrypted frames are not read */
+        if ((major == 3 && (fflags & 0x00c0) == 0) || (major == 4 && (fflags & 0x000e) == 0) || major == 2) {
+            if (major == 4 && (fflags & 0x0001) && fsize > 4) { /* data length indicator */
+                data += 4;
+                _id3v2_frame (id, data, fsize - 4, info);
+            } else {
+                _id3v2_frame (id, data, fsize, info);
+            }
+        }
+        pos += hdr_len + fsize;
+    }
+id3v2_out:
+    g_free (tag);
+}
+
+static void _id3v2_frame (const gchar *id, const guchar *data, gsize size, TagInfo *info)
+{
+    gchar *text;
+    if (id[0] != 'T') return; /* only text frames */
+
+    if (strcmp (id, "TPE1") == 0 || strcmp (id, "TP1") == 0) {
+        _set_str (&info->artist, _id3v2_text (data, size));
+    } else if (strcmp (id, "TIT2") == 0 || strcmp (id, "TT2") == 0) {
+        _set_str (&info->title, _id3v2_text (data, size));
+    } else if (strcmp (id, "TALB") == 0 || strcmp (id, "TAL") == 0) {
+        _set_str (&info->album, _id3v2_text (data, size));
+    } else if (strcmp (id, "TCOP") == 0 || strcmp (id, "TCR") == 0) {
+        _set_str (&info->copyright, _id3v2_text (data, size));
+    } else if (strcmp (id, "TRCK") == 0 || strcmp (id, "TRK") == 0) {
+        text = _id3v2_text (data, size);
+        if (info->track == 0) info->track = _leading_number (text);
+        g_free (text);
+    } else if (strcmp (id, "TYER") == 0 || strcmp (id, "TDRC") == 0 || strcmp (id, "TYE") == 0) {
+        text = _id3v2_text (data, size);
+        if (info->year == 0) info->year = _leading_number (text);
+        g_free (text);
+    }
+}
+
+/* first value of text frame as UTF-8 */
+static gchar *_id3v2_text (const guchar *data, gsize size)
+{
+    gchar *text = NULL;
+    if (size < 2) return NULL;
+
+    switch (data[0]) {
+        case 0:
+            text = g_convert ((const gchar *)&data[1], size - 1, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+            break;
+        case 1:
+            text = g_convert ((const gchar *)&data[1], (size - 1) & ~1, "UTF-8", "UTF-16", NULL, NULL, NULL);
+            break;
+        case 2:
+            text = g_convert ((const gchar *)&data[1], (size - 1) & ~1, "UTF-8", "UTF-16BE", NULL, NULL, NULL);
+            break;
+        case 3:
+            text = g_strndup ((const gchar *)&data[1], size - 1);
+            break;
+        default:
+            break;
+    }
+    if (text != NULL && g_utf8_validate (text, -1, NULL) == FALSE) {
+        g_free (text);
+        text = NULL;
+    }
+    return text;
+}
+
+static void _read_id3v1 (int fd, goffset size, TagInfo *info)
+{
+    guchar t[128];
+    gchar year[5] = "";
+    if (size < 128) return;
+    if (_read_at (fd, size - 128, t, 128) < 128) return;
+    if (memcmp (t, "TAG", 3) != 0) return;
+
+    _set_str (&info->title, _latin1 (&t[3], 30));
+    _set_str (&info->artist, _latin1 (&t[33], 30));
+    _set_str (&info->album, _latin1 (&t[63], 30));
+    memcpy (year, &t[93], 4);
+    if (info->year == 0) info->year = _leading_number (year);
+    if (info->track == 0 && t[125] == 0) info->track = t[126]; /* ID3v1.1 */
+}
+
+static gboolean _parse_mp3_header (const guchar *p, Mp3Frame *f)
+{
+    static const guint bitrates_v1[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+    static const guint bitrates_v2[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+    static const guint rates[3] = {44100, 48000, 32000};
+    guint vbits, layer, bri, sri;
+
+    if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0) return FALSE;
+    vbits = (p[1] >> 3) & 3; /* 0 = 2.5, 1 = reserved, 2 = 2, 3 = 1 */
+    layer = (p[1] >> 1) & 3; /* 1 = layer III */
+    bri = p[2] >> 4;
+    sri = (p[2] >> 2) & 3;
+    if (vbits == 1 || layer != 1 || bri == 0 || bri == 15 || sri == 3) return FALSE;
+
+    f->version = vbits == 3 ? 1 : (vbits == 2 ? 2 : 25);
+    f->bitrate = vbits == 3 ? bitrates_v1[bri] : bitrates_v2[bri];
+    f->samplerate = rates[sri] >> (vbits == 3 ? 0 : (vbits == 2 ? 1 : 2));
+    f->samples = vbits == 3 ? 1152 : 576;
+    f->length = (f->samples / 8 * f->bitrate * 1000) / f->samplerate + ((p[2] >> 1) & 1);
+    f->mono = ((p[3] >> 6) & 3) == 3;
+    return TRUE;
+}
+
+static gboolean _read_mpeg_audio (int fd, goffset start, goffset size, gboolean search, TagInfo *info)
+{
+    guchar buf[MP3_SYNC_SEARCH_SIZE];
+    guchar x[64];
+    gssize n = _read_at (fd, start, buf, sizeof (buf));
+    Mp3Frame f;
+    goffset frame_start = -1;
+    guint32 frames = 0;
+    gsize side;
+
+    for (gssize i = 0; i + 4 <= n; i++) {
+        guchar next[4];
+        Mp3Frame f2;
+        if (search == FALSE && i > 0) break;
+        if (_parse_mp3_header (&buf[i], &f) == FALSE) continue;
+        /* one sync word can be random data, two in row hardly */
+        if (_read_at (fd, start + i + f.length, next, 4) < 4) continue;
+        if (_parse_mp3_header (next, &f2) == FALSE) continue;
+        frame_start = start + i;
+        break;
+    }
+    if (frame_start < 0) return FALSE;
+
+    memset (x, 0, sizeof (x));
+    (void)_read_at (fd, frame_start, x, sizeof (x));
+    side = f.version == 1 ? (f.mono ? 17 : 32) : (f.mono ? 9 : 17);
+    if (memcmp (&x[4+side], "Xing", 4) == 0 || memcmp (&x[4+side], "Info", 4) == 0) {
+        if (_be32 (&x[4+side+4]) & 1) frames = _be32 (&x[4+side+8]);
+    } else if (memcmp (&x[36], "VBRI", 4) == 0) {
+        frames = _be32 (&x[36+14]);
+    }
+
+    if (frames > 0) {
+        info->duration = (gint64)frames * f.samples * 1000 / f.samplerate;
+    } else { /* CBR */
+        gint64 bytes = size - frame_start;
+        info->duration = bytes * 8 / f.bitrate;
+    }
+    info->codec = f.version == 1 ? "MPEG-1 Layer 3 (MP3)" : "MPEG-2 Layer 3 (MP3)";
+    return TRUE;
+}
+
+/* FLAC */
+
+static gboolean _read_flac (int fd, goffset start, TagInfo *info)
+{
+    goffset pos = start + 4;
+    gboolean have_streaminfo = FALSE;
+    gboolean last = FALSE;
+
+    while (last == FALSE) {
+        guchar bh[4];
+        guint type;
+        guint32 len;
+
+        if (_read_at (fd, pos, bh, 4) < 4) break;
+        last = (bh[0] & 0x80) != 0;
+        type = bh[0] & 0x7f;
+        len = _be24 (&bh[1]);
+        pos += 4;
+
+        if (type == 0 && len >= 34) { /* STREAMINFO */
+            guchar si[34];
+            guint32 rate;
+            guint64 total;
+            if (_read_at (fd, pos, si, 34) < 34) break;
+            rate = ((guint32)si[10] << 12) | ((guint32)si[11] << 4) | (si[12] >> 4);
+            total = ((guint64)(si[13] & 0x0f) << 32) | _be32 (&si[14]);
+            if (rate > 0) info->duration = (gint64)(total * 1000 / rate);
+            have_streaminfo = TRUE;
+        } else if (type == 4) { /* VORBIS_COMMENT */
+            gsize clen = MIN (len, MAX_TAG_SIZE);
+            guchar *c = g_malloc (clen);
+            if (c != NULL) {
+                gssize n = _read_at (fd, pos, c, clen);
+                if (n > 0) _read_vorbis_comments (c, n, info);
+                g_free (c);
+            }
+        } else if (type == 127) {
+            break; /* invalid */
+        }
+        pos += len;
+    }
+    info->codec = "Free Lossless Audio Codec (FLAC)";
+    return have_streaminfo;
+}
+
+/* Ogg */
+
+static gboolean _read_ogg (int fd, goffset size, TagInfo *info)
+{
+    GByteArray *packets[2] = {NULL, NULL};
+    guchar *buf = NULL;
+    gssize n;
+    gsize pos = 0;
+    guint pk = 0;
+    guint32 serial = 0;
+    guint32 rate = 0;
+    guint64 preskip = 0;
+    gboolean ok = FALSE;
+
+    buf = g_malloc (MAX (OGG_HEAD_SIZE, OGG_TAIL_SIZE));
+    if (buf == NULL) return FALSE;
+    packets[0] = g_byte_array_new ();
+    packets[1] = g_byte_array_new ();
+
+    /* collect two first packets of first logical stream */
+    n = _read_at (fd, 0, buf, OGG_HEAD_SIZE);
+    while (pk < 2 && pos + 27 <= (gsize)n) {
+        guint nseg = buf[pos+26];
+        gsize data = pos + 27 + nseg;
+        const guchar *lacing = &buf[pos+27];
+
+        if (memcmp (&buf[pos], "OggS", 4) != 0 || data > (gsize)n) break;
+        if (pos == 0) serial = _le32 (&buf[14]);
+        if (_le32 (&buf[pos+14]) != serial) { /* other stream */
+            for (guint s = 0; s < nseg; s++) data += lacing[s];
+            pos = data;
+            continue;
+        }
+        for (guint s = 0; s < nseg && pk < 2; s++) {
+            gsize l = MIN (lacing[s], (gsize)n - MIN (data, (gsize)n));
+            g_byte_array_append (packets[pk], &buf[data], l);
+            data += lacing[s];
+            if (lacing[s] < 255) pk++;
+        }
+        pos = data;
+    }
+
+    if (packets[0]->len >= 16 && memcmp (packets[0]->data, "\001vorbis", 7) == 0) {
+        rate = _le32 (&packets[0]->data[12]);
+        info->codec = "Vorbis";
+        if (packets[1]->len > 7 && memcmp (packets[1]->data, "\003vorbis", 7) == 0) {
+            _read_vorbis_comments (&packets[1]->data[7], packets[1]->len - 7, info);
+        }
+    } else if (packets[0]->len >= 19 && memcmp (packets[0]->data, "OpusHead", 8) == 0) {
+        rate = 48000; /* granule is always 48 kHz */
+        preskip = _le16 (&packets[0]->data[10]);
+        info->codec = "Opus";
+        if (packets[1]->len > 8 && memcmp (packets[1]->data, "OpusTags", 8) == 0) {
+            _read_vorbis_comments (&packets[1]->data[8], packets[1]->len - 8, info);
+        }
+    } else {
+        goto ogg_out; /* flac, speex... to gstreamer */
+    }
+    if (rate == 0) goto ogg_out;
+    ok = TRUE;
+
+    /* granule position of last page is length in samples */
+    {
+        goffset tail = MAX (0, size - OGG_TAIL_SIZE);
+        n = _read_at (fd, tail, buf, size - tail);
+        for (gssize i = n - 27; i >= 0; i--) {
+            guint64 granule;
+            if (memcmp (&buf[i], "OggS", 4) != 0 || _le32 (&buf[i+14]) != serial) continue;
+            granule = _le64 (&buf[i+6]);
+            if (granule == G_MAXUINT64) continue; /* no packet ends on page */
+            if (granule > preskip) info->duration = (gint64)((granule - preskip) * 1000 / rate);
+            break;
+        }
+    }
+ogg_out:
+    g_byte_array_free (packets[0], TRUE);
+    g_byte_array_free (packets[1], TRUE);
+    g_free (buf);
+    return ok;
+}
+
+static void _read_vorbis_comments (const guchar *p, gsize len, TagInfo *info)
+{
+    gsize pos;
+    guint32 count;
+    if (len < 8) return;
+    pos = 4 + (gsize)_le32 (p); /* vendor */
+    if (pos > len - 4) return;
+    count = _le32 (&p[pos]);
+    pos += 4;
+
+    for (guint32 i = 0; i < count && pos + 4 <= len; i++) {
+        gsize clen = _le32 (&p[pos]);
+        const guchar *c = &p[pos+4];
+        const guchar *eq;
+        gsize klen;
+        gchar *value;
+
+        pos += 4;
+        if (clen > len - pos) break;
+        pos += clen;
+
+        eq = memchr (c, '=', clen);
+        if (eq == NULL) continue;
+        klen = eq - c;
+        value = g_strndup ((const gchar *)eq + 1, clen - klen - 1);
+        if (value == NULL) continue;
+        if (g_utf8_validate (value, -1, NULL) == FALSE) {
+            g_free (value);
+            continue;
+        }
+
+        if (klen == 6 && g_ascii_strncasecmp ((const gchar *)c, "ARTIST", 6) == 0) {
+            _set_str (&info->artist, value);
+        } else if (klen == 5 && g_ascii_strncasecmp ((const gchar *)c, "TITLE", 5) == 0) {
+            _set_str (&info->title, value);
+        } else if (klen == 5 && g_ascii_strncasecmp ((const gchar *)c, "ALBUM", 5) == 0) {
+            _set_str (&info->album, value);
+        } else if (klen == 9 && g_ascii_strncasecmp ((const gchar *)c, "COPYRIGHT", 9) == 0) {
+            _set_str (&info->copyright, value);
+        } else if (klen == 11 && g_ascii_strncasecmp ((const gchar *)c, "TRACKNUMBER", 11) == 0) {
+            if (info->track == 0) info->track = _leading_number (value);
+            g_free (value);
+        } else if (klen == 4 && g_ascii_strncasecmp ((const gchar *)c, "DATE", 4) == 0) {
+            if (info->year == 0) info->year = _leading_number (value);
+            g_free (value);
+        } else {
+            g_free (value);
+        }
+    }
+}
+
+/* SID */
+
+static gboolean _read_sid (int fd, TagInfo *info)
+{
+    guchar h[SID_HEADER_SIZE];
+    guint version;
+    guint songs;
+
+    if (_read_at (fd, 0, h, SID_HEADER_SIZE) < SID_HEADER_SIZE) return FALSE;
+    version = _be16 (&h[4]);
+    if (version < 1 || version > 4) return FALSE;
+    songs = _be16 (&h[14]);
+
+    _set_str (&info->title, _latin1 (&h[0x16], 32));
+    _set_str (&info->artist, _latin1 (&h[0x36], 32));
+    _set_str (&info->copyright, _latin1 (&h[0x56], 32));
+    info->year = _leading_number (info->copyright);
+    info->sid = TRUE;
+    info->sid_tunes = MIN (songs, SONG_MAX_TUNES);
+    return TRUE;
+}
+
+/* helpers */
+
+static gssize _read_at (int fd, goffset offset, guchar *buf, gsize len)
+{
+    gsize done = 0;
+    while (done < len) {
+        ssize_t r = pread (fd, buf + done, len - done, offset + done);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        done += r;
+    }
+    return (gssize)done;
+}
+
+static guint32 _be32 (const guchar *p)
+{
+    return ((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | p[3];
+}
+
+static guint32 _be24 (const guchar *p)
+{
+    return ((guint32)p[0] << 16) | ((guint32)p[1] << 8) | p[2];
+}
+
+static guint16 _be16 (const guchar *p)
+{
+    return (guint16)((p[0] << 8) | p[1]);
+}
+
+static guint32 _le32 (const guchar *p)
+{
+    return ((guint32)p[3] << 24) | ((guint32)p[2] << 16) | ((guint32)p[1] << 8) | p[0];
+}
+
+static guint16 _le16 (const guchar *p)
+{
+    return (guint16)((p[1] << 8) | p[0]);
+}
+
+static guint64 _le64 (const guchar *p)
+{
+    return ((guint64)_le32 (&p[4]) << 32) | _le32 (p);
+}
+
+static guint32 _syncsafe32 (const guchar *p)
+{
+    return ((guint32)(p[0] & 0x7f) << 21) | ((guint32)(p[1] & 0x7f) << 14) | ((guint32)(p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+/* takes value. first non empty value wins */
+static void _set_str (gchar **field, gchar *value)
+{
+    if (*field == NULL && value != NULL && *value != '\0') *field = value;
+    else g_free (value);
+}
+
+static guint _leading_number (const gchar *str)
+{
+    if (str == NULL) return 0;
+    while (g_ascii_isspace (*str)) str++;
+    if (g_ascii_isdigit (*str) == FALSE) return 0;
+    return (guint)g_ascii_strtoull (str, NULL, 10);
+}
+
+/* fixed size, space or nul padded field */
+static gchar *_latin1 (const guchar *p, gsize max_len)
+{
+    gsize len = strnlen ((const char *)p, max_len);
+    gchar *str = g_convert ((const gchar *)p, len, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+    if (str != NULL) g_strstrip (str);
+    return str;
+}
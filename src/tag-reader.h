@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024 kilikali-nc team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307,
+ * USA.
+ */
+
+#ifndef _KK_TAG_READER_H_
+#define _KK_TAG_READER_H_
+
+#include <glib.h>
+
+#include "song.h"
+
+/*
+ * Reads tags and duration of MP3 (ID3v1/ID3v2, Xing/VBRI), FLAC, Ogg
+ * Vorbis/Opus and PSID/RSID files straight from file headers, without
+ * decoding. Song is changed only on success. Returns FALSE for unknown
+ * formats, which must then be checked with GStreamer.
+ * For SID files type is set to SONG_TYPE_SID and tunes to header's song
+ * count; durations are left for sid_setup_song ().
+ * Thread safe.
+ */
+gboolean tag_reader_read (const gchar *filepath, Song *s);
+
+#endif
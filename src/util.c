@@ -29,22 +29,6 @@
 #include "util.h"
 #include "log.h"
 
-gboolean util_chdir_filepath (const gchar *filepath) {
-    gint ret = -1;
-    gchar *dirpath;
-    char str[PATH_MAX];
-    char *rpath = realpath (filepath, str);
-    if (rpath == NULL) return FALSE;
-
-    dirpath = g_path_get_dirname (rpath);
-    if (dirpath == NULL) goto chdir_filepath_error;
-
-    ret = chdir (dirpath);
-chdir_filepath_error:
-    g_free (dirpath);
-    return (ret==0?TRUE:FALSE);
-}
-
 gboolean util_chdir (const gchar *dirpath) {
     gint ret = -1;
     gchar expanded[PATH_MAX];
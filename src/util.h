@@ -26,12 +26,6 @@
 #define MAX_UTF8_CHAR_SIZE (7) /* includes \0 at the end */
 #define MAX_TIME_STR_LEN (20)
 
-/* Change working dir to same directory using files path
- *
- * filepath NULL terminated string
- * return: TRUE on success */
-gboolean util_chdir_filepath (const gchar *filepath);
-
 /* Change working dir
  *
  * dirpath NULL terminated string